@@ -13,6 +13,12 @@
 
 namespace Cyclone::Core::Entity
 {
+	/// @brief Attached to the meta type of every entity class, so tools can walk the components of an entity without knowing its class
+	struct EntityComponents
+	{
+		std::span<const entt::id_type> mTypes;	///< entt::type_hash of each history component, in the order of history_components
+	};
+
 	template<typename T>
 	class BaseEntity
 	{
@@ -25,10 +31,15 @@ namespace Cyclone::Core::Entity
 			static_assert( entt::type_list_diff_t<T::history_components, history_components>::size + history_components::size == T::history_components::size );
 			static_assert( !entt::type_list_contains_v<T::history_components, Component::EpochNumber> );
 
-			entt::meta_factory<T>{ inMetaContext }.type( T::kEntityType ).func<&T::sCreateEntity>( "create_entity"_hs );
+			static constexpr auto kComponentTypes = [] <typename... Types>( entt::type_list<Types...> ) { return std::array<entt::id_type, sizeof...( Types )>{ entt::type_hash<Types>::value()... }; }( typename T::history_components{} );
+
+			// Named and listing its components, so text levels and other tools can walk an entity of any class
+			entt::meta_factory<T>{ inMetaContext }.type( T::kEntityType, T::kEntityType.data() ).template custom<EntityComponents>( kComponentTypes );
+
+			// Only used for tooling and reflection, hot paths call through Entity::kEntityClassTable
+			entt::meta_factory<T>{ inMetaContext }.func<&T::sCreateEntity>( "create_entity"_hs );
 
-			entt::meta_factory<T>{ inMetaContext }.type( T::kEntityType ).func<&T::sSaveHistory>( "save_history"_hs );
-			entt::meta_factory<T>{ inMetaContext }.type( T::kEntityType ).func<&T::sRestoreHistory>( "restore_history"_hs );
+			entt::meta_factory<T>{ inMetaContext }.func<&T::sSaveHistory>( "save_history"_hs );
 		}
 
 		static entt::entity sCreateEntity( entt::registry &inRegistry, const Cyclone::Math::Vector4D inPosition )
@@ -50,17 +61,6 @@ namespace Cyclone::Core::Entity
 			Cyclone::Util::ApplyOverTypeList<T::history_components>( CopyComponentFunctor{}, inRegistry, inHistoryRegistry, inEntity );
 		}
 
-		static void sRestoreHistory( entt::registry &inRegistry, const entt::registry &inHistoryRegistry, entt::entity inEntity )
-		{
-			//if ( !inRegistry.valid( inEntity ) ) {
-			//	auto retEntity = inRegistry.create( inEntity );
-			//	assert( retEntity == inEntity );
-			//}
-
-			// Copy back from inRegistryHistory -> inRegistry
-			Cyclone::Util::ApplyOverTypeList<T::history_components>( CopyComponentFunctor{}, inHistoryRegistry, inRegistry, inEntity );
-		}
-
 	protected:
 		static entt::entity sCreate( entt::registry &inRegistry )
 		{
@@ -0,0 +1,39 @@
+#pragma once
+
+// Cyclone entites
+#include "Cyclone/Core/Entity/PointDebug.hpp"
+#include "Cyclone/Core/Entity/InfoDebug.hpp"
+
+namespace Cyclone::Core::Entity
+{
+	/// Every entity class known to the editor, an entity class must be listed here to be registered
+	using entity_classes = entt::type_list<PointDebug, InfoDebug>;
+
+	/// @brief Direct entry points of an entity class, used on hot paths instead of resolving them through entt::meta
+	struct EntityClassFunctions
+	{
+		entt::id_type			mEntityType;
+		entt::entity			( *mCreateEntity )( entt::registry &inRegistry, const Cyclone::Math::Vector4D inPosition );
+		void					( *mSaveHistory )( const entt::registry &inRegistry, entt::registry &inHistoryRegistry, entt::entity inEntity );
+	};
+
+	template<typename... Types>
+	constexpr std::array<EntityClassFunctions, sizeof...( Types )> MakeEntityClassTable( entt::type_list<Types...> )
+	{
+		std::array<EntityClassFunctions, sizeof...( Types )> table{ EntityClassFunctions{ Types::kEntityType.value(), &Types::sCreateEntity, &Types::sSaveHistory }... };
+		std::sort( table.begin(), table.end(), []( const auto &inLhs, const auto &inRhs ) { return inLhs.mEntityType < inRhs.mEntityType; } );
+		return table;
+	}
+
+	/// Dense table of every entity class, sorted by entity type at compile time
+	inline constexpr auto kEntityClassTable = MakeEntityClassTable( entity_classes{} );
+
+	/// @brief Finds the entity class of an entity type, nullptr for an unknown one
+	/// @note Component::EntityType holds the hash of the class name rather than a small index, it is what the history, the journal and level files store, so the table is searched instead of indexed
+	inline const EntityClassFunctions *FindEntityClass( entt::id_type inType )
+	{
+		const auto it = std::lower_bound( kEntityClassTable.begin(), kEntityClassTable.end(), inType, []( const EntityClassFunctions &inLhs, entt::id_type inRhs ) { return inLhs.mEntityType < inRhs; } );
+		if ( it != kEntityClassTable.end() && it->mEntityType == inType ) return &*it;
+		return nullptr;
+	}
+}
\ No newline at end of file
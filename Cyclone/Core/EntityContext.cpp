@@ -1,9 +1,23 @@
 #include "pch.h"
 #include "Cyclone/Core/EntityContext.hpp"
 
+// Cyclone history
+#include "Cyclone/Core/History/EpochMerger.hpp"
+
 // Cyclone Entities
-#include "Cyclone/Core/Entity/PointDebug.hpp"
-#include "Cyclone/Core/Entity/InfoDebug.hpp"
+#include "Cyclone/Core/Entity/EntityClasses.hpp"
+
+// Cyclone utils
+#include "Cyclone/Util/ByteStream.hpp"
+#include "Cyclone/Util/Hash.hpp"
+
+// STL
+#include <chrono>
+
+static double MillisecondsSince( std::chrono::steady_clock::time_point inStart )
+{
+	return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - inStart ).count();
+}
 
 template<typename T>
 constexpr uint32_t GetDebugColor()
@@ -38,6 +52,7 @@ template<typename T>
 void Cyclone::Core::EntityContext::RegisterEntityClass()
 {
 	static_assert( std::is_base_of_v<Cyclone::Core::Entity::BaseEntity<T>, T> );
+	static_assert( entt::type_list_diff_t<typename T::history_components, History::history_columns>::size == 0, "Every history component must have a column in History::Epoch" );
 
 	mEntityTypeColorMap.emplace_back( T::kEntityType.value(), GetDebugColor<T>() );
 	mEntityTypeNameMap.emplace_back( T::kEntityType.value(), T::kEntityType.data() );
@@ -48,8 +63,7 @@ void Cyclone::Core::EntityContext::RegisterEntityClass()
 
 void Cyclone::Core::EntityContext::Register()
 {
-	RegisterEntityClass<Entity::PointDebug>();
-	RegisterEntityClass<Entity::InfoDebug>();
+	[this] <typename... Types>( entt::type_list<Types...> ) { ( RegisterEntityClass<Types>(), ... ); }( Entity::entity_classes{} );
 	
 	// Sort lists into entity order
 	std::stable_sort( mEntityTypeNameMap.begin(), mEntityTypeNameMap.end() );
@@ -63,14 +77,14 @@ void Cyclone::Core::EntityContext::Register()
 
 	// Create selection/visibility map for categories
 	for ( const auto &i : mEntityCategoryNameMap ) {
-		mEntityCategorySelectable.emplace_back( i.mKey, true );
-		mEntityCategoryVisible.emplace_back( i.mKey, true );
+		mContextFlags[static_cast<size_t>( History::Epoch::EContextKind::EntityCategorySelectable )].emplace_back( i.mKey, true );
+		mContextFlags[static_cast<size_t>( History::Epoch::EContextKind::EntityCategoryVisible )].emplace_back( i.mKey, true );
 	}
 
 	// Create selection/visibility map for types
 	for ( const auto &i : mEntityTypeNameMap ) {
-		mEntityTypeSelectable.emplace_back( i.mKey, true );
-		mEntityTypeVisible.emplace_back( i.mKey, true );
+		mContextFlags[static_cast<size_t>( History::Epoch::EContextKind::EntityTypeSelectable )].emplace_back( i.mKey, true );
+		mContextFlags[static_cast<size_t>( History::Epoch::EContextKind::EntityTypeVisible )].emplace_back( i.mKey, true );
 	}
 
 	// Create entity list for spawnable entities
@@ -89,60 +103,267 @@ void Cyclone::Core::EntityContext::Register()
 	std::stable_sort( mEntitiesBrushable.begin(), mEntitiesBrushable.end(), []( const auto &inLhs, const auto &inRhs ) { return std::strcmp( inLhs.mValue, inRhs.mValue ) < 0; } );
 }
 
-void Cyclone::Core::EntityContext::SetEntityTypeIsSelectable( Component::EntityType inType, bool inV )
+void Cyclone::Core::EntityContext::SetContextFlag( History::Epoch::EContextKind inKind, entt::id_type inKey, bool inV )
 {
-	auto currentValue = sFindIn( mEntityTypeSelectable, inType );
+	auto currentValue = sFindIn( mContextFlags[static_cast<size_t>( inKind )], inKey );
 	if ( *currentValue == inV ) return;
 
-	BeginAction();
-	entt::registry &currentTop = mUndoStack[mUndoStackEpoch + 1];
+	const bool ownsAction = CanAquireActionLock();
+	if ( ownsAction ) BeginAction();
 
-	currentTop.ctx().emplace_as<HashPair<bool>>( "entity_type_selectable"_hs, static_cast<entt::id_type>( inType ), inV );
+	mUndoStack.back()->RecordContextChange( inKind, inKey, *currentValue, inV );
 	*currentValue = inV;
 
-	EndAction();
+	if ( ownsAction ) EndAction();
 }
 
-void Cyclone::Core::EntityContext::SetEntityTypeIsVisible( Component::EntityType inType, bool inV )
+template<typename T>
+void Cyclone::Core::EntityContext::OnHistoryComponentChanged( entt::registry &, entt::entity inEntity )
 {
-	auto currentValue = sFindIn( mEntityTypeVisible, inType );
-	if ( *currentValue == inV ) return;
+	if ( !mDirtyEntities.contains( inEntity ) ) mDirtyEntities.push( inEntity );
 
-	BeginAction();
-	entt::registry &currentTop = mUndoStack[mUndoStackEpoch + 1];
+	entt::sparse_set &column = mDirtyColumns.mColumns[entt::type_list_index_v<T, History::history_columns>];
+	if ( !column.contains( inEntity ) ) column.push( inEntity );
+}
 
-	currentTop.ctx().emplace_as<HashPair<bool>>( "entity_type_visible"_hs, static_cast<entt::id_type>( inType ), inV );
-	*currentValue = inV;
+struct Cyclone::Core::EntityContext::ObserverFunctor
+{
+	template<typename T>
+	void Apply( entt::registry &ioRegistry, EntityContext &ioContext, bool inConnect ) const
+	{
+		if ( inConnect ) {
+			ioRegistry.on_construct<T>().template connect<&EntityContext::OnHistoryComponentChanged<T>>( ioContext );
+			ioRegistry.on_update<T>().template connect<&EntityContext::OnHistoryComponentChanged<T>>( ioContext );
+			ioRegistry.on_destroy<T>().template connect<&EntityContext::OnHistoryComponentChanged<T>>( ioContext );
+		}
+		else {
+			ioRegistry.on_construct<T>().template disconnect<&EntityContext::OnHistoryComponentChanged<T>>( ioContext );
+			ioRegistry.on_update<T>().template disconnect<&EntityContext::OnHistoryComponentChanged<T>>( ioContext );
+			ioRegistry.on_destroy<T>().template disconnect<&EntityContext::OnHistoryComponentChanged<T>>( ioContext );
+		}
+	}
+};
 
-	EndAction();
+void Cyclone::Core::EntityContext::TrackRegistry( entt::registry &inRegistry )
+{
+	assert( !mUndoStackLock && "Cannot change the tracked registry while stack lock is held!" );
+	mTrackedRegistry = &inRegistry;
 }
 
-void Cyclone::Core::EntityContext::SetEntityCategoryIsSelectable( Component::EntityCategory inType, bool inV )
+/// Identifies the layout of journal records, journals written by a build with other history columns are not replayed
+static uint64_t GetActionJournalLayout()
 {
-	auto currentValue = sFindIn( mEntityCategorySelectable, inType );
-	if ( *currentValue == inV ) return;
+	const auto columnTypes = [] <typename... Types>( entt::type_list<Types...> ) { return std::array<entt::id_type, sizeof...( Types )>{ entt::type_hash<Types>::value()... }; }( Cyclone::Core::History::history_columns{} );
 
-	BeginAction();
-	entt::registry &currentTop = mUndoStack[mUndoStackEpoch + 1];
+	const uint64_t sizesHash = Cyclone::Util::Fnv1a64( std::as_bytes( std::span( Cyclone::Core::History::kHistoryColumnSizes ) ) );
+	return Cyclone::Util::Fnv1a64( std::as_bytes( std::span( columnTypes ) ), sizesHash );
+}
 
-	currentTop.ctx().emplace_as<HashPair<bool>>( "entity_category_selectable"_hs, static_cast<entt::id_type>( inType ), inV );
-	*currentValue = inV;
+bool Cyclone::Core::EntityContext::OpenActionJournal( const std::filesystem::path &inPath, entt::registry &inRegistry, const LevelLoader &inLoadLevel )
+{
+	assert( !mUndoStackLock && "Cannot open the action journal while stack lock is held!" );
+	assert( mUndoStack.empty() && "The action journal must be opened before the first action!" );
 
-	EndAction();
+	if ( !mActionJournal.Open( inPath, GetActionJournalLayout() ) ) return false;
+
+	mUndoStackLock = std::unique_lock( mUndoStackMutex );
+
+	// Every entity the journal ever mentions, they must all stay reserved so their identifiers are not recycled
+	entt::sparse_set historyEntities;
+	size_t unboundedBytes = 0;
+	std::vector<size_t> undone, redone;
+
+	// Last level file the session loaded or saved, the recovered state is built on top of it
+	std::filesystem::path levelPath;
+	size_t levelEpoch = kNoEpoch;
+
+	// Only rebuild the stack here, the state is applied once at the end
+	mActionJournal.Replay( [&]( History::ActionJournal::ERecordKind inKind, std::span<const std::byte> inPayload ) {
+		switch ( inKind ) {
+			case History::ActionJournal::ERecordKind::Epoch:
+			{
+				std::unique_ptr<History::Epoch> epoch = mRecycler.Acquire();
+				if ( !epoch->DeserializeRecord( inPayload ) || epoch->GetEpochNumber() != mUndoStack.size() ) return false;
+
+				for ( const entt::entity entity : epoch->GetEntities() ) {
+					if ( !historyEntities.contains( entity ) ) historyEntities.push( entity );
+				}
+
+				// Each action branches off the epoch current when it was recorded
+				AddUndoNode( mUndoStackEpoch );
+				mUndoStackEpoch = epoch->GetEpochNumber();
+				mUndoStack.push_back( std::move( epoch ) );
+				MeasureEpoch( mUndoStackEpoch );
+
+				unboundedBytes += inPayload.size();
+				if ( unboundedBytes > mUndoMemoryBudget / 2 ) {
+					EnforceUndoMemoryBudget();
+					unboundedBytes = 0;
+				}
+				return true;
+			}
+			case History::ActionJournal::ERecordKind::Cursor:
+			{
+				Cyclone::Util::ByteReader reader( inPayload );
+				const auto target = reader.Read<uint64_t>();
+				if ( !reader.IsValid() || target >= mUndoStack.size() ) return false;
+
+				FindEpochPath( mUndoStackEpoch, static_cast<size_t>( target ), undone, redone );
+				FollowEpochPath( undone, redone );
+				mUndoStackEpoch = static_cast<Component::EpochNumber>( target );
+				return true;
+			}
+			case History::ActionJournal::ERecordKind::Level:
+			{
+				Cyclone::Util::ByteReader reader( inPayload );
+				const auto epoch = reader.Read<uint64_t>();
+				std::vector<char8_t> path;
+				reader.ReadSpan( path );
+				if ( !reader.IsValid() || epoch >= mUndoStack.size() ) return false;
+
+				levelPath = std::u8string( path.begin(), path.end() );
+				levelEpoch = static_cast<size_t>( epoch );
+				return true;
+			}
+		}
+		return false;
+	} );
+
+	if ( mUndoStack.empty() && levelPath.empty() ) {
+		mUndoStackLock.unlock();
+		return false;
+	}
+
+	if ( !levelPath.empty() ) {
+		if ( !inLoadLevel( levelPath, inRegistry ) ) {
+			// The recovered epochs are meaningless without the level they were recorded against
+			inRegistry.clear();
+			ClearHistory();
+			mActionJournal.Close( true );
+			mActionJournal.Open( inPath, GetActionJournalLayout() );
+			mUndoStackLock.unlock();
+			return false;
+		}
+
+		CopyCommittedState( inRegistry );
+		mSavedEpoch = levelEpoch;
+	}
+
+	// The net change of every epoch from the level to the cursor is the state at the cursor, each entity is written once
+	FindEpochPath( levelEpoch, mUndoStackEpoch, undone, redone );
+
+	std::unique_ptr<History::Epoch> state = mRecycler.Acquire();
+	MergeEpochPath( undone, redone, *state );
+	state->Apply( inRegistry, History::Epoch::ESide::After );
+	state->Apply( mCommittedRegistry, History::Epoch::ESide::After );
+	mRecycler.Recycle( std::move( state ) );
+
+	// Entities which do not exist at the cursor are left orphaned, as they would be after the original actions
+	for ( const entt::entity entity : historyEntities ) {
+		if ( !inRegistry.valid( entity ) ) {
+			auto retEntity = inRegistry.create( entity );
+			assert( retEntity == entity );
+		}
+
+		if ( !mCommittedRegistry.valid( entity ) ) {
+			auto retEntity = mCommittedRegistry.create( entity );
+			assert( retEntity == entity );
+		}
+	}
+
+	if ( !mUndoStack.empty() ) {
+		WriteCheckpointIfDue();
+		EnforceUndoMemoryBudget();
+	}
+	ReserveUndoGrowth();
+
+	mUndoStackLock.unlock();
+
+	// Flags are not stored in the level, so they are rebuilt from the start of the session
+	FindEpochPath( kNoEpoch, mUndoStackEpoch, undone, redone );
+	RestoreContextStatePath( undone, redone );
+
+	return true;
 }
 
-void Cyclone::Core::EntityContext::SetEntityCategoryIsVisible( Component::EntityCategory inType, bool inV )
+void Cyclone::Core::EntityContext::ResetHistory( const entt::registry &inRegistry, const std::filesystem::path &inLevelPath )
 {
-	auto currentValue = sFindIn( mEntityCategoryVisible, inType );
-	if ( *currentValue == inV ) return;
+	assert( !mUndoStackLock && "Cannot reset the history while stack lock is held!" );
+	mUndoStackLock = std::unique_lock( mUndoStackMutex );
 
-	BeginAction();
-	entt::registry &currentTop = mUndoStack[mUndoStackEpoch + 1];
+	ClearHistory();
 
-	currentTop.ctx().emplace_as<HashPair<bool>>( "entity_category_visible"_hs, static_cast<entt::id_type>( inType ), inV );
-	*currentValue = inV;
+	// A level with no file behind it, such as an imported one, has nothing crash recovery could reload
+	// Its entities are recorded as created by the first epoch instead, so replaying the journal starts from a full base
+	const auto *types = inRegistry.storage<Component::EntityType>();
+	const bool recordLevel = inLevelPath.empty() && types && !types->empty();
+	if ( !recordLevel ) CopyCommittedState( inRegistry );
+
+	// Records of the previous level can no longer be replayed
+	if ( mActionJournal.IsOpen() ) {
+		const std::filesystem::path journalPath = mActionJournal.GetPath();
+		mActionJournal.Close( true );
+		mActionJournal.Open( journalPath, GetActionJournalLayout() );
+	}
+
+	mUndoStackLock.unlock();
 
+	// The first epoch can never be undone, it keeps the level as it was loaded reachable
+	BeginAction();
+	if ( recordLevel ) {
+		for ( const entt::entity entity : static_cast<const entt::sparse_set &>( *types ) ) MarkDirty( entity );
+	}
 	EndAction();
+
+	if ( !inLevelPath.empty() ) MarkLevelSaved( inLevelPath );
+}
+
+void Cyclone::Core::EntityContext::MarkLevelSaved( const std::filesystem::path &inPath )
+{
+	assert( !mUndoStackLock && "Cannot mark the level saved while stack lock is held!" );
+	mSavedEpoch = mUndoStackEpoch;
+	JournalLevel( inPath );
+}
+
+void Cyclone::Core::EntityContext::SetStreamingLevel( bool inStreaming )
+{
+	assert( !mUndoStackLock && "Cannot change the streaming state while stack lock is held!" );
+	mStreamingLevel = inStreaming;
+}
+
+bool Cyclone::Core::EntityContext::GetEntitiesChangedSinceSave( std::vector<entt::entity> &outEntities )
+{
+	assert( !mUndoStackLock && "Cannot collect changes while stack lock is held!" );
+	outEntities.clear();
+	if ( mSavedEpoch == kNoEpoch ) return false;
+
+	mUndoStackLock = std::unique_lock( mUndoStackMutex );
+
+	std::vector<size_t> undone, redone;
+	FindEpochPath( mSavedEpoch, mUndoStackEpoch, undone, redone );
+
+	// Only the entities are needed, so the epochs are not merged
+	entt::sparse_set changed;
+	const auto addEpoch = [&]( size_t inEpoch ) {
+		History::Epoch &epochHistory = *mUndoStack[inEpoch];
+		const bool wasResident = epochHistory.IsResident();
+
+		epochHistory.PageIn( mUndoJournal );
+		for ( const entt::entity entity : epochHistory.GetEntities() ) {
+			if ( !changed.contains( entity ) ) changed.push( entity );
+		}
+
+		// Already journaled, so spilling again only frees the memory
+		if ( !wasResident ) epochHistory.Spill( mUndoJournal );
+	};
+
+	for ( const size_t epoch : undone ) addEpoch( epoch );
+	for ( const size_t epoch : redone ) addEpoch( epoch );
+
+	outEntities.assign( changed.begin(), changed.end() );
+
+	mUndoStackLock.unlock();
+	return true;
 }
 
 void Cyclone::Core::EntityContext::BeginAction()
@@ -150,197 +371,757 @@ void Cyclone::Core::EntityContext::BeginAction()
 	assert( !mUndoStackLock && "Cannot begin action while stack lock is held!" );
 	mUndoStackLock = std::unique_lock( mUndoStackMutex );
 
-	if ( mUndoStackEpoch + 1 != mUndoStack.size() ) {
-		mUndoStack.erase( mUndoStack.begin() + mUndoStackEpoch + 1, mUndoStack.end() );
+	// Nothing is discarded, the new epoch starts another branch if the current one has a redo
+	// Both only take capacity reserved by the previous action and an epoch from the pool, so nothing is allocated here
+	AddUndoNode( mUndoStackEpoch );
+	mUndoStack.push_back( mRecycler.Acquire() );
+	mStagingRegistry.clear();
+	mDirtyEntities.clear();
+	mWholeDirtyEntities.clear();
+	mDirtyColumns.Clear();
+
+	if ( mTrackedRegistry ) {
+		Cyclone::Util::ApplyOverTypeList<History::history_columns>( ObserverFunctor{}, *mTrackedRegistry, *this, true );
 	}
-
-	mUndoStack.emplace_back();
 }
 
 void Cyclone::Core::EntityContext::EndAction()
 {
 	assert( mUndoStackLock && "Cannot end action with no stack lock held!" );
-	mUndoStackLock.unlock();
 
-	mUndoStackEpoch = static_cast<Component::EpochNumber>( mUndoStackEpoch + 1 );
+	const auto start = std::chrono::steady_clock::now();
+	const auto nextEpoch = static_cast<Component::EpochNumber>( mUndoStack.size() - 1 );
+
+	if ( mTrackedRegistry ) {
+		Cyclone::Util::ApplyOverTypeList<History::history_columns>( ObserverFunctor{}, *mTrackedRegistry, *this, false );
+		StageDirtyEntities( *mTrackedRegistry );
+	}
+
+	// Pack the touched entities against their committed state, then commit them
+	History::Epoch &currentTop = *mUndoStack[nextEpoch];
+	currentTop.Build( mCommittedRegistry, mStagingRegistry, nextEpoch, &mDirtyColumns );
+	currentTop.Apply( mCommittedRegistry, History::Epoch::ESide::After );
+
+	if ( mActionJournal.IsOpen() ) {
+		mJournalRecord.clear();
+		currentTop.SerializeRecord( mJournalRecord );
+		mActionJournal.Append( History::ActionJournal::ERecordKind::Epoch, mJournalRecord );
+	}
+
+	// Only entities with an actual change are moved to the new epoch
+	if ( mTrackedRegistry ) {
+		for ( const entt::entity entity : mDirtyEntities ) {
+			const auto *committedEpoch = mCommittedRegistry.valid( entity ) ? mCommittedRegistry.try_get<Component::EpochNumber>( entity ) : nullptr;
+			if ( committedEpoch && *committedEpoch == nextEpoch && mTrackedRegistry->all_of<Component::EntityType>( entity ) ) {
+				mTrackedRegistry->emplace_or_replace<Component::EpochNumber>( entity, nextEpoch );
+			}
+		}
+	}
+
+	mUndoStackEpoch = nextEpoch;
+
+	MeasureEpoch( nextEpoch );
+	mUndoTree[nextEpoch].mStats.mRecordMilliseconds = MillisecondsSince( start );
+
+	WriteCheckpointIfDue();
+	EnforceUndoMemoryBudget();
+	ReserveUndoGrowth();
+
+	mUndoStackLock.unlock();
 }
 
 void Cyclone::Core::EntityContext::UndoAction( entt::registry &inRegistry )
 {
-	if ( mUndoStackEpoch == 0 ) return;
+	if ( mUndoStack.empty() || mUndoTree[mUndoStackEpoch].mParent == kNoEpoch ) return;
 
 	assert( !mUndoStackLock && "Cannot undo action while stack lock is held!" );
 	mUndoStackLock = std::unique_lock( mUndoStackMutex );
 
-	RestoreContextStatePreUndo();
+	const auto start = std::chrono::steady_clock::now();
+	const size_t undoneEpoch = mUndoStackEpoch;
+	ApplyContextChanges( *mUndoStack[mUndoStackEpoch], History::Epoch::ESide::Before );
 
-	// TODO: fix when no EpochNumber present
-	const entt::registry &currentTop = mUndoStack[mUndoStackEpoch];
-	const auto &currentTopView = currentTop.view<Component::EpochNumber>();
+	const History::Epoch &currentTop = PageInEpoch( mUndoStackEpoch );
+	currentTop.Apply( inRegistry, History::Epoch::ESide::Before );
+	currentTop.Apply( mCommittedRegistry, History::Epoch::ESide::Before );
 
-	for ( const entt::entity entity : currentTopView ) {
-		size_t lastModifiedEpochIdx = currentTopView.get<Component::EpochNumber>( entity );
+	const size_t parent = mUndoTree[mUndoStackEpoch].mParent;
+	mUndoTree[parent].mRedoChild = mUndoStackEpoch;
+	mUndoStackEpoch = static_cast<Component::EpochNumber>( parent );
 
-		const entt::registry &lastModifiedEpochRegistry = mUndoStack[lastModifiedEpochIdx];
+	JournalCursor();
+	EnforceUndoMemoryBudget();
 
-		// TODO: fix in case of transmutation (no idea how, fuck it we ball)
-		// TODO: do we get current type, or previous type?
-		const auto previousType = static_cast<entt::id_type>( lastModifiedEpochRegistry.get<Component::EntityType>( entity ) );
-		entt::resolve( mEntityMetaContext, previousType ).func( "restore_history"_hs ).invoke( {}, entt::forward_as_meta( inRegistry ), entt::forward_as_meta( lastModifiedEpochRegistry ), entity );
-		inRegistry.emplace_or_replace<Component::EpochNumber>( entity, static_cast<Component::EpochNumber>( lastModifiedEpochIdx ) );
-	}
+	mUndoStackLock.unlock();
 
-	const auto &currentTopViewDelete = currentTop.view<Component::EntityType>( entt::exclude<Component::EpochNumber> );
-	for ( const entt::entity entity : currentTopViewDelete ) {
-		inRegistry.destroy( entity );
+	EpochStats &stats = mUndoTree[undoneEpoch].mStats;
+	stats.mRestoreMilliseconds = MillisecondsSince( start );
+	++stats.mRestoreCount;
+}
 
-		entt::entity created = inRegistry.create( entity );
-		assert( created == entity );
-	}
+void Cyclone::Core::EntityContext::RedoAction( entt::registry & inRegistry )
+{
+	const size_t redoEpoch = mUndoStack.empty() ? kNoEpoch : mUndoTree[mUndoStackEpoch].mRedoChild;
+	if ( redoEpoch == kNoEpoch ) return;
+
+	assert( !mUndoStackLock && "Cannot redo action while stack lock is held!" );
+	mUndoStackLock = std::unique_lock( mUndoStackMutex );
+
+	const auto start = std::chrono::steady_clock::now();
+	const History::Epoch &nextTop = PageInEpoch( redoEpoch );
+	nextTop.Apply( inRegistry, History::Epoch::ESide::After );
+	nextTop.Apply( mCommittedRegistry, History::Epoch::ESide::After );
+
+	mUndoStackEpoch = static_cast<Component::EpochNumber>( redoEpoch );
+
+	JournalCursor();
+	EnforceUndoMemoryBudget();
 
 	mUndoStackLock.unlock();
 
-	mUndoStackEpoch = static_cast<Component::EpochNumber>( mUndoStackEpoch - 1 );
+	ApplyContextChanges( *mUndoStack[redoEpoch], History::Epoch::ESide::After );
 
-	RestoreContextStatePostAction();
+	EpochStats &stats = mUndoTree[redoEpoch].mStats;
+	stats.mRestoreMilliseconds = MillisecondsSince( start );
+	++stats.mRestoreCount;
 }
 
-void Cyclone::Core::EntityContext::RedoAction( entt::registry & inRegistry )
+void Cyclone::Core::EntityContext::JumpToEpoch( size_t inTarget, entt::registry &inRegistry )
 {
-	if ( mUndoStackEpoch + 1 >= mUndoStack.size() ) return;
+	if ( inTarget >= mUndoStack.size() || inTarget == mUndoStackEpoch ) return;
 
-	assert( !mUndoStackLock && "Cannot redo action while stack lock is held!" );
+	assert( !mUndoStackLock && "Cannot jump to epoch while stack lock is held!" );
 	mUndoStackLock = std::unique_lock( mUndoStackMutex );
 
-	size_t nextTopEpoch = mUndoStackEpoch + 1;
+	const auto start = std::chrono::steady_clock::now();
+
+	// Up to the common ancestor of both branches, then down to the target
+	std::vector<size_t> undone, redone;
+	FindEpochPath( mUndoStackEpoch, inTarget, undone, redone );
+
+	// Rows touched when replaying the path directly, compared against restoring the closest checkpoint
+	const auto countRows = [this]( const std::vector<size_t> &inEpochs ) {
+		size_t rows = 0;
+		for ( const size_t epoch : inEpochs ) rows += mUndoStack[epoch]->GetEntityCount();
+		return rows;
+	};
+	const size_t directRows = countRows( undone ) + countRows( redone );
+
+	size_t bestCheckpoint = mUndoCheckpoints.size();
+	size_t bestCheckpointRows = directRows;
+	std::vector<size_t> checkpointUndone, checkpointRedone;
+	for ( size_t index = 0; index < mUndoCheckpoints.size(); ++index ) {
+		size_t rows = mUndoCheckpoints[index].GetEntityCount() + mCommittedRegistry.storage<Component::EntityType>().size();
+		if ( rows >= bestCheckpointRows ) continue;
+
+		FindEpochPath( mUndoCheckpoints[index].GetEpochNumber(), inTarget, checkpointUndone, checkpointRedone );
+		rows += countRows( checkpointUndone ) + countRows( checkpointRedone );
+
+		if ( rows < bestCheckpointRows ) {
+			bestCheckpoint = index;
+			bestCheckpointRows = rows;
+		}
+	}
 
-	const entt::registry &nextTop = mUndoStack[nextTopEpoch];
+	if ( bestCheckpoint < mUndoCheckpoints.size() ) {
+		RestoreCheckpoint( bestCheckpoint, inTarget, inRegistry );
+	}
+	else {
+		// Fold the whole path into its net change, so each entity is only restored once
+		std::unique_ptr<History::Epoch> netChange = mRecycler.Acquire();
+		MergeEpochPath( undone, redone, *netChange );
+		netChange->Apply( inRegistry, History::Epoch::ESide::After );
+		netChange->Apply( mCommittedRegistry, History::Epoch::ESide::After );
+		mRecycler.Recycle( std::move( netChange ) );
+	}
+
+	FollowEpochPath( undone, redone );
+	mUndoStackEpoch = static_cast<Component::EpochNumber>( inTarget );
+
+	JournalCursor();
+	EnforceUndoMemoryBudget();
+
+	mUndoStackLock.unlock();
+
+	RestoreContextStatePath( undone, redone );
+
+	// The whole jump is charged to the target, whichever epochs it went through
+	EpochStats &stats = mUndoTree[inTarget].mStats;
+	stats.mRestoreMilliseconds = MillisecondsSince( start );
+	++stats.mRestoreCount;
+}
+
+void Cyclone::Core::EntityContext::SetUndoMemoryBudget( size_t inBytes )
+{
+	mUndoMemoryBudget = inBytes;
+
+	if ( CanAquireActionLock() ) {
+		mUndoStackLock = std::unique_lock( mUndoStackMutex );
+		EnforceUndoMemoryBudget();
+		mUndoStackLock.unlock();
+	}
+}
+
+size_t Cyclone::Core::EntityContext::GetUndoMemoryUsage() const
+{
+	size_t bytes = 0;
+	for ( const std::unique_ptr<History::Epoch> &epoch : mUndoStack ) {
+		bytes += epoch->GetMemoryUsage();
+	}
+	for ( const History::Epoch &checkpoint : mUndoCheckpoints ) {
+		bytes += checkpoint.GetMemoryUsage();
+	}
+	return bytes;
+}
+
+void Cyclone::Core::EntityContext::ReserveUndoGrowth()
+{
+	if ( mUndoStack.size() < mUndoStack.capacity() && mUndoTree.size() < mUndoTree.capacity() ) return;
+
+	const size_t capacity = std::max( 2 * mUndoStack.size(), kUndoReserveEpochs );
+	mUndoStack.reserve( capacity );
+	mUndoTree.reserve( capacity );
+}
+
+void Cyclone::Core::EntityContext::AddUndoNode( size_t inParent )
+{
+	UndoNode &node = mUndoTree.emplace_back();
+	node.mParent = inParent;
+
+	if ( inParent != kNoEpoch ) {
+		mUndoTree[inParent].mRedoChild = mUndoTree.size() - 1;
+		++mUndoTree[inParent].mChildCount;
+	}
+}
 
-	// TODO: fix when no EpochNumber present
-	const auto &nextTopView = nextTop.view<Component::EntityType>();
+void Cyclone::Core::EntityContext::CompactHistory()
+{
+	if ( !CanAquireActionLock() ) return;
+	mUndoStackLock = std::unique_lock( mUndoStackMutex );
 
-	for ( const entt::entity entity : nextTopView ) {
-		// TODO: fix in case of transmutation (no idea how, fuck it we ball)
-		// TODO: do we get current type, or previous type?
-		const auto nextType = static_cast<entt::id_type>( nextTopView.get<Component::EntityType>( entity ) );
-		entt::resolve( mEntityMetaContext, nextType ).func( "restore_history"_hs ).invoke( {}, entt::forward_as_meta( inRegistry ), entt::forward_as_meta( nextTop ), entity );
-		inRegistry.emplace_or_replace<Component::EpochNumber>( entity, static_cast<Component::EpochNumber>( nextTopEpoch ) );
+	if ( auto result = mCompactor.TakeResult() ) {
+		InstallCompaction( *result );
 	}
 
-	const auto nextTopDeletedView = nextTop.view<Component::EpochNumber>( entt::exclude<Component::EntityType> );
+	std::vector<size_t> run;
+	if ( !mCompactor.IsBusy() && FindCompactionRun( run ) ) {
+		// Paged in up front, the worker only ever reads them
+		std::vector<const History::Epoch *> epochs;
+		for ( const size_t epoch : run ) {
+			mUndoTree[epoch].mPinned = true;
+			epochs.push_back( &PageInEpoch( epoch ) );
+		}
 
-	for ( const entt::entity entity : nextTopDeletedView ) {
-		// Ensure entity stays orphaned, not deleted
-		inRegistry.destroy( entity );
-		entt::entity created = inRegistry.create( entity );
-		assert( created == entity );
+		mCompactor.Submit( std::move( run ), std::move( epochs ) );
 	}
 
 	mUndoStackLock.unlock();
+}
+
+bool Cyclone::Core::EntityContext::FindCompactionRun( std::vector<size_t> &outRun )
+{
+	if ( mUndoStack.size() <= kCompactionMinAge ) return false;
+	const size_t youngEpoch = mUndoStack.size() - kCompactionMinAge;
+
+	for ( ; mCompactionScan < youngEpoch; ++mCompactionScan ) {
+		outRun.clear();
 
-	mUndoStackEpoch = static_cast<Component::EpochNumber>( mUndoStackEpoch + 1 );
+		size_t runBytes = 0;
+		bool mayGrow = false;
 
-	RestoreContextStatePostAction();
+		// Follow the only child of each epoch, the last epoch of a run may branch, hold a checkpoint or be saved
+		for ( size_t epoch = mCompactionScan; outRun.size() < kCompactionMaxRun; epoch = mUndoTree[epoch].mRedoChild ) {
+			if ( epoch >= youngEpoch || epoch == mUndoStackEpoch ) {
+				// Too young or current for now, the run may still grow later
+				mayGrow = true;
+				break;
+			}
+
+			const UndoNode &node = mUndoTree[epoch];
+			const History::Epoch &epochHistory = *mUndoStack[epoch];
+			if ( node.mCompacted || runBytes + epochHistory.GetPayloadSize() > kCompactionMaxBytes ) break;
+
+			outRun.push_back( epoch );
+			runBytes += epochHistory.GetPayloadSize();
+
+			if ( node.mChildCount != 1 || node.mCheckpoint != kNoCheckpoint || epoch == mSavedEpoch ) break;
+		}
+
+		if ( outRun.size() >= 2 ) {
+			// The merged epoch is scanned again, so it keeps absorbing its successors up to the byte limit
+			mCompactionScan = outRun.back();
+			return true;
+		}
+
+		if ( mayGrow ) break;
+	}
+
+	outRun.clear();
+	return false;
 }
 
-entt::entity Cyclone::Core::EntityContext::CreateEntity( entt::id_type inType, entt::registry &inRegistry, const Cyclone::Math::Vector4D inPosition )
+void Cyclone::Core::EntityContext::InstallCompaction( History::EpochCompactor::Result &ioResult )
 {
-	assert( mUndoStackLock && "Can only create entities within Begin()/End()" );
+	const std::vector<size_t> &run = ioResult.mRun;
+	for ( const size_t epoch : run ) {
+		mUndoTree[epoch].mPinned = false;
+	}
 
-	size_t epochToUpdate = mUndoStackEpoch + 1;
+	// Dropped if the cursor, a new branch or a save moved into the run while it was merged
+	for ( size_t index = 0; index + 1 < run.size(); ++index ) {
+		if ( run[index] == mUndoStackEpoch || run[index] == mSavedEpoch || mUndoTree[run[index]].mChildCount != 1 ) return;
+	}
 
-	auto type = entt::resolve( mEntityMetaContext, inType );
-	if ( !type ) {
-		assert( !"Failed to create entity: unknown type" );
-		return entt::null;
+	// The merged epoch takes the place of the last one, linked to the parent of the first
+	const size_t parent = mUndoTree[run.front()].mParent;
+	mUndoTree[run.back()].mParent = parent;
+	if ( parent != kNoEpoch && mUndoTree[parent].mRedoChild == run.front() ) {
+		mUndoTree[parent].mRedoChild = run.back();
 	}
 
-	auto func = type.func( "create_entity"_hs );
-	if ( !func ) {
-		assert( !"Failed to create entity: type has no create_entity function" );
-		return entt::null;
+	double recordMilliseconds = 0.0;
+	for ( const size_t epoch : run ) recordMilliseconds += mUndoTree[epoch].mStats.mRecordMilliseconds;
+
+	for ( size_t index = 0; index + 1 < run.size(); ++index ) {
+		UndoNode &node = mUndoTree[run[index]];
+		node = UndoNode{};
+		node.mCompacted = true;
+		mRecycler.Recycle( std::exchange( mUndoStack[run[index]], std::make_unique<History::Epoch>() ) );
 	}
 
-	auto result = func.invoke( {}, entt::forward_as_meta( inRegistry ), entt::forward_as_meta( inPosition ) );
-	if ( !result ) {
-		assert( !"Failed to create entity: type has incorrect create_entity function, please report!" );
-		return entt::null;
+	// The replaced epochs can be large, they are freed on the recycler instead of here
+	std::swap( *mUndoStack[run.back()], ioResult.mEpoch );
+	mRecycler.Destroy( std::move( ioResult.mEpoch ) );
+
+	MeasureEpoch( run.back() );
+	mUndoTree[run.back()].mStats.mRecordMilliseconds = recordMilliseconds;
+	mUndoTree[run.back()].mStats.mRestoreCount = 0;
+	mUndoTree[run.back()].mStats.mRestoreMilliseconds = 0.0;
+}
+
+void Cyclone::Core::EntityContext::FindEpochPath( size_t inFrom, size_t inTo, std::vector<size_t> &outUndone, std::vector<size_t> &outRedone ) const
+{
+	outUndone.clear();
+	outRedone.clear();
+
+	// Parents are always created before their children, so the later of both can never be the common ancestor
+	// kNoEpoch stands above the first epoch and is the common ancestor of everything
+	size_t from = inFrom;
+	size_t to = inTo;
+	while ( from != to ) {
+		if ( to == kNoEpoch || ( from != kNoEpoch && from > to ) ) {
+			outUndone.push_back( from );
+			from = mUndoTree[from].mParent;
+		}
+		else {
+			outRedone.push_back( to );
+			to = mUndoTree[to].mParent;
+		}
 	}
 
-	entt::entity entity = result.cast<entt::entity>();
+	std::reverse( outRedone.begin(), outRedone.end() );
+}
 
-	type.func( "save_history"_hs ).invoke( {}, entt::forward_as_meta( inRegistry ), entt::forward_as_meta( mUndoStack[epochToUpdate] ), entity);
-	inRegistry.emplace_or_replace<Component::EpochNumber>( entity, static_cast<Component::EpochNumber>( epochToUpdate ) );
+void Cyclone::Core::EntityContext::FollowEpochPath( const std::vector<size_t> &inUndone, const std::vector<size_t> &inRedone )
+{
+	// Redo returns towards the branch which was left, unless the path continues down another one
+	for ( const size_t epoch : inUndone ) {
+		const size_t parent = mUndoTree[epoch].mParent;
+		if ( parent != kNoEpoch ) mUndoTree[parent].mRedoChild = epoch;
+	}
 
-	return entity;
+	for ( const size_t epoch : inRedone ) {
+		const size_t parent = mUndoTree[epoch].mParent;
+		if ( parent != kNoEpoch ) mUndoTree[parent].mRedoChild = epoch;
+	}
 }
 
-void Cyclone::Core::EntityContext::UpdateEntity( entt::entity inEntity, entt::registry &inRegistry )
+void Cyclone::Core::EntityContext::RestoreContextStatePath( const std::vector<size_t> &inUndone, const std::vector<size_t> &inRedone )
 {
-	assert( mUndoStackLock && "Can only update entities within Begin()/End()" );
+	for ( const size_t epoch : inUndone ) {
+		ApplyContextChanges( *mUndoStack[epoch], History::Epoch::ESide::Before );
+	}
 
-	size_t epochToUpdate = mUndoStackEpoch + 1;
+	for ( const size_t epoch : inRedone ) {
+		ApplyContextChanges( *mUndoStack[epoch], History::Epoch::ESide::After );
+	}
+}
 
-	const auto type = static_cast<entt::id_type>( inRegistry.get<Component::EntityType>( inEntity ) );
+void Cyclone::Core::EntityContext::JournalCursor()
+{
+	if ( !mActionJournal.IsOpen() ) return;
 
-	entt::resolve( mEntityMetaContext, type ).func( "save_history"_hs ).invoke( {}, entt::forward_as_meta( inRegistry ), entt::forward_as_meta( mUndoStack[epochToUpdate] ), inEntity );
-	mUndoStack[epochToUpdate].emplace_or_replace<Component::EpochNumber>( inEntity, inRegistry.get<Component::EpochNumber>( inEntity ) );
-	inRegistry.emplace_or_replace<Component::EpochNumber>( inEntity, static_cast<Component::EpochNumber>( epochToUpdate ) );
+	mJournalRecord.clear();
+	Cyclone::Util::ByteWriter writer( mJournalRecord );
+	writer.Write( static_cast<uint64_t>( mUndoStackEpoch ) );
+	mActionJournal.Append( History::ActionJournal::ERecordKind::Cursor, mJournalRecord );
 }
 
-void Cyclone::Core::EntityContext::DeleteEntity( entt::entity inEntity, entt::registry & inRegistry )
+void Cyclone::Core::EntityContext::JournalLevel( const std::filesystem::path &inPath )
 {
-	assert( mUndoStackLock && "Can only delete entities within Begin()/End()" );
+	if ( !mActionJournal.IsOpen() ) return;
 
-	size_t epochToUpdate = mUndoStackEpoch + 1;
+	const std::u8string path = inPath.u8string();
 
-	entt::registry &currentTop = mUndoStack[epochToUpdate]; 
+	mJournalRecord.clear();
+	Cyclone::Util::ByteWriter writer( mJournalRecord );
+	writer.Write( static_cast<uint64_t>( mUndoStackEpoch ) );
+	writer.WriteSpan( std::span<const char8_t>( path ) );
+	mActionJournal.Append( History::ActionJournal::ERecordKind::Level, mJournalRecord );
+}
 
-	// Create in undo stack if non existent
-	if ( !currentTop.valid( inEntity ) ) {
-		auto retEntity = currentTop.create( inEntity );
-		assert( retEntity == inEntity );
+void Cyclone::Core::EntityContext::ClearHistory()
+{
+	assert( mUndoStackLock && "Cannot clear the history with no stack lock held!" );
+
+	// The compactor reads the epochs being dropped
+	mCompactor.Cancel();
+
+	mRecycler.Destroy( std::move( mUndoStack ) );
+	mUndoStack.clear();
+	mRecycler.Destroy( std::move( mUndoCheckpoints ) );
+	mUndoCheckpoints.clear();
+	mUndoTree.clear();
+	ReserveUndoGrowth();
+	mUndoJournal.Clear();
+	mCompactionScan = 0;
+	mSavedEpoch = kNoEpoch;
+	mStreamingLevel = false;
+	mUndoStackEpoch = Component::EpochNumber::Sentinel;
+
+	mRecycler.Destroy( std::move( mCommittedRegistry ) );
+	mCommittedRegistry = entt::registry{};
+
+	mStagingRegistry.clear();
+	mDirtyEntities.clear();
+	mWholeDirtyEntities.clear();
+	mDirtyColumns.Clear();
+}
+
+struct CopyStorageFunctor
+{
+	template<typename T>
+	void Apply( const entt::registry &inSource, entt::registry &ioTarget ) const
+	{
+		const auto *source = inSource.storage<T>();
+		if ( !source || source->empty() ) return;
+
+		const entt::sparse_set &base = *source;
+		ioTarget.storage<T>().insert( base.begin(), base.end(), source->begin() );
 	}
+};
 
-	// Only provide epoch number
-	mUndoStack[epochToUpdate].emplace_or_replace<Component::EpochNumber>( inEntity, inRegistry.get<Component::EpochNumber>( inEntity ) );
+void Cyclone::Core::EntityContext::CopyCommittedState( const entt::registry &inRegistry )
+{
+	assert( mCommittedRegistry.storage<entt::entity>().empty() && "Committed state must be cleared before it is copied!" );
 
-	// Ensure entity stays orphaned, not deleted
-	inRegistry.destroy( inEntity );
-	entt::entity created = inRegistry.create( inEntity );
-	assert( created == inEntity );
+	// Every identifier stays reserved, including orphans left behind by earlier actions
+	for ( const auto [entity] : inRegistry.storage<entt::entity>()->each() ) {
+		auto retEntity = mCommittedRegistry.create( entity );
+		assert( retEntity == entity );
+	}
+
+	Cyclone::Util::ApplyOverTypeList<History::history_columns>( CopyStorageFunctor{}, inRegistry, mCommittedRegistry );
+
+	// Nothing has been recorded against the copied entities yet
+	auto &epochs = mCommittedRegistry.storage<Component::EpochNumber>();
+	for ( const entt::entity entity : mCommittedRegistry.view<Component::EntityType>() ) {
+		epochs.emplace( entity, Component::EpochNumber::Sentinel );
+	}
+}
+
+struct CopyStreamedFunctor
+{
+	template<typename T>
+	void Apply( const entt::registry &inSource, std::span<const entt::entity> inEntities, entt::registry &ioTarget ) const
+	{
+		const auto *source = inSource.storage<T>();
+		if ( !source ) return;
+
+		auto &target = ioTarget.storage<T>();
+		for ( const entt::entity entity : inEntities ) {
+			if ( source->contains( entity ) ) target.emplace( entity, source->get( entity ) );
+		}
+	}
+};
+
+void Cyclone::Core::EntityContext::CommitStreamedEntities( const entt::registry &inRegistry, std::span<const entt::entity> inEntities )
+{
+	assert( !mUndoStackLock && "Cannot commit streamed entities while stack lock is held!" );
+	std::lock_guard lock( mUndoStackMutex );
+
+	Cyclone::Util::ApplyOverTypeList<History::history_columns>( CopyStreamedFunctor{}, inRegistry, inEntities, mCommittedRegistry );
+
+	auto &epochs = mCommittedRegistry.storage<Component::EpochNumber>();
+	const auto *types = inRegistry.storage<Component::EntityType>();
+	for ( const entt::entity entity : inEntities ) {
+		assert( mCommittedRegistry.valid( entity ) && "Streamed entities must be reserved before the history is reset!" );
+		if ( types && types->contains( entity ) ) epochs.emplace( entity, Component::EpochNumber::Sentinel );
+	}
+}
+
+void Cyclone::Core::EntityContext::MeasureEpoch( size_t inEpoch )
+{
+	const History::Epoch &epoch = *mUndoStack[inEpoch];
+	EpochStats &stats = mUndoTree[inEpoch].mStats;
+
+	stats.mEntityCount = epoch.GetEntityCount();
+	stats.mPayloadBytes = epoch.GetPayloadSize();
+	for ( size_t index = 0; index < History::history_columns::size; ++index ) {
+		stats.mColumnBytes[index] = epoch.GetColumnPayloadSize( index );
+	}
 }
 
-void Cyclone::Core::EntityContext::RestoreContextStatePreUndo()
+void Cyclone::Core::EntityContext::MergeEpochPath( const std::vector<size_t> &inUndone, const std::vector<size_t> &inRedone, History::Epoch &outEpoch )
 {
-	const entt::registry &currentTop = mUndoStack[mUndoStackEpoch];
+	History::EpochMerger merger;
+	const auto addEpoch = [&]( size_t inEpoch, bool inInverse ) {
+		History::Epoch &epochHistory = *mUndoStack[inEpoch];
+		const bool wasResident = epochHistory.IsResident();
 
-	const auto entityTypeSelectableCtx = currentTop.ctx().find<HashPair<bool>>( "entity_type_selectable"_hs );
-	if ( entityTypeSelectableCtx ) *sFindIn( mEntityTypeSelectable, entityTypeSelectableCtx->mKey ) = !entityTypeSelectableCtx->mValue;
+		epochHistory.PageIn( mUndoJournal );
+		merger.Add( epochHistory, inInverse );
 
-	const auto entityTypeVisibleCtx = currentTop.ctx().find<HashPair<bool>>( "entity_type_visible"_hs );
-	if ( entityTypeVisibleCtx ) *sFindIn( mEntityTypeVisible, entityTypeVisibleCtx->mKey ) = !entityTypeVisibleCtx->mValue;
+		// Already journaled, so spilling again only frees the memory
+		if ( !wasResident ) epochHistory.Spill( mUndoJournal );
+	};
 
-	const auto entityCategorySelectableCtx = currentTop.ctx().find<HashPair<bool>>( "entity_category_selectable"_hs );
-	if ( entityCategorySelectableCtx ) *sFindIn( mEntityCategorySelectable, entityCategorySelectableCtx->mKey ) = !entityCategorySelectableCtx->mValue;
+	for ( const size_t epoch : inUndone ) addEpoch( epoch, true );
+	for ( const size_t epoch : inRedone ) addEpoch( epoch, false );
 
-	const auto entityCategoryVisibleCtx = currentTop.ctx().find<HashPair<bool>>( "entity_category_visible"_hs );
-	if ( entityCategoryVisibleCtx ) *sFindIn( mEntityCategoryVisible, entityCategoryVisibleCtx->mKey ) = !entityCategoryVisibleCtx->mValue;
+	merger.Build( outEpoch );
+	mRecycler.Destroy( std::move( merger ) );
 }
 
-void Cyclone::Core::EntityContext::RestoreContextStatePostAction()
+void Cyclone::Core::EntityContext::WriteCheckpointIfDue()
 {
-	const auto &newTop = mUndoStack[mUndoStackEpoch];
+	if ( mStreamingLevel ) return;
 
-	const auto entityTypeSelectableCtx = newTop.ctx().find<HashPair<bool>>( "entity_type_selectable"_hs );
-	if ( entityTypeSelectableCtx ) *sFindIn( mEntityTypeSelectable, entityTypeSelectableCtx->mKey ) = entityTypeSelectableCtx->mValue;
+	// Distance to the closest checkpoint above the current epoch, on its own branch
+	size_t epochs = 0;
+	size_t deltaBytes = 0;
+	for ( size_t epoch = mUndoStackEpoch; mUndoTree[epoch].mCheckpoint == kNoCheckpoint; epoch = mUndoTree[epoch].mParent ) {
+		if ( mUndoTree[epoch].mParent == kNoEpoch ) return;
 
-	const auto entityTypeVisibleCtx = newTop.ctx().find<HashPair<bool>>( "entity_type_visible"_hs );
-	if ( entityTypeVisibleCtx ) *sFindIn( mEntityTypeVisible, entityTypeVisibleCtx->mKey ) = entityTypeVisibleCtx->mValue;
+		++epochs;
+		deltaBytes += mUndoStack[epoch]->GetPayloadSize();
+		if ( epochs >= kUndoCheckpointInterval || deltaBytes >= kUndoCheckpointDeltaBytes ) break;
+	}
 
-	const auto entityCategorySelectableCtx = newTop.ctx().find<HashPair<bool>>( "entity_category_selectable"_hs );
-	if ( entityCategorySelectableCtx ) *sFindIn( mEntityCategorySelectable, entityCategorySelectableCtx->mKey ) = entityCategorySelectableCtx->mValue;
+	if ( epochs < kUndoCheckpointInterval && deltaBytes < kUndoCheckpointDeltaBytes ) return;
 
-	const auto entityCategoryVisibleCtx = newTop.ctx().find<HashPair<bool>>( "entity_category_visible"_hs );
-	if ( entityCategoryVisibleCtx ) *sFindIn( mEntityCategoryVisible, entityCategoryVisibleCtx->mKey ) = entityCategoryVisibleCtx->mValue;
+	// Every committed entity as created, so the checkpoint alone rebuilds the state at this epoch
+	const entt::registry emptyRegistry;
+	History::Epoch &checkpoint = mUndoCheckpoints.emplace_back();
+	checkpoint.Build( emptyRegistry, mCommittedRegistry, mUndoStackEpoch );
+	mUndoTree[mUndoStackEpoch].mCheckpoint = mUndoCheckpoints.size() - 1;
+
+	// Only needed for long jumps, so it goes straight to the journal
+	checkpoint.Spill( mUndoJournal );
 }
+
+void Cyclone::Core::EntityContext::RestoreCheckpoint( size_t inCheckpoint, size_t inTarget, entt::registry &inRegistry )
+{
+	History::Epoch &checkpoint = mUndoCheckpoints[inCheckpoint];
+	const size_t checkpointEpoch = checkpoint.GetEpochNumber();
+
+	// Rebuild the state at the target epoch from the checkpoint and the few epochs between them
+	entt::registry targetRegistry;
+	{
+		const bool wasResident = checkpoint.IsResident();
+		checkpoint.PageIn( mUndoJournal );
+		checkpoint.Apply( targetRegistry, History::Epoch::ESide::After );
+		if ( !wasResident ) checkpoint.Spill( mUndoJournal );
+	}
+
+	if ( inTarget != checkpointEpoch ) {
+		std::vector<size_t> undone, redone;
+		FindEpochPath( checkpointEpoch, inTarget, undone, redone );
+
+		std::unique_ptr<History::Epoch> netChange = mRecycler.Acquire();
+		MergeEpochPath( undone, redone, *netChange );
+		netChange->Apply( targetRegistry, History::Epoch::ESide::After );
+		mRecycler.Recycle( std::move( netChange ) );
+	}
+
+	// Entities which do not exist at the target epoch must show up as deleted
+	for ( const entt::entity entity : mCommittedRegistry.view<Component::EntityType>() ) {
+		if ( !targetRegistry.valid( entity ) ) {
+			auto retEntity = targetRegistry.create( entity );
+			assert( retEntity == entity );
+		}
+	}
+
+	// Only what differs from the committed state is written
+	std::unique_ptr<History::Epoch> difference = mRecycler.Acquire();
+	difference->Build( mCommittedRegistry, targetRegistry, static_cast<Component::EpochNumber>( inTarget ) );
+	difference->Apply( inRegistry, History::Epoch::ESide::After );
+	difference->Apply( mCommittedRegistry, History::Epoch::ESide::After );
+
+	// Holds the whole state at the target epoch, freeing it would stall the jump
+	mRecycler.Recycle( std::move( difference ) );
+	mRecycler.Destroy( std::move( targetRegistry ) );
+}
+
+Cyclone::Core::History::Epoch &Cyclone::Core::EntityContext::PageInEpoch( size_t inEpoch )
+{
+	History::Epoch &epoch = *mUndoStack[inEpoch];
+	epoch.PageIn( mUndoJournal );
+	return epoch;
+}
+
+void Cyclone::Core::EntityContext::EnforceUndoMemoryBudget()
+{
+	assert( mUndoStackLock && "Cannot spill history with no stack lock held!" );
+
+	size_t residentBytes = GetUndoMemoryUsage();
+	if ( residentBytes <= mUndoMemoryBudget ) return;
+
+	// Epoch numbers say nothing about distance once the history branches, so the current path is walked through the tree instead
+	// Its ancestors are applied by the next undos, nearest first, and its chain of redo children by the next redos
+	const size_t currentEpoch = mUndoStackEpoch;
+	std::vector<bool> isOnPath( mUndoStack.size(), false );
+	std::vector<size_t> undoPath;
+	std::vector<size_t> redoPath;
+	isOnPath[currentEpoch] = true;
+	for ( size_t epoch = mUndoTree[currentEpoch].mParent; epoch != kNoEpoch; epoch = mUndoTree[epoch].mParent ) {
+		isOnPath[epoch] = true;
+		undoPath.push_back( epoch );
+	}
+	for ( size_t epoch = mUndoTree[currentEpoch].mRedoChild; epoch != kNoEpoch; epoch = mUndoTree[epoch].mRedoChild ) {
+		isOnPath[epoch] = true;
+		redoPath.push_back( epoch );
+	}
+
+	// Cleared once the budget is met, or once the journal fails to take an epoch
+	bool isSpilling = true;
+	const auto spill = [&]( size_t inEpoch ) {
+		History::Epoch &epoch = *mUndoStack[inEpoch];
+		if ( mUndoTree[inEpoch].mPinned || !epoch.IsResident() ) return;
+
+		const size_t epochBytes = epoch.GetMemoryUsage();
+		if ( !epoch.Spill( mUndoJournal ) ) {
+			isSpilling = false;
+			return;
+		}
+
+		residentBytes -= epochBytes - epoch.GetMemoryUsage();
+		isSpilling = residentBytes > mUndoMemoryBudget;
+	};
+
+	// Abandoned branches are only reached by jumping through the tree, so they go first
+	for ( size_t epoch = 0; isSpilling && epoch < mUndoStack.size(); ++epoch ) {
+		if ( !isOnPath[epoch] ) spill( epoch );
+	}
+
+	// Then the path furthest from the current epoch first, the current epoch and the next redo stay resident
+	size_t undoEnd = undoPath.size();
+	size_t redoEnd = redoPath.size();
+	while ( isSpilling && ( undoEnd > 0 || redoEnd > 1 ) ) {
+		spill( undoEnd >= redoEnd ? undoPath[--undoEnd] : redoPath[--redoEnd] );
+	}
+}
+
+entt::entity Cyclone::Core::EntityContext::CreateEntity( entt::id_type inType, entt::registry &inRegistry, const Cyclone::Math::Vector4D inPosition )
+{
+	assert( mUndoStackLock && "Can only create entities within Begin()/End()" );
+	assert( &inRegistry == mTrackedRegistry && "Can only create entities in the tracked registry" );
+
+	const Entity::EntityClassFunctions *entityClass = Entity::FindEntityClass( inType );
+	if ( !entityClass ) {
+		assert( !"Failed to create entity: unknown type" );
+		return entt::null;
+	}
+
+	entt::entity entity = entityClass->mCreateEntity( inRegistry, inPosition );
+	MarkDirty( entity );
+
+	return entity;
+}
+
+void Cyclone::Core::EntityContext::UpdateEntity( entt::entity inEntity, entt::registry &inRegistry )
+{
+	assert( mUndoStackLock && "Can only update entities within Begin()/End()" );
+	assert( &inRegistry == mTrackedRegistry && "Can only update entities in the tracked registry" );
+
+	MarkDirty( inEntity );
+}
+
+void Cyclone::Core::EntityContext::DeleteEntity( entt::entity inEntity, entt::registry & inRegistry )
+{
+	assert( mUndoStackLock && "Can only delete entities within Begin()/End()" );
+	assert( &inRegistry == mTrackedRegistry && "Can only delete entities in the tracked registry" );
+
+	// Stage as an entity without components, dropping anything saved earlier in this action
+	if ( mStagingRegistry.valid( inEntity ) ) {
+		mStagingRegistry.destroy( inEntity );
+	}
+
+	auto retEntity = mStagingRegistry.create( inEntity );
+	assert( retEntity == inEntity );
+
+	// Ensure entity stays orphaned, not deleted
+	inRegistry.destroy( inEntity );
+	entt::entity created = inRegistry.create( inEntity );
+	assert( created == inEntity );
+}
+
+struct Cyclone::Core::EntityContext::StageColumnFunctor
+{
+	template<typename T>
+	void Apply( const entt::registry &inRegistry, entt::registry &ioStagingRegistry, const History::Epoch::PartialStaging &inPartial ) const
+	{
+		const auto *source = inRegistry.storage<T>();
+		if ( !source ) return;
+
+		// A written component missing from the registry was removed, leaving it unstaged records that
+		std::vector<entt::entity> entities;
+		std::vector<T> values;
+		for ( const entt::entity entity : inPartial.mColumns[entt::type_list_index_v<T, History::history_columns>] ) {
+			if ( inPartial.mEntities.contains( entity ) && source->contains( entity ) ) {
+				entities.push_back( entity );
+				values.push_back( source->get( entity ) );
+			}
+		}
+
+		ioStagingRegistry.storage<T>().insert( entities.begin(), entities.end(), values.begin() );
+	}
+};
+
+void Cyclone::Core::EntityContext::StageDirtyEntities( const entt::registry &inRegistry )
+{
+	for ( const entt::entity entity : mDirtyEntities ) {
+		const bool isLive = inRegistry.valid( entity ) && inRegistry.all_of<Component::EntityType>( entity );
+		const bool isCommitted = mCommittedRegistry.valid( entity ) && mCommittedRegistry.all_of<Component::EntityType>( entity );
+
+		// Updates seen through the observers only need the components which were written
+		if ( isLive && isCommitted && !mWholeDirtyEntities.contains( entity ) && !mStagingRegistry.valid( entity ) ) {
+			auto retEntity = mStagingRegistry.create( entity );
+			assert( retEntity == entity );
+			mDirtyColumns.mEntities.push( entity );
+		}
+		else if ( isLive ) {
+			const auto type = static_cast<entt::id_type>( inRegistry.get<Component::EntityType>( entity ) );
+
+			const Entity::EntityClassFunctions *entityClass = Entity::FindEntityClass( type );
+			assert( entityClass && "Failed to stage entity: unknown type" );
+
+			entityClass->mSaveHistory( inRegistry, mStagingRegistry, entity );
+		}
+		else if ( !mStagingRegistry.valid( entity ) ) {
+			// Lost its components without going through DeleteEntity, stage it as deleted
+			auto retEntity = mStagingRegistry.create( entity );
+			assert( retEntity == entity );
+		}
+	}
+
+	Cyclone::Util::ApplyOverTypeList<History::history_columns>( StageColumnFunctor{}, inRegistry, mStagingRegistry, mDirtyColumns );
+}
+
+void Cyclone::Core::EntityContext::ApplyContextChanges( const History::Epoch &inEpoch, History::Epoch::ESide inSide )
+{
+	const bool useBefore = inSide == History::Epoch::ESide::Before;
+	for ( const History::Epoch::ContextChange &change : inEpoch.GetContextChanges() ) {
+		*sFindIn( mContextFlags[static_cast<size_t>( change.mKind )], change.mKey ) = useBefore ? change.mBefore : change.mAfter;
+	}
+}
\ No newline at end of file
@@ -9,37 +9,97 @@
 #include "Cyclone/Core/Component/EntityCategory.hpp"
 #include "Cyclone/Core/Component/EpochNumber.hpp"
 
+// Cyclone history
+#include "Cyclone/Core/History/Epoch.hpp"
+#include "Cyclone/Core/History/ActionJournal.hpp"
+#include "Cyclone/Core/History/EpochCompactor.hpp"
+#include "Cyclone/Core/History/EpochRecycler.hpp"
+
 // Cyclone math
 #include "Cyclone/Math/Vector.hpp"
 
 // STL Includes
 #include <mutex>
+#include <functional>
 
 namespace Cyclone::Core
 {
 	class EntityContext: public Cyclone::Util::NonCopyable
 	{
 	public:
+		static constexpr size_t kDefaultUndoMemoryBudget = 512ull * 1024 * 1024;
+		static constexpr size_t kUndoCheckpointInterval = 256;						///< Epochs between full checkpoints of the committed state
+		static constexpr size_t kUndoCheckpointDeltaBytes = 64ull * 1024 * 1024;	///< Bytes of epochs which also trigger a checkpoint
+		static constexpr size_t kUndoReserveEpochs = 1024;							///< Fewest epochs the undo stack is reserved for
+		static constexpr size_t kNoEpoch = static_cast<size_t>( Component::EpochNumber::Sentinel );
+
+		/// @brief Size and cost of a single epoch, kept up to date as it is recorded, restored and compacted
+		struct EpochStats
+		{
+			std::array<size_t, History::history_columns::size> mColumnBytes{};	///< Before and after values of each history column, in the order of history_columns
+			size_t							mEntityCount = 0;
+			size_t							mPayloadBytes = 0;			///< Rows and columns, whether resident or spilled
+			double							mRecordMilliseconds = 0.0;	///< Staging, packing and committing the action, summed over compacted epochs
+			double							mRestoreMilliseconds = 0.0;	///< Last undo, redo or jump which applied this epoch
+			size_t							mRestoreCount = 0;
+		};
+
+		static constexpr size_t kCompactionMinAge = 256;						///< Epochs created since, before an epoch may be merged with its neighbours
+		static constexpr size_t kCompactionMaxRun = 64;							///< Most epochs merged at once
+		static constexpr size_t kCompactionMaxBytes = 16ull * 1024 * 1024;		///< Most payload merged into a single epoch
+
 		EntityContext() {}
 
 		void Register();
 
+		/// @brief Sets the registry whose history components are observed between BeginAction() and EndAction()
+		void TrackRegistry( entt::registry &inRegistry );
+
+		/// Loads a level file into an empty registry, used to recover the level a journaled session started from
+		using LevelLoader = std::function<bool( const std::filesystem::path &inPath, entt::registry &ioRegistry )>;
+
+		/// @brief Opens the crash journal, every later action is appended to it
+		/// @note Actions left behind by a session which did not shut down cleanly are replayed into inRegistry and the undo stack first
+		/// @param inLoadLevel Loads the last level file the journal refers to, the recovered actions are applied on top of it
+		/// @return True if any action or level was recovered
+		bool OpenActionJournal( const std::filesystem::path &inPath, entt::registry &inRegistry, const LevelLoader &inLoadLevel );
+
+		/// @brief Drops every epoch, the history starts over with a first epoch holding the current state of inRegistry
+		/// @param inLevelPath File inRegistry was just loaded from, empty for a level without a file whose entities the first epoch then records as created
+		void ResetHistory( const entt::registry &inRegistry, const std::filesystem::path &inLevelPath );
+
+		/// @brief Records that the state at the current epoch was saved to inPath, so crash recovery can start from that file
+		void MarkLevelSaved( const std::filesystem::path &inPath );
+
+		/// @brief Every entity created, changed or deleted between the epoch last saved and the current one
+		/// @note Follows the undo tree, so undoing past the save or moving to another branch is covered as well
+		/// @return False if the level was never saved or loaded, the whole level must be written then
+		bool GetEntitiesChangedSinceSave( std::vector<entt::entity> &outEntities );
+
+		/// @brief Marks the level as still arriving, no checkpoint is written meanwhile since it would miss the entities not committed yet
+		void SetStreamingLevel( bool inStreaming );
+
+		/// @brief Records the history components of entities streamed into inRegistry as part of the level, not as an action
+		/// @note The entities must have been in inRegistry, without components, when the history was reset
+		void CommitStreamedEntities( const entt::registry &inRegistry, std::span<const entt::entity> inEntities );
+
 
 		const char *			GetEntityTypeName( Component::EntityType inType ) const					{ auto it = sFindIn( mEntityTypeNameMap, inType ); return it ? *it : nullptr; }
 		const char *			GetEntityCategoryName( Component::EntityCategory inType ) const			{ auto it = sFindIn( mEntityCategoryNameMap, inType ); return it ? *it : nullptr; }
 		uint32_t				GetEntityTypeColor( Component::EntityType inType ) const				{ auto it = sFindIn( mEntityTypeColorMap, inType ); return it ? *it : Cyclone::Util::ColorU32( 0xFF, 0xFF, 0xFF ); }
 
-		bool					GetEntityTypeIsSelectable( Component::EntityType inType ) const			{ auto it = sFindIn( mEntityTypeSelectable, inType ); return it ? *it : false; }
-		void					SetEntityTypeIsSelectable( Component::EntityType inType, bool inV );
+		// The setters join the open action, so any number of flags can be changed by a single action between BeginAction() and EndAction()
+		bool					GetEntityTypeIsSelectable( Component::EntityType inType ) const			{ return GetContextFlag( History::Epoch::EContextKind::EntityTypeSelectable, static_cast<entt::id_type>( inType ) ); }
+		void					SetEntityTypeIsSelectable( Component::EntityType inType, bool inV )		{ SetContextFlag( History::Epoch::EContextKind::EntityTypeSelectable, static_cast<entt::id_type>( inType ), inV ); }
 
-		bool					GetEntityTypeIsVisible( Component::EntityType inType ) const			{ auto it = sFindIn( mEntityTypeVisible, inType ); return it ? *it : false; }
-		void					SetEntityTypeIsVisible( Component::EntityType inType, bool inV );
+		bool					GetEntityTypeIsVisible( Component::EntityType inType ) const			{ return GetContextFlag( History::Epoch::EContextKind::EntityTypeVisible, static_cast<entt::id_type>( inType ) ); }
+		void					SetEntityTypeIsVisible( Component::EntityType inType, bool inV )		{ SetContextFlag( History::Epoch::EContextKind::EntityTypeVisible, static_cast<entt::id_type>( inType ), inV ); }
 
-		bool					GetEntityCategoryIsSelectable( Component::EntityCategory inType ) const	{ auto it = sFindIn( mEntityCategorySelectable, inType ); return it ? *it : false; }
-		void					SetEntityCategoryIsSelectable( Component::EntityCategory inType, bool inV );
+		bool					GetEntityCategoryIsSelectable( Component::EntityCategory inType ) const	{ return GetContextFlag( History::Epoch::EContextKind::EntityCategorySelectable, static_cast<entt::id_type>( inType ) ); }
+		void					SetEntityCategoryIsSelectable( Component::EntityCategory inType, bool inV )	{ SetContextFlag( History::Epoch::EContextKind::EntityCategorySelectable, static_cast<entt::id_type>( inType ), inV ); }
 
-		bool					GetEntityCategoryIsVisible( Component::EntityCategory inType ) const	{ auto it = sFindIn( mEntityCategoryVisible, inType ); return it ? *it : false; }
-		void					SetEntityCategoryIsVisible( Component::EntityCategory inType, bool inV );
+		bool					GetEntityCategoryIsVisible( Component::EntityCategory inType ) const	{ return GetContextFlag( History::Epoch::EContextKind::EntityCategoryVisible, static_cast<entt::id_type>( inType ) ); }
+		void					SetEntityCategoryIsVisible( Component::EntityCategory inType, bool inV )	{ SetContextFlag( History::Epoch::EContextKind::EntityCategoryVisible, static_cast<entt::id_type>( inType ), inV ); }
 
 		bool					CanAquireActionLock() const	{ return !mUndoStackLock; }
 		void					BeginAction();
@@ -48,20 +108,75 @@ namespace Cyclone::Core
 		void					UndoAction( entt::registry &inRegistry );
 		void					RedoAction( entt::registry &inRegistry );
 
+		/// @brief Undoes or redoes every epoch up to inTarget at once, each touched entity is restored a single time
+		/// @note inTarget may be on another branch, only the epochs between both and their common ancestor are applied
+		void					JumpToEpoch( size_t inTarget, entt::registry &inRegistry );
+
 		entt::entity			CreateEntity( entt::id_type inType, entt::registry &inRegistry, const Cyclone::Math::Vector4D inPosition );
+		/// @brief Only needed after writing a history component without patch()/replace(), which the observers cannot see
 		void					UpdateEntity( entt::entity inEntity, entt::registry &inRegistry );
 		void					DeleteEntity( entt::entity inEntity, entt::registry &inRegistry );
 
 
 		size_t					GetUndoEpoch() const { return static_cast<size_t>( mUndoStackEpoch ); }
-		const auto &			GetUndoStack() const { return mUndoStack; }
+		const auto &			GetUndoStack() const { return mUndoStack; }	///< Every epoch of every branch, in the order they were created
+		size_t					GetEpochParent( size_t inEpoch ) const { return mUndoTree[inEpoch].mParent; }	///< Epoch undone to from inEpoch, kNoEpoch for the first one
+		bool					IsEpochCompacted( size_t inEpoch ) const { return mUndoTree[inEpoch].mCompacted; }	///< Merged into a later epoch, it no longer holds anything
+		const EpochStats &		GetEpochStats( size_t inEpoch ) const { return mUndoTree[inEpoch].mStats; }
+
+		/// @brief Installs the last background compaction and submits the next run of old epochs, call once per frame
+		void					CompactHistory();
+
+		size_t					GetUndoMemoryBudget() const { return mUndoMemoryBudget; }
+		void					SetUndoMemoryBudget( size_t inBytes );
+		size_t					GetUndoMemoryUsage() const;
+		size_t					GetUndoJournalSize() const { return mUndoJournal.GetSize(); }
+		size_t					GetActionJournalSize() const { return mActionJournal.GetSize(); }
+
+		/// Every entity class registered by Register(), reflected through entt::meta
+		const entt::meta_ctx &	GetEntityMetaContext() const { return mEntityMetaContext; }
 
 	protected:
 		template<typename T>
 		void RegisterEntityClass();
 
-		void RestoreContextStatePreUndo(); ///< We need to do an extra step for undo actions which flips the context state
-		void RestoreContextStatePostAction();
+		bool GetContextFlag( History::Epoch::EContextKind inKind, entt::id_type inKey ) const { auto it = sFindIn( mContextFlags[static_cast<size_t>( inKind )], inKey ); return it ? *it : false; }
+		void SetContextFlag( History::Epoch::EContextKind inKind, entt::id_type inKey, bool inV ); ///< Recorded into the open action, or as an action of its own when none is open
+		void ApplyContextChanges( const History::Epoch &inEpoch, History::Epoch::ESide inSide ); ///< Sets every flag the epoch changed to its value on inSide
+
+		struct ObserverFunctor;
+
+		struct StageColumnFunctor;
+
+		template<typename T>
+		void OnHistoryComponentChanged( entt::registry &inRegistry, entt::entity inEntity );
+		void MarkDirty( entt::entity inEntity ) { if ( !mDirtyEntities.contains( inEntity ) ) mDirtyEntities.push( inEntity ); if ( !mWholeDirtyEntities.contains( inEntity ) ) mWholeDirtyEntities.push( inEntity ); }
+		void StageDirtyEntities( const entt::registry &inRegistry ); ///< Copies every dirty entity into the staging registry, updates only with their written components
+
+		/// @brief Links a newly created epoch below inParent in the undo tree, it becomes the epoch redone from inParent
+		void ReserveUndoGrowth(); ///< Grows mUndoStack and mUndoTree once they are full, so BeginAction() never has to
+		void AddUndoNode( size_t inParent );
+
+		bool FindCompactionRun( std::vector<size_t> &outRun ); ///< Next run of old, unbranched epochs, scanning on from the previous run
+		void InstallCompaction( History::EpochCompactor::Result &ioResult ); ///< Replaces the run by its merged epoch, unless it changed meanwhile
+
+		/// @brief Epochs to undo, from inFrom upwards, and to redo, downwards to inTo, to move between two epochs of the undo tree
+		/// @note inFrom may be kNoEpoch, every ancestor of inTo is then redone
+		void FindEpochPath( size_t inFrom, size_t inTo, std::vector<size_t> &outUndone, std::vector<size_t> &outRedone ) const;
+		void FollowEpochPath( const std::vector<size_t> &inUndone, const std::vector<size_t> &inRedone ); ///< Points redo at the branch which was just visited
+		void RestoreContextStatePath( const std::vector<size_t> &inUndone, const std::vector<size_t> &inRedone );
+
+		void JournalCursor();
+		void JournalLevel( const std::filesystem::path &inPath );
+		void ClearHistory(); ///< Drops every epoch and checkpoint, the discarded history is freed on the recycler
+		void CopyCommittedState( const entt::registry &inRegistry ); ///< Rebuilds the committed registry as a copy of the history components of inRegistry
+		void MeasureEpoch( size_t inEpoch ); ///< Refreshes the sizes in the stats of a resident epoch
+
+		History::Epoch &PageInEpoch( size_t inEpoch );
+		void MergeEpochPath( const std::vector<size_t> &inUndone, const std::vector<size_t> &inRedone, History::Epoch &outEpoch ); ///< Net change of a path, applied with its after side
+		void WriteCheckpointIfDue();
+		void RestoreCheckpoint( size_t inCheckpoint, size_t inTarget, entt::registry &inRegistry );
+		void EnforceUndoMemoryBudget(); ///< Spills epochs off the current undo path first, then those on it furthest from the current one, until the resident history fits the budget
 
 		template<typename T>
 		struct HashPair
@@ -95,11 +210,7 @@ namespace Cyclone::Core
 		std::vector<HashPair<const char *>>	mEntityTypeNameMap;
 		std::vector<HashPair<const char *>>	mEntityCategoryNameMap;
 
-		std::vector<HashPair<bool>>			mEntityTypeSelectable;
-		std::vector<HashPair<bool>>			mEntityTypeVisible;
-
-		std::vector<HashPair<bool>>			mEntityCategorySelectable;
-		std::vector<HashPair<bool>>			mEntityCategoryVisible;
+		std::array<std::vector<HashPair<bool>>, static_cast<size_t>( History::Epoch::EContextKind::Count )> mContextFlags;	///< Visibility and selectability of each entity type and category, indexed by EContextKind
 
 		std::vector<HashPair<const char *>> mEntitiesSpawnable;
 		std::vector<HashPair<const char *>> mEntitiesBrushable;
@@ -107,7 +218,37 @@ namespace Cyclone::Core
 		entt::meta_ctx						mEntityMetaContext{};
 
 		
-		std::deque<entt::registry>			mUndoStack;
+		static constexpr size_t kNoCheckpoint = std::numeric_limits<size_t>::max();
+
+		struct UndoNode
+		{
+			size_t							mParent = kNoEpoch;			///< Always created before its children
+			size_t							mRedoChild = kNoEpoch;		///< Child moved to by RedoAction(), the branch most recently created or visited
+			size_t							mChildCount = 0;
+			size_t							mCheckpoint = kNoCheckpoint;	///< Index into mUndoCheckpoints of the snapshot taken at this epoch
+			bool							mCompacted = false;
+			bool							mPinned = false;			///< Read by the compactor, must stay resident and unchanged
+			EpochStats						mStats;
+		};
+
+		std::vector<std::unique_ptr<History::Epoch>> mUndoStack;	///< Epochs of every branch, indexed by epoch number, branches share their common epochs, each stays put for the compactor as the stack grows
+		std::vector<UndoNode>				mUndoTree;			///< Links of each epoch in mUndoStack
+		std::deque<History::Epoch>			mUndoCheckpoints;	///< Snapshots of the committed state, each stored as an epoch creating every entity
+		entt::registry						mStagingRegistry;	///< State of every entity touched by the current action
+		entt::sparse_set					mDirtyEntities;		///< Entities whose history components were written during the current action
+		entt::sparse_set					mWholeDirtyEntities;	///< Dirty entities which must be staged with every history component
+		History::Epoch::PartialStaging		mDirtyColumns;		///< Written components of each dirty entity, and the entities staged with only those
+		entt::registry *					mTrackedRegistry = nullptr;
+		entt::registry						mCommittedRegistry;	///< History components of every entity as of mUndoStackEpoch
+		History::EpochJournal				mUndoJournal;
+		History::ActionJournal				mActionJournal;		///< Every committed action and cursor move, only kept on disk for crash recovery
+		History::EpochCompactor				mCompactor;			///< Declared after mUndoStack, so its worker stops before the epochs it reads are destroyed
+		size_t								mCompactionScan = 0;	///< First epoch not yet considered for compaction
+		size_t								mSavedEpoch = kNoEpoch;	///< Epoch the level file holds, compaction never merges it into a later epoch
+		bool								mStreamingLevel = false;
+		History::EpochRecycler				mRecycler;			///< Supplies new epochs and frees discarded history off the UI thread
+		std::vector<std::byte>				mJournalRecord;		///< Reused for every record appended to mActionJournal
+		size_t								mUndoMemoryBudget{ kDefaultUndoMemoryBudget };
 		Component::EpochNumber				mUndoStackEpoch{ Component::EpochNumber::Sentinel };
 		std::mutex							mUndoStackMutex;
 		std::unique_lock<std::mutex>		mUndoStackLock;
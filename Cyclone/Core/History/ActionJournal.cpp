@@ -0,0 +1,159 @@
+#include "pch.h"
+#include "Cyclone/Core/History/ActionJournal.hpp"
+
+// Cyclone utils
+#include "Cyclone/Util/Hash.hpp"
+
+bool Cyclone::Core::History::ActionJournal::Open( const std::filesystem::path &inPath, uint64_t inLayout )
+{
+	Close( false );
+
+	if ( !mFile.Open( inPath, Cyclone::Util::MappedFile::EMode::Append ) ) return false;
+	mPath = inPath;
+
+	FileHeader header{};
+	if ( mFile.GetSize() >= sizeof( FileHeader ) ) {
+		std::memcpy( &header, mFile.GetData(), sizeof( FileHeader ) );
+	}
+
+	if ( header.mMagic == kFileMagic && header.mVersion == kVersion && header.mLayout == inLayout ) {
+		// Find the end of the intact records, anything after it is a torn write and is cut off
+		mEnd = sizeof( FileHeader );
+
+		RecordHeader record{};
+		std::span<const std::byte> payload;
+		while ( ReadRecord( mEnd, record, payload ) ) {
+			mEnd += sizeof( RecordHeader ) + record.mSize;
+		}
+	}
+	else {
+		// Empty, or written by a build with another layout
+		header = FileHeader{ kFileMagic, kVersion, inLayout };
+		mEnd = sizeof( FileHeader );
+	}
+
+	if ( !mFile.Resize( static_cast<size_t>( mEnd ) ) ) {
+		mFile.Close();
+		return false;
+	}
+
+	std::memcpy( mFile.GetData(), &header, sizeof( FileHeader ) );
+	mFile.Flush( 0, static_cast<size_t>( mEnd ) );
+	mCommittedEnd = mEnd;
+
+	mCommitThread = std::jthread( [this]( std::stop_token inStopToken ) { CommitThread( inStopToken ); } );
+	return true;
+}
+
+void Cyclone::Core::History::ActionJournal::Close( bool inDiscard )
+{
+	// Requests a stop and joins the commit thread
+	mCommitThread = {};
+
+	if ( !mFile.IsOpen() ) return;
+
+	if ( !inDiscard ) {
+		std::unique_lock lock( mMutex );
+		Commit( lock );
+	}
+
+	mFile.Close();
+
+	if ( inDiscard ) {
+		std::error_code error;
+		std::filesystem::remove( mPath, error );
+	}
+
+	mEnd = 0;
+	mCommittedEnd = 0;
+}
+
+bool Cyclone::Core::History::ActionJournal::Append( ERecordKind inKind, std::span<const std::byte> inPayload )
+{
+	if ( !mFile.IsOpen() ) return false;
+
+	RecordHeader header{ kRecordMagic, inKind, inPayload.size(), 0 };
+	header.mChecksum = sChecksum( header, inPayload );
+
+	const size_t recordSize = sizeof( RecordHeader ) + inPayload.size();
+
+	std::lock_guard lock( mMutex );
+
+	// Grow geometrically so remapping stays rare, the grown range reads as zeroes which no record starts with
+	if ( mEnd + recordSize > mFile.GetSize() ) {
+		const size_t newSize = std::max( { mFile.GetSize() * 2, static_cast<size_t>( mEnd + recordSize ), kMinimumGrowth } );
+		if ( !mFile.Resize( newSize ) ) return false;
+	}
+
+	std::byte *destination = mFile.GetData() + mEnd;
+	std::memcpy( destination, &header, sizeof( RecordHeader ) );
+	if ( !inPayload.empty() ) std::memcpy( destination + sizeof( RecordHeader ), inPayload.data(), inPayload.size() );
+
+	mEnd += recordSize;
+	return true;
+}
+
+std::filesystem::path Cyclone::Core::History::ActionJournal::sGetDefaultPath()
+{
+	std::error_code error;
+	const std::filesystem::path directory = std::filesystem::temp_directory_path( error );
+	if ( error ) return {};
+
+	return directory / "Cyclone.journal";
+}
+
+uint64_t Cyclone::Core::History::ActionJournal::sChecksum( RecordHeader inHeader, std::span<const std::byte> inPayload )
+{
+	inHeader.mChecksum = 0;
+	const uint64_t headerHash = Cyclone::Util::Fnv1a64( std::as_bytes( std::span( &inHeader, 1 ) ) );
+	return Cyclone::Util::Fnv1a64( inPayload, headerHash );
+}
+
+bool Cyclone::Core::History::ActionJournal::ReadRecord( uint64_t inOffset, RecordHeader &outHeader, std::span<const std::byte> &outPayload ) const
+{
+	const uint64_t fileSize = mFile.GetSize();
+	if ( inOffset + sizeof( RecordHeader ) > fileSize ) return false;
+
+	std::memcpy( &outHeader, mFile.GetData() + inOffset, sizeof( RecordHeader ) );
+	if ( outHeader.mMagic != kRecordMagic || outHeader.mSize > fileSize - inOffset - sizeof( RecordHeader ) ) return false;
+
+	outPayload = { mFile.GetData() + inOffset + sizeof( RecordHeader ), static_cast<size_t>( outHeader.mSize ) };
+	return outHeader.mChecksum == sChecksum( outHeader, outPayload );
+}
+
+void Cyclone::Core::History::ActionJournal::Truncate( uint64_t inEnd )
+{
+	std::lock_guard lock( mMutex );
+
+	assert( inEnd >= sizeof( FileHeader ) && inEnd <= mEnd && "Cannot truncate past the end of the journal!" );
+	mEnd = inEnd;
+	mCommittedEnd = std::min( mCommittedEnd, inEnd );
+
+	// Nothing after the new end may survive, or it could be replayed as a record later
+	mFile.Resize( static_cast<size_t>( inEnd ) );
+}
+
+void Cyclone::Core::History::ActionJournal::CommitThread( std::stop_token inStopToken )
+{
+	std::unique_lock lock( mMutex );
+	while ( !inStopToken.stop_requested() ) {
+		// Group commit, every record appended during the interval shares a single flush
+		mCommitSignal.wait_for( lock, inStopToken, kCommitInterval, [] { return false; } );
+		Commit( lock );
+	}
+}
+
+void Cyclone::Core::History::ActionJournal::Commit( std::unique_lock<std::mutex> &ioLock )
+{
+	if ( mCommittedEnd >= mEnd ) return;
+
+	// The view must be flushed while the mapping cannot move, waiting for the device can happen without the lock
+	const uint64_t end = mEnd;
+	if ( !mFile.FlushView( static_cast<size_t>( mCommittedEnd ), static_cast<size_t>( end - mCommittedEnd ) ) ) return;
+
+	ioLock.unlock();
+	const bool flushed = mFile.FlushFile();
+	ioLock.lock();
+
+	if ( flushed ) mCommittedEnd = std::max( mCommittedEnd, std::min( end, mEnd ) );
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+
+// Cyclone utils
+#include "Cyclone/Util/NonCopyable.hpp"
+#include "Cyclone/Util/MappedFile.hpp"
+
+// STL
+#include <span>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace Cyclone::Core::History
+{
+	/// @brief Crash safe, append only log of every committed action, replayed when the editor restarts after a crash
+	/// @note Appending only copies into the mapped file, a background thread makes the records durable in batches so the caller never waits on the disk
+	/// @note The file is deleted when the journal is destroyed, so it only survives a session which did not shut down cleanly
+	class ActionJournal : public Cyclone::Util::NonCopyable
+	{
+	public:
+		static constexpr uint32_t kFileMagic = 0x4C4A5943;		///< "CYJL"
+		static constexpr uint32_t kRecordMagic = 0x43524A41;	///< "AJRC"
+		static constexpr uint32_t kVersion = 2;
+		static constexpr size_t kMinimumGrowth = 4 * 1024 * 1024;
+		static constexpr std::chrono::milliseconds kCommitInterval{ 100 };	///< Longest a record waits before it is flushed to the device
+
+		enum class ERecordKind : uint32_t
+		{
+			Epoch,		///< A serialized epoch, branching off the epoch current when it was recorded
+			Cursor,		///< The current epoch after an undo, redo or jump
+			Level,		///< A level file holding the state at an epoch, written when a level is loaded or saved
+		};
+
+		ActionJournal() = default;
+		~ActionJournal() { Close( true ); }
+
+		/// @brief Opens the journal at inPath, keeping every intact record left behind by a previous session
+		/// @param inLayout Identifies the layout of the records, a journal written with another layout is discarded
+		bool					Open( const std::filesystem::path &inPath, uint64_t inLayout );
+
+		/// @brief Stops the commit thread, the file is deleted if inDiscard is set, otherwise every record is flushed first
+		void					Close( bool inDiscard );
+
+		/// @brief Calls inFunction( ERecordKind, std::span<const std::byte> ) for every intact record, oldest first
+		/// @note If inFunction returns false, that record and every record after it are dropped from the journal
+		/// @return Number of records accepted
+		template<typename Function>
+		size_t					Replay( Function &&inFunction );
+
+		/// @brief Copies a record into the file, it reaches the device with the next group commit
+		bool					Append( ERecordKind inKind, std::span<const std::byte> inPayload );
+
+		bool					IsOpen() const		{ return mFile.IsOpen(); }
+		size_t					GetSize() const		{ return mEnd; }
+		const std::filesystem::path &GetPath() const { return mPath; }
+
+		static std::filesystem::path sGetDefaultPath();
+
+	protected:
+		struct FileHeader
+		{
+			uint32_t				mMagic;
+			uint32_t				mVersion;
+			uint64_t				mLayout;
+		};
+
+		struct RecordHeader
+		{
+			uint32_t				mMagic;
+			ERecordKind				mKind;
+			uint64_t				mSize;		///< Bytes of payload following the header
+			uint64_t				mChecksum;	///< FNV-1a of the header, with this field zeroed, and the payload
+		};
+
+		static uint64_t			sChecksum( RecordHeader inHeader, std::span<const std::byte> inPayload );
+
+		/// @brief Reads the record at inOffset, fails on anything torn or corrupt
+		bool					ReadRecord( uint64_t inOffset, RecordHeader &outHeader, std::span<const std::byte> &outPayload ) const;
+		void					Truncate( uint64_t inEnd );
+
+		void					CommitThread( std::stop_token inStopToken );
+		void					Commit( std::unique_lock<std::mutex> &ioLock );
+
+		Cyclone::Util::MappedFile	mFile;
+		std::filesystem::path		mPath;
+		uint64_t					mEnd = 0;
+		uint64_t					mCommittedEnd = 0;	///< Everything before this offset is known to be on the device
+		std::mutex					mMutex;				///< Guards the mapping and both offsets against the commit thread
+		std::condition_variable_any	mCommitSignal;
+		std::jthread				mCommitThread;
+	};
+
+	template<typename Function>
+	size_t ActionJournal::Replay( Function &&inFunction )
+	{
+		size_t count = 0;
+		uint64_t offset = sizeof( FileHeader );
+
+		RecordHeader header{};
+		std::span<const std::byte> payload;
+		while ( offset < mEnd && ReadRecord( offset, header, payload ) ) {
+			if ( !inFunction( header.mKind, payload ) ) {
+				Truncate( offset );
+				break;
+			}
+
+			offset += sizeof( RecordHeader ) + header.mSize;
+			++count;
+		}
+
+		return count;
+	}
+}
\ No newline at end of file
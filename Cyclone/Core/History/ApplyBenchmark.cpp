@@ -0,0 +1,71 @@
+#include "pch.h"
+#include "Cyclone/Core/History/ApplyBenchmark.hpp"
+
+// Cyclone Utils
+#include "Cyclone/Util/Benchmark.hpp"
+
+// Cyclone entities
+#include "Cyclone/Core/Entity/EntityClasses.hpp"
+
+// Cyclone history
+#include "Cyclone/Core/History/Epoch.hpp"
+
+// STL
+#include <chrono>
+#include <thread>
+
+namespace
+{
+	double TimeApply( const Cyclone::Core::History::Epoch &inEpoch, entt::registry &ioRegistry, const std::vector<entt::entity> &inEntities, bool inAllowParallel )
+	{
+		// Start from the state right after the deletion, every entity orphaned
+		ioRegistry.clear();
+		for ( const entt::entity entity : inEntities ) {
+			auto created = ioRegistry.create( entity );
+			assert( created == entity );
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		inEpoch.Apply( ioRegistry, Cyclone::Core::History::Epoch::ESide::Before, inAllowParallel );
+		return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+	}
+}
+
+Cyclone::Core::History::ApplyBenchmarkResult Cyclone::Core::History::RunApplyBenchmark( size_t inEntityCount )
+{
+	ApplyBenchmarkResult result;
+	result.mEntityCount = inEntityCount;
+	result.mThreadCount = std::thread::hardware_concurrency();
+
+	const Entity::EntityClassFunctions *entityClass = Entity::FindEntityClass( Entity::PointDebug::kEntityType.value() );
+
+	// Committed state before the deletion, and the staged deletion of every entity
+	entt::registry level;
+	entt::registry before;
+	entt::registry deleted;
+	std::vector<entt::entity> entities;
+	entities.reserve( inEntityCount );
+
+	for ( size_t i = 0; i < inEntityCount; ++i ) {
+		const entt::entity entity = entityClass->mCreateEntity( level, { double( i % 1024 ) * 2.0, 0.0, double( i / 1024 ) * 2.0 } );
+		entityClass->mSaveHistory( level, before, entity );
+		before.emplace<Component::EpochNumber>( entity, static_cast<Component::EpochNumber>( 0 ) );
+
+		auto created = deleted.create( entity );
+		assert( created == entity );
+		entities.push_back( entity );
+	}
+
+	Epoch epoch;
+	epoch.Build( before, deleted, static_cast<Component::EpochNumber>( 1 ) );
+
+	entt::registry serial;
+	entt::registry parallel;
+	Cyclone::Util::TimeSerialAndParallel( [&]( bool inParallel ) {
+		return TimeApply( epoch, inParallel ? parallel : serial, entities, inParallel );
+	}, result.mSerialMilliseconds, result.mParallelMilliseconds );
+
+	result.mResultsMatch = Cyclone::Util::RegistriesMatch<entt::type_list_cat_t<history_columns, entt::type_list<Component::EpochNumber>>>( serial, parallel );
+
+	return result;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+namespace Cyclone::Core::History
+{
+	struct ApplyBenchmarkResult
+	{
+		size_t					mEntityCount = 0;
+		unsigned				mThreadCount = 0;
+		double					mSerialMilliseconds = 0.0;
+		double					mParallelMilliseconds = 0.0;
+		bool					mResultsMatch = false;	///< Both applies produced the same registry
+	};
+
+	/// @brief Times undoing the deletion of inEntityCount entities, once applied serially and once on the thread pool
+	/// @note Runs on private registries, the level and its undo stack are left untouched
+	ApplyBenchmarkResult RunApplyBenchmark( size_t inEntityCount );
+}
@@ -0,0 +1,463 @@
+#include "pch.h"
+#include "Cyclone/Core/History/Epoch.hpp"
+
+// Cyclone Utils
+#include "Cyclone/Util/TypeList.hpp"
+#include "Cyclone/Util/ByteStream.hpp"
+
+// STL
+#include <bit>
+#include <execution>
+#include <numeric>
+
+namespace
+{
+	template<typename T>
+	T ReadValue( const std::byte *inBytes )
+	{
+		std::array<std::byte, sizeof( T )> raw;
+		std::memcpy( raw.data(), inBytes, sizeof( T ) );
+		return std::bit_cast<T>( raw );
+	}
+
+	/// Rows per chunk when overwriting values in place from several threads
+	constexpr size_t kParallelChunkRows = 16384;
+
+	/// @brief Overwrites the values of entities which already own T in place and bulk inserts the rest
+	/// @note Overwriting only touches existing values, so it may be split over entity ranges, inserting is always serial
+	template<typename T, typename EntityAt, typename ValueAt>
+	void AssignBatch( entt::registry &ioRegistry, size_t inCount, EntityAt inEntityAt, ValueAt inValueAt, bool inParallel )
+	{
+		auto &storage = ioRegistry.storage<T>();
+
+		std::vector<uint8_t> isMissing( inCount, 0 );
+		const auto assignRange = [&]( size_t inBegin ) {
+			const size_t end = std::min( inBegin + kParallelChunkRows, inCount );
+			for ( size_t i = inBegin; i < end; ++i ) {
+				const entt::entity entity = inEntityAt( i );
+				if ( storage.contains( entity ) ) {
+					storage.get( entity ) = inValueAt( i );
+				}
+				else {
+					isMissing[i] = 1;
+				}
+			}
+		};
+
+		std::vector<size_t> chunks;
+		for ( size_t begin = 0; begin < inCount; begin += kParallelChunkRows ) {
+			chunks.push_back( begin );
+		}
+
+		if ( inParallel && chunks.size() > 1 ) {
+			std::for_each( std::execution::par, chunks.begin(), chunks.end(), assignRange );
+		}
+		else {
+			std::for_each( chunks.begin(), chunks.end(), assignRange );
+		}
+
+		std::vector<entt::entity> insertEntities;
+		std::vector<T> insertValues;
+		for ( size_t i = 0; i < inCount; ++i ) {
+			if ( !isMissing[i] ) continue;
+			insertEntities.push_back( inEntityAt( i ) );
+			insertValues.push_back( inValueAt( i ) );
+		}
+
+		storage.insert( insertEntities.begin(), insertEntities.end(), insertValues.begin() );
+	}
+
+	template<typename T>
+	void WriteValue( std::vector<std::byte> &ioBytes, const T &inValue )
+	{
+		const std::byte *raw = reinterpret_cast<const std::byte *>( &inValue );
+		ioBytes.insert( ioBytes.end(), raw, raw + sizeof( T ) );
+	}
+
+	template<typename T>
+	void TrimSlack( std::vector<T> &ioValues )
+	{
+		if ( ( ioValues.capacity() - ioValues.size() ) * sizeof( T ) > Cyclone::Core::History::Epoch::kMaxBufferSlack ) ioValues.shrink_to_fit();
+	}
+}
+
+struct Cyclone::Core::History::Epoch::BuildColumnFunctor
+{
+	template<typename T>
+	void Apply( Epoch &ioEpoch, const entt::registry &inBefore, const entt::registry &inAfter, entt::entity inEntity, bool inHasBefore, bool inHasAfter, const PartialStaging *inPartial, bool &outChanged ) const
+	{
+		static_assert( std::is_trivially_copyable_v<T>, "History columns are copied as raw bytes" );
+
+		// Columns which were not written are not staged for a partial entity
+		if ( inPartial && !inPartial->mColumns[entt::type_list_index_v<T, history_columns>].contains( inEntity ) ) return;
+
+		const T *before = inHasBefore ? inBefore.try_get<T>( inEntity ) : nullptr;
+		const T *after = inHasAfter ? inAfter.try_get<T>( inEntity ) : nullptr;
+
+		// Only store components which were added, removed or modified
+		if ( !before && !after ) return;
+		if ( before && after && std::memcmp( before, after, sizeof( T ) ) == 0 ) return;
+
+		const auto row = static_cast<uint32_t>( ioEpoch.mEntities.size() );
+		Column &column = ioEpoch.mColumns[entt::type_list_index_v<T, history_columns>];
+
+		if ( before ) {
+			column.mBefore.mRows.push_back( row );
+			WriteValue( column.mBefore.mBytes, *before );
+		}
+
+		if ( after ) {
+			column.mAfter.mRows.push_back( row );
+			WriteValue( column.mAfter.mBytes, *after );
+		}
+
+		outChanged = true;
+	}
+};
+
+template<typename T>
+void Cyclone::Core::History::Epoch::sApplyColumn( const Epoch &inEpoch, entt::registry &ioRegistry, ESide inSide, bool inParallel )
+{
+	const Column &column = inEpoch.mColumns[entt::type_list_index_v<T, history_columns>];
+	const ColumnSide &side = inSide == ESide::Before ? column.mBefore : column.mAfter;
+	const ColumnSide &otherSide = inSide == ESide::Before ? column.mAfter : column.mBefore;
+
+	AssignBatch<T>( ioRegistry, side.mRows.size(),
+		[&]( size_t inIndex ) { return inEpoch.mEntities[side.mRows[inIndex]]; },
+		[&]( size_t inIndex ) { return ReadValue<T>( side.mBytes.data() + inIndex * sizeof( T ) ); },
+		inParallel );
+
+	// Components only present on the other side of an update were added or removed by the action
+	std::vector<entt::entity> removedEntities;
+	auto it = side.mRows.begin();
+	for ( const uint32_t row : otherSide.mRows ) {
+		it = std::lower_bound( it, side.mRows.end(), row );
+		if ( ( it == side.mRows.end() || *it != row ) && inEpoch.mRowKinds[row] == ERowKind::Updated ) {
+			removedEntities.push_back( inEpoch.mEntities[row] );
+		}
+	}
+	ioRegistry.storage<T>().remove( removedEntities.begin(), removedEntities.end() );
+}
+
+void Cyclone::Core::History::Epoch::Build( const entt::registry &inBefore, const entt::registry &inAfter, Component::EpochNumber inEpochNumber, const PartialStaging *inPartial )
+{
+	mEpochNumber = inEpochNumber;
+
+	std::vector<entt::entity> touchedEntities;
+	for ( const entt::entity entity : inAfter.view<entt::entity>() ) {
+		touchedEntities.push_back( entity );
+	}
+	std::sort( touchedEntities.begin(), touchedEntities.end() );
+
+	// Snapshots carry the epoch each entity was last modified in, staged actions do not
+	const auto *afterEpochs = inAfter.storage<Component::EpochNumber>();
+	const bool keepAfterEpochs = afterEpochs && !afterEpochs->empty();
+
+	for ( const entt::entity entity : touchedEntities ) {
+		// Partial entities are always updates of an entity which exists on both sides
+		const PartialStaging *partial = inPartial && inPartial->mEntities.contains( entity ) ? inPartial : nullptr;
+		assert( ( !partial || ( inBefore.valid( entity ) && inBefore.all_of<Component::EntityType>( entity ) ) ) && "Only committed entities may be staged partially!" );
+
+		const bool hasBefore = partial || ( inBefore.valid( entity ) && inBefore.all_of<Component::EntityType>( entity ) );
+		const bool hasAfter = partial || inAfter.all_of<Component::EntityType>( entity );
+
+		// Created and deleted within the same action
+		if ( !hasBefore && !hasAfter ) continue;
+
+		bool changed = false;
+		Cyclone::Util::ApplyOverTypeList<history_columns>( BuildColumnFunctor{}, *this, inBefore, inAfter, entity, hasBefore, hasAfter, partial, changed );
+
+		// A snapshot may have moved the entity to another epoch without changing any value
+		if ( !changed && keepAfterEpochs && hasBefore && hasAfter && afterEpochs->contains( entity ) ) {
+			changed = inBefore.get<Component::EpochNumber>( entity ) != afterEpochs->get( entity );
+		}
+
+		// Updated, but every component was written back with its previous value
+		if ( !changed ) continue;
+
+		mEntities.push_back( entity );
+
+		if ( keepAfterEpochs ) {
+			mLastEpochs.push_back( hasAfter && afterEpochs->contains( entity ) ? afterEpochs->get( entity ) : inEpochNumber );
+		}
+
+		if ( !hasBefore ) {
+			mRowKinds.push_back( ERowKind::Created );
+			mPreviousEpochs.push_back( Component::EpochNumber::Sentinel );
+			++mCreatedCount;
+		}
+		else {
+			mRowKinds.push_back( hasAfter ? ERowKind::Updated : ERowKind::Deleted );
+			mPreviousEpochs.push_back( inBefore.get<Component::EpochNumber>( entity ) );
+			if ( !hasAfter ) ++mDeletedCount;
+		}
+	}
+
+	// Epochs are immutable from here on, so large growth slack would only be dead weight in the undo budget
+	// Small slack is kept, a pooled epoch is then built without a single allocation
+	TrimSlack( mEntities );
+	TrimSlack( mRowKinds );
+	TrimSlack( mPreviousEpochs );
+	TrimSlack( mLastEpochs );
+	for ( Column &column : mColumns ) {
+		TrimSlack( column.mBefore.mRows );
+		TrimSlack( column.mBefore.mBytes );
+		TrimSlack( column.mAfter.mRows );
+		TrimSlack( column.mAfter.mBytes );
+	}
+
+	mEntityCount = mEntities.size();
+	mPayloadSize = GetMemoryUsage() - sizeof( Epoch );
+}
+
+void Cyclone::Core::History::Epoch::Apply( entt::registry &ioRegistry, ESide inSide, bool inAllowParallel ) const
+{
+	assert( mResident && "Epoch must be paged in before it is applied!" );
+
+	// Creating and destroying entities touches every storage, so it stays serial
+
+	std::vector<uint32_t> existingRows;
+	existingRows.reserve( mEntities.size() );
+
+	for ( size_t row = 0; row < mEntities.size(); ++row ) {
+		const entt::entity entity = mEntities[row];
+
+		if ( !ExistsOnSide( row, inSide ) ) {
+			// Ensure entity stays orphaned, not deleted
+			if ( ioRegistry.valid( entity ) ) ioRegistry.destroy( entity );
+			entt::entity created = ioRegistry.create( entity );
+			assert( created == entity );
+			continue;
+		}
+
+		if ( !ioRegistry.valid( entity ) ) {
+			entt::entity created = ioRegistry.create( entity );
+			assert( created == entity );
+		}
+
+		existingRows.push_back( static_cast<uint32_t>( row ) );
+	}
+
+	// Creating a storage is not thread safe, so every storage is created before the tasks start
+	ioRegistry.storage<Component::EpochNumber>();
+	[&] <typename... Types>( entt::type_list<Types...> ) { ( ioRegistry.storage<Types>(), ... ); }( history_columns{} );
+
+	using ApplyColumnFn = void ( * )( const Epoch &, entt::registry &, ESide, bool );
+	static constexpr auto kApplyColumn = [] <typename... Types>( entt::type_list<Types...> ) { return std::array<ApplyColumnFn, sizeof...( Types )>{ &Epoch::sApplyColumn<Types>... }; }( history_columns{} );
+
+	const bool parallel = inAllowParallel && mEntities.size() >= kParallelApplyRows;
+
+	// One task per storage, each column plus the EpochNumber of every row
+	const auto applyStorage = [&]( size_t inTask ) {
+		if ( inTask < kApplyColumn.size() ) {
+			kApplyColumn[inTask]( *this, ioRegistry, inSide, parallel );
+			return;
+		}
+
+		AssignBatch<Component::EpochNumber>( ioRegistry, existingRows.size(),
+			[&]( size_t inIndex ) { return mEntities[existingRows[inIndex]]; },
+			[&]( size_t inIndex ) {
+				const uint32_t row = existingRows[inIndex];
+				if ( inSide == ESide::Before ) return mPreviousEpochs[row];
+				return mLastEpochs.empty() ? mEpochNumber : mLastEpochs[row];
+			},
+			parallel );
+	};
+
+	std::array<size_t, history_columns::size + 1> tasks;
+	std::iota( tasks.begin(), tasks.end(), size_t{ 0 } );
+
+	if ( parallel ) {
+		std::for_each( std::execution::par, tasks.begin(), tasks.end(), applyStorage );
+	}
+	else {
+		std::for_each( tasks.begin(), tasks.end(), applyStorage );
+	}
+}
+
+void Cyclone::Core::History::Epoch::Clear()
+{
+	mEntities.clear();
+	mRowKinds.clear();
+	mPreviousEpochs.clear();
+	mLastEpochs.clear();
+	for ( Column &column : mColumns ) {
+		column.mBefore.mRows.clear();
+		column.mBefore.mBytes.clear();
+		column.mAfter.mRows.clear();
+		column.mAfter.mBytes.clear();
+	}
+	mContextChanges.clear();
+
+	mEpochNumber = Component::EpochNumber::Sentinel;
+	mEntityCount = 0;
+	mCreatedCount = 0;
+	mDeletedCount = 0;
+	mPayloadSize = 0;
+
+	mResident = true;
+	mJournalLocation = {};
+}
+
+bool Cyclone::Core::History::Epoch::Spill( EpochJournal &ioJournal )
+{
+	if ( !mResident ) return true;
+
+	if ( mJournalLocation.mSize == 0 && mEntityCount != 0 ) {
+		std::vector<std::byte> bytes;
+		SerializeRows( bytes );
+
+		mJournalLocation = ioJournal.Append( bytes );
+		if ( mJournalLocation.mSize == 0 ) return false;
+	}
+
+	mEntities = {};
+	mRowKinds = {};
+	mPreviousEpochs = {};
+	mLastEpochs = {};
+	mColumns = {};
+	mResident = false;
+	return true;
+}
+
+void Cyclone::Core::History::Epoch::PageIn( const EpochJournal &inJournal )
+{
+	if ( mResident ) return;
+
+	if ( mJournalLocation.mSize != 0 ) {
+		std::vector<std::byte> bytes;
+		[[maybe_unused]] const bool valid = inJournal.Read( mJournalLocation, bytes ) && DeserializeRows( bytes );
+		assert( valid && "Undo journal is corrupt!" );
+	}
+
+	mResident = true;
+}
+
+void Cyclone::Core::History::Epoch::SerializeRows( std::vector<std::byte> &outBytes ) const
+{
+	assert( mResident && "Epoch must be paged in before it is serialized!" );
+
+	Cyclone::Util::ByteWriter writer( outBytes );
+	writer.WriteSpan<entt::entity>( mEntities );
+	writer.WriteSpan<ERowKind>( mRowKinds );
+	writer.WriteSpan<Component::EpochNumber>( mPreviousEpochs );
+	writer.WriteSpan<Component::EpochNumber>( mLastEpochs );
+
+	for ( const Column &column : mColumns ) {
+		writer.WriteSpan<uint32_t>( column.mBefore.mRows );
+		writer.WriteSpan<std::byte>( column.mBefore.mBytes );
+		writer.WriteSpan<uint32_t>( column.mAfter.mRows );
+		writer.WriteSpan<std::byte>( column.mAfter.mBytes );
+	}
+}
+
+bool Cyclone::Core::History::Epoch::DeserializeRows( std::span<const std::byte> inBytes )
+{
+	Cyclone::Util::ByteReader reader( inBytes );
+	reader.ReadSpan( mEntities );
+	reader.ReadSpan( mRowKinds );
+	reader.ReadSpan( mPreviousEpochs );
+	reader.ReadSpan( mLastEpochs );
+
+	for ( Column &column : mColumns ) {
+		reader.ReadSpan( column.mBefore.mRows );
+		reader.ReadSpan( column.mBefore.mBytes );
+		reader.ReadSpan( column.mAfter.mRows );
+		reader.ReadSpan( column.mAfter.mBytes );
+	}
+
+	if ( !reader.IsValid() || mEntities.size() != mEntityCount || mRowKinds.size() != mEntityCount || mPreviousEpochs.size() != mEntityCount ) return false;
+
+	for ( size_t index = 0; index < history_columns::size; ++index ) {
+		const Column &column = mColumns[index];
+		if ( column.mBefore.mBytes.size() != column.mBefore.mRows.size() * kHistoryColumnSizes[index] ) return false;
+		if ( column.mAfter.mBytes.size() != column.mAfter.mRows.size() * kHistoryColumnSizes[index] ) return false;
+	}
+
+	return true;
+}
+
+void Cyclone::Core::History::Epoch::SerializeRecord( std::vector<std::byte> &outBytes ) const
+{
+	Cyclone::Util::ByteWriter writer( outBytes );
+	writer.Write( static_cast<uint64_t>( mEpochNumber ) );
+	writer.Write( static_cast<uint64_t>( mEntityCount ) );
+	writer.Write( static_cast<uint64_t>( mCreatedCount ) );
+	writer.Write( static_cast<uint64_t>( mDeletedCount ) );
+
+	writer.Write( static_cast<uint64_t>( mContextChanges.size() ) );
+	for ( const ContextChange &change : mContextChanges ) {
+		writer.Write( change.mKey );
+		writer.Write( change.mKind );
+		writer.Write( change.mBefore );
+		writer.Write( change.mAfter );
+	}
+
+	SerializeRows( outBytes );
+}
+
+bool Cyclone::Core::History::Epoch::DeserializeRecord( std::span<const std::byte> inBytes )
+{
+	Cyclone::Util::ByteReader reader( inBytes );
+	mEpochNumber = static_cast<Component::EpochNumber>( reader.Read<uint64_t>() );
+	mEntityCount = static_cast<size_t>( reader.Read<uint64_t>() );
+	mCreatedCount = static_cast<size_t>( reader.Read<uint64_t>() );
+	mDeletedCount = static_cast<size_t>( reader.Read<uint64_t>() );
+
+	mContextChanges.clear();
+	const auto changeCount = reader.Read<uint64_t>();
+	for ( uint64_t change = 0; change < changeCount && reader.IsValid(); ++change ) {
+		const auto key = reader.Read<entt::id_type>();
+		const auto kind = reader.Read<EContextKind>();
+		const auto before = reader.Read<bool>();
+		const auto after = reader.Read<bool>();
+		if ( kind >= EContextKind::Count ) return false;
+		mContextChanges.push_back( ContextChange{ key, kind, before, after } );
+	}
+
+	if ( !reader.IsValid() ) return false;
+
+	mResident = true;
+	mJournalLocation = {};
+	if ( !DeserializeRows( inBytes.subspan( reader.GetOffset() ) ) ) return false;
+
+	mPayloadSize = GetMemoryUsage() - sizeof( Epoch );
+	return true;
+}
+
+void Cyclone::Core::History::Epoch::RecordContextChange( EContextKind inKind, entt::id_type inKey, bool inBefore, bool inAfter )
+{
+	for ( ContextChange &change : mContextChanges ) {
+		if ( change.mKind == inKind && change.mKey == inKey ) {
+			change.mAfter = inAfter;
+			return;
+		}
+	}
+
+	mContextChanges.push_back( ContextChange{ inKey, inKind, inBefore, inAfter } );
+}
+
+size_t Cyclone::Core::History::Epoch::GetColumnPayloadSize( size_t inColumn ) const
+{
+	assert( mResident && "Epoch must be paged in before its columns are measured!" );
+
+	const Column &column = mColumns[inColumn];
+	return ( column.mBefore.mRows.size() + column.mAfter.mRows.size() ) * sizeof( uint32_t ) + column.mBefore.mBytes.size() + column.mAfter.mBytes.size();
+}
+
+size_t Cyclone::Core::History::Epoch::GetMemoryUsage() const
+{
+	size_t bytes = sizeof( Epoch );
+	bytes += mEntities.capacity() * sizeof( entt::entity );
+	bytes += mRowKinds.capacity() * sizeof( ERowKind );
+	bytes += mPreviousEpochs.capacity() * sizeof( Component::EpochNumber );
+	bytes += mLastEpochs.capacity() * sizeof( Component::EpochNumber );
+	bytes += mContextChanges.capacity() * sizeof( ContextChange );
+
+	for ( const Column &column : mColumns ) {
+		bytes += column.mBefore.mRows.capacity() * sizeof( uint32_t ) + column.mBefore.mBytes.capacity();
+		bytes += column.mAfter.mRows.capacity() * sizeof( uint32_t ) + column.mAfter.mBytes.capacity();
+	}
+
+	return bytes;
+}
\ No newline at end of file
@@ -0,0 +1,167 @@
+#pragma once
+
+// Cyclone Compontents
+#include "Cyclone/Core/Component/Position.hpp"
+#include "Cyclone/Core/Component/BoundingBox.hpp"
+#include "Cyclone/Core/Component/EntityType.hpp"
+#include "Cyclone/Core/Component/EntityCategory.hpp"
+#include "Cyclone/Core/Component/Visible.hpp"
+#include "Cyclone/Core/Component/Selectable.hpp"
+#include "Cyclone/Core/Component/EpochNumber.hpp"
+
+// Cyclone history
+#include "Cyclone/Core/History/EpochJournal.hpp"
+
+namespace Cyclone::Core::History
+{
+	/// Every component that may appear in an entity's history_components, each one is stored as a column of an epoch
+	using history_columns = entt::type_list<Component::EntityType, Component::EntityCategory, Component::Visible, Component::Selectable, Component::Position, Component::BoundingBox>;
+
+	template<typename... Types>
+	constexpr std::array<size_t, sizeof...( Types )> ColumnSizes( entt::type_list<Types...> ) { return { sizeof( Types )... }; }
+
+	/// Size in bytes of a single value in each history column
+	inline constexpr auto kHistoryColumnSizes = ColumnSizes( history_columns{} );
+
+	/// Display name of each history column, in the order of history_columns
+	inline constexpr std::array<const char *, history_columns::size> kHistoryColumnNames{ "EntityType", "EntityCategory", "Visible", "Selectable", "Position", "BoundingBox" };
+
+	class EpochMerger;
+
+	/// @brief A single undo step, packed into columns instead of a registry
+	/// @note Rows are sorted by entity, a column only holds the rows where that component actually changed
+	/// @note The rows and columns may be spilled to an EpochJournal, the counts and context state always stay resident
+	class Epoch
+	{
+	public:
+		friend EpochMerger;
+
+		enum class ERowKind : uint8_t
+		{
+			Created,
+			Updated,
+			Deleted,
+		};
+
+		enum class ESide : uint8_t
+		{
+			Before,
+			After,
+		};
+
+		/// Editor flags recorded by an epoch, each kind is a separate table in the EntityContext
+		enum class EContextKind : uint8_t
+		{
+			EntityTypeSelectable,
+			EntityTypeVisible,
+			EntityCategorySelectable,
+			EntityCategoryVisible,
+			Count,
+		};
+
+		/// @brief One editor flag changed by the epoch, an epoch may change any number of them
+		struct ContextChange
+		{
+			entt::id_type			mKey;	///< Entity type or category the flag belongs to
+			EContextKind			mKind;
+			bool					mBefore;
+			bool					mAfter;
+		};
+
+		/// @brief Entities staged with only the history components which were written, every other staged entity holds all of them
+		struct PartialStaging
+		{
+			entt::sparse_set		mEntities;
+			std::array<entt::sparse_set, history_columns::size> mColumns;	///< Entities whose component in that column was written, a listed component missing from the staging registry was removed
+
+			void					Clear() { mEntities.clear(); for ( entt::sparse_set &column : mColumns ) column.clear(); }
+		};
+
+		Epoch() = default;
+
+		/// @brief Packs the difference between two registries holding history components
+		/// @param inBefore Registry holding the state of every entity before the action
+		/// @param inAfter Registry holding the state of every entity touched by the action, entities without an EntityType are deleted
+		/// @note If inAfter holds EpochNumber components, as a snapshot does, each row keeps its own epoch instead of inEpochNumber
+		/// @param inEpochNumber The epoch number this epoch is stored at
+		/// @param inPartial Optional, entities in inAfter which only hold their written components, only those columns are compared for them
+		void					Build( const entt::registry &inBefore, const entt::registry &inAfter, Component::EpochNumber inEpochNumber, const PartialStaging *inPartial = nullptr );
+
+		/// Epochs with at least this many rows are applied with one task per storage
+		static constexpr size_t kParallelApplyRows = 32768;
+
+		/// Spare bytes a buffer may keep after Build(), anything more is given back
+		static constexpr size_t kMaxBufferSlack = 4096;
+
+		/// @brief Writes one side of the epoch into a registry
+		/// @note Entities which do not exist on that side are left orphaned rather than destroyed, so their identifier is not recycled
+		/// @note Large epochs are applied on the parallel algorithms' thread pool, the result is identical to a serial apply
+		void					Apply( entt::registry &ioRegistry, ESide inSide, bool inAllowParallel = true ) const;
+
+		/// @brief Empties every row, column and context change and resets the epoch to its default state, the buffers keep their capacity for the next Build()
+		void					Clear();
+
+		/// @brief Moves the rows and columns into the journal, they are only written the first time as epochs are immutable
+		/// @return False if the journal could not be written, the epoch then stays resident
+		bool					Spill( EpochJournal &ioJournal );
+		void					PageIn( const EpochJournal &inJournal );
+		bool					IsResident() const			{ return mResident; }
+
+		void					SerializeRows( std::vector<std::byte> &outBytes ) const;
+		bool					DeserializeRows( std::span<const std::byte> inBytes );
+
+		/// @brief Writes the whole epoch, counts and context state included, as a self contained record
+		void					SerializeRecord( std::vector<std::byte> &outBytes ) const;
+		bool					DeserializeRecord( std::span<const std::byte> inBytes );
+
+		/// @brief Records a flag change, changing the same flag again within the epoch only updates its after value
+		void					RecordContextChange( EContextKind inKind, entt::id_type inKey, bool inBefore, bool inAfter );
+		std::span<const ContextChange> GetContextChanges() const { return mContextChanges; }
+
+		Component::EpochNumber	GetEpochNumber() const		{ return mEpochNumber; }
+		size_t					GetEntityCount() const		{ return mEntityCount; }
+		size_t					GetCreatedCount() const		{ return mCreatedCount; }
+		size_t					GetDeletedCount() const		{ return mDeletedCount; }
+		size_t					GetPayloadSize() const		{ return mPayloadSize; }	///< Bytes of rows and columns, whether resident or spilled
+		std::span<const entt::entity> GetEntities() const	{ assert( mResident && "Epoch must be paged in before its entities are read!" ); return mEntities; }
+		size_t					GetMemoryUsage() const;	///< Resident bytes, excludes anything spilled to the journal
+		size_t					GetColumnPayloadSize( size_t inColumn ) const;	///< Bytes of both sides of a history column, the epoch must be resident
+
+	protected:
+		struct ColumnSide
+		{
+			std::vector<uint32_t>	mRows;	///< Sorted indices into mEntities
+			std::vector<std::byte>	mBytes;	///< Tightly packed component values, one per row
+		};
+
+		struct Column
+		{
+			ColumnSide				mBefore;
+			ColumnSide				mAfter;
+		};
+
+		struct BuildColumnFunctor;
+
+		template<typename T>
+		static void				sApplyColumn( const Epoch &inEpoch, entt::registry &ioRegistry, ESide inSide, bool inParallel );
+
+		bool					ExistsOnSide( size_t inRow, ESide inSide ) const { return mRowKinds[inRow] != ( inSide == ESide::Before ? ERowKind::Created : ERowKind::Deleted ); }
+
+		std::vector<entt::entity>				mEntities;
+		std::vector<ERowKind>					mRowKinds;
+		std::vector<Component::EpochNumber>		mPreviousEpochs;	///< Epoch each entity was last modified in before this one
+		std::vector<Component::EpochNumber>		mLastEpochs;		///< Only filled for merged epochs, epoch each entity was last modified in within the merged range
+		std::array<Column, history_columns::size> mColumns;
+
+		std::vector<ContextChange>				mContextChanges;
+
+		Component::EpochNumber					mEpochNumber{ Component::EpochNumber::Sentinel };
+		size_t									mEntityCount = 0;
+		size_t									mCreatedCount = 0;
+		size_t									mDeletedCount = 0;
+		size_t									mPayloadSize = 0;
+
+		bool									mResident = true;
+		EpochJournal::Location					mJournalLocation;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "Cyclone/Core/History/EpochCompactor.hpp"
+
+// Cyclone history
+#include "Cyclone/Core/History/EpochMerger.hpp"
+
+bool Cyclone::Core::History::EpochCompactor::Submit( std::vector<size_t> inRun, std::vector<const Epoch *> inEpochs )
+{
+	assert( inRun.size() == inEpochs.size() && "Every epoch of the run must be given!" );
+
+	{
+		std::lock_guard lock( mMutex );
+		if ( mBusy ) return false;
+
+		mRun = std::move( inRun );
+		mEpochs = std::move( inEpochs );
+		mBusy = true;
+		mPending = true;
+	}
+
+	// Started on first use, most sessions never grow old enough to need it
+	if ( !mWorker.joinable() ) {
+		mWorker = std::jthread( [this]( std::stop_token inStopToken ) { WorkerThread( inStopToken ); } );
+	}
+
+	mSignal.notify_one();
+	return true;
+}
+
+std::optional<Cyclone::Core::History::EpochCompactor::Result> Cyclone::Core::History::EpochCompactor::TakeResult()
+{
+	std::lock_guard lock( mMutex );
+	if ( !mResult ) return std::nullopt;
+
+	std::optional<Result> result = std::move( mResult );
+	mResult.reset();
+	mBusy = false;
+	return result;
+}
+
+void Cyclone::Core::History::EpochCompactor::Cancel()
+{
+	std::unique_lock lock( mMutex );
+	mSignal.wait( lock, [this] { return !mBusy || mResult.has_value(); } );
+
+	mResult.reset();
+	mBusy = false;
+}
+
+void Cyclone::Core::History::EpochCompactor::WorkerThread( std::stop_token inStopToken )
+{
+	// Compaction is never urgent, it should only use time the editor leaves idle
+	SetThreadPriority( GetCurrentThread(), THREAD_PRIORITY_LOWEST );
+
+	std::unique_lock lock( mMutex );
+	while ( mSignal.wait( lock, inStopToken, [this] { return mPending; } ) ) {
+		mPending = false;
+
+		Result result{ std::move( mRun ), {} };
+		const std::vector<const Epoch *> epochs = std::move( mEpochs );
+
+		lock.unlock();
+
+		EpochMerger merger;
+		for ( const Epoch *epoch : epochs ) {
+			merger.Add( *epoch );
+		}
+		merger.Build( result.mEpoch );
+
+		lock.lock();
+		mResult = std::move( result );
+		mSignal.notify_all();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+// Cyclone utils
+#include "Cyclone/Util/NonCopyable.hpp"
+
+// Cyclone history
+#include "Cyclone/Core/History/Epoch.hpp"
+
+// STL
+#include <mutex>
+#include <thread>
+#include <optional>
+#include <condition_variable>
+
+namespace Cyclone::Core::History
+{
+	/// @brief Merges runs of old epochs into one on a low priority worker thread
+	/// @note The epochs of a run are read without any lock, the owner must keep them resident and unchanged until the result is taken
+	class EpochCompactor : public Cyclone::Util::NonCopyable
+	{
+	public:
+		struct Result
+		{
+			std::vector<size_t>		mRun;		///< Epoch numbers of the merged run, oldest first
+			Epoch					mEpoch;		///< Net change of the run, context states included
+		};
+
+		EpochCompactor() = default;
+
+		/// @brief Starts merging a run of consecutive epochs, oldest first
+		/// @return False if the previous result has not been taken yet
+		bool					Submit( std::vector<size_t> inRun, std::vector<const Epoch *> inEpochs );
+
+		/// @brief Moves out the merged epoch once the worker is done with it
+		std::optional<Result>	TakeResult();
+
+		/// @brief True from Submit() until the result is taken
+		bool					IsBusy() const { std::lock_guard lock( mMutex ); return mBusy; }
+
+		/// @brief Waits for the run being merged and drops its result, the epochs it read may then be destroyed
+		void					Cancel();
+
+	protected:
+		void					WorkerThread( std::stop_token inStopToken );
+
+		mutable std::mutex			mMutex;
+		std::condition_variable_any	mSignal;
+		std::vector<size_t>			mRun;
+		std::vector<const Epoch *>	mEpochs;
+		std::optional<Result>		mResult;
+		bool						mBusy = false;
+		bool						mPending = false;
+		std::jthread				mWorker;	///< Declared last, so it is joined before anything it reads is destroyed
+	};
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "pch.h"
+#include "Cyclone/Core/History/EpochJournal.hpp"
+
+// Cyclone utils
+#include "Cyclone/Util/BlockCodec.hpp"
+
+// STL
+#include <format>
+
+Cyclone::Core::History::EpochJournal::Location Cyclone::Core::History::EpochJournal::Append( std::span<const std::byte> inBytes )
+{
+	if ( inBytes.empty() ) return {};
+	if ( !mFile.IsOpen() && !Open() ) return {};
+
+	std::vector<std::byte> encoded;
+	Cyclone::Util::BlockCodec::sEncode( inBytes, kRecordStride, true, encoded );
+
+	// Grow geometrically so remapping stays rare
+	if ( mEnd + encoded.size() > mFile.GetSize() ) {
+		const size_t newSize = std::max( { mFile.GetSize() * 2, static_cast<size_t>( mEnd + encoded.size() ), kMinimumGrowth } );
+		if ( !mFile.Resize( newSize ) ) return {};
+	}
+
+	std::memcpy( mFile.GetData() + mEnd, encoded.data(), encoded.size() );
+
+	Location location{ mEnd, encoded.size(), inBytes.size() };
+	mEnd += encoded.size();
+	return location;
+}
+
+bool Cyclone::Core::History::EpochJournal::Read( Location inLocation, std::vector<std::byte> &outBytes ) const
+{
+	assert( inLocation.mOffset + inLocation.mSize <= mEnd && "Journal location out of range!" );
+
+	outBytes.resize( inLocation.mRawSize );
+	return Cyclone::Util::BlockCodec::sDecode( { mFile.GetData() + inLocation.mOffset, static_cast<size_t>( inLocation.mSize ) }, kRecordStride, true, outBytes );
+}
+
+bool Cyclone::Core::History::EpochJournal::Open()
+{
+	std::error_code error;
+	const std::filesystem::path path = std::filesystem::temp_directory_path( error ) / std::format( "Cyclone-{}.undo", GetCurrentProcessId() );
+	if ( error ) return false;
+
+	mEnd = 0;
+	return mFile.Open( path, Cyclone::Util::MappedFile::EMode::Temporary );
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+// Cyclone utils
+#include "Cyclone/Util/NonCopyable.hpp"
+#include "Cyclone/Util/MappedFile.hpp"
+
+// STL
+#include <span>
+
+namespace Cyclone::Core::History
+{
+	/// @brief Append only, memory mapped file which holds epochs evicted from memory
+	/// @note Records are compressed with Util::BlockCodec, component values are mostly doubles, so they are shuffled as 8 byte fields
+	class EpochJournal : public Cyclone::Util::NonCopyable
+	{
+	public:
+		static constexpr size_t kMinimumGrowth = 16 * 1024 * 1024;
+		static constexpr size_t kRecordStride = sizeof( double );
+
+		struct Location
+		{
+			uint64_t				mOffset = 0;
+			uint64_t				mSize = 0;		///< Bytes in the journal
+			uint64_t				mRawSize = 0;	///< Bytes of the record once decoded
+		};
+
+		EpochJournal() = default;
+
+		/// @brief Appends a record, opening the backing temporary file on first use
+		/// @return The location of the record, or an empty location on failure
+		Location					Append( std::span<const std::byte> inBytes );
+
+		/// @brief Decodes a record, the blocks of a large one are decoded in parallel
+		bool						Read( Location inLocation, std::vector<std::byte> &outBytes ) const;
+
+		/// @brief Forgets every record, later appends reuse their space
+		void						Clear()				{ mEnd = 0; }
+
+		bool						IsOpen() const		{ return mFile.IsOpen(); }
+		size_t						GetSize() const		{ return mEnd; }
+
+	protected:
+		bool						Open();
+
+		Cyclone::Util::MappedFile	mFile;
+		uint64_t					mEnd = 0;
+	};
+}
\ No newline at end of file
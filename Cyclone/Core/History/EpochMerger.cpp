@@ -0,0 +1,153 @@
+#include "pch.h"
+#include "Cyclone/Core/History/EpochMerger.hpp"
+
+void Cyclone::Core::History::EpochMerger::Add( const Epoch &inEpoch, bool inInverse )
+{
+	assert( inEpoch.IsResident() && "Epoch must be paged in before it is merged!" );
+
+	for ( size_t row = 0; row < inEpoch.mEntities.size(); ++row ) {
+		Epoch::ERowKind kind = inEpoch.mRowKinds[row];
+		Component::EpochNumber previousEpoch = inEpoch.mPreviousEpochs[row];
+		Component::EpochNumber lastEpoch = inEpoch.mLastEpochs.empty() ? inEpoch.mEpochNumber : inEpoch.mLastEpochs[row];
+
+		// Undoing an epoch creates what it deleted and moves entities back to their previous epoch
+		if ( inInverse ) {
+			if ( kind == Epoch::ERowKind::Created ) kind = Epoch::ERowKind::Deleted;
+			else if ( kind == Epoch::ERowKind::Deleted ) kind = Epoch::ERowKind::Created;
+			std::swap( previousEpoch, lastEpoch );
+		}
+
+		auto [it, inserted] = mRows.try_emplace( inEpoch.mEntities[row], Row{ kind, kind, previousEpoch, lastEpoch } );
+		if ( !inserted ) {
+			it->second.mLastKind = kind;
+			it->second.mLastEpoch = lastEpoch;
+		}
+	}
+
+	for ( size_t index = 0; index < history_columns::size; ++index ) {
+		const size_t valueSize = kHistoryColumnSizes[index];
+		const Epoch::ColumnSide &before = inInverse ? inEpoch.mColumns[index].mAfter : inEpoch.mColumns[index].mBefore;
+		const Epoch::ColumnSide &after = inInverse ? inEpoch.mColumns[index].mBefore : inEpoch.mColumns[index].mAfter;
+		Column &column = mColumns[index];
+
+		// Walk the union of both sides, they are sorted by row
+		size_t i = 0, j = 0;
+		while ( i < before.mRows.size() || j < after.mRows.size() ) {
+			const uint32_t beforeRow = i < before.mRows.size() ? before.mRows[i] : std::numeric_limits<uint32_t>::max();
+			const uint32_t afterRow = j < after.mRows.size() ? after.mRows[j] : std::numeric_limits<uint32_t>::max();
+			const uint32_t row = std::min( beforeRow, afterRow );
+
+			auto [it, inserted] = column.mValues.try_emplace( inEpoch.mEntities[row] );
+			Value &value = it->second;
+
+			// First epoch touching this component decides the before value
+			if ( inserted && beforeRow == row ) {
+				value.mBefore = column.mBeforeBytes.size();
+				const std::byte *bytes = before.mBytes.data() + i * valueSize;
+				column.mBeforeBytes.insert( column.mBeforeBytes.end(), bytes, bytes + valueSize );
+			}
+
+			// Last epoch touching this component decides the after value
+			if ( afterRow == row ) {
+				if ( value.mAfter == kAbsent ) {
+					value.mAfter = column.mAfterBytes.size();
+					column.mAfterBytes.resize( column.mAfterBytes.size() + valueSize );
+				}
+				std::memcpy( column.mAfterBytes.data() + value.mAfter, after.mBytes.data() + j * valueSize, valueSize );
+			}
+			else {
+				value.mAfter = kAbsent;
+			}
+
+			if ( beforeRow == row ) ++i;
+			if ( afterRow == row ) ++j;
+		}
+	}
+
+	for ( Epoch::ContextChange change : inEpoch.mContextChanges ) {
+		if ( inInverse ) std::swap( change.mBefore, change.mAfter );
+
+		const uint64_t flag = static_cast<uint64_t>( change.mKind ) << 32 | change.mKey;
+		auto [it, inserted] = mContextChanges.try_emplace( flag, change );
+		if ( !inserted ) it->second.mAfter = change.mAfter;
+	}
+
+	mLastEpoch = inEpoch.mEpochNumber;
+}
+
+void Cyclone::Core::History::EpochMerger::Build( Epoch &outEpoch ) const
+{
+	// Cleared rather than replaced, so an epoch from the recycler keeps its buffers
+	outEpoch.Clear();
+	outEpoch.mEpochNumber = mLastEpoch;
+
+	for ( const auto &[entity, row] : mRows ) {
+		// Created and deleted within the run
+		if ( row.mFirstKind == Epoch::ERowKind::Created && row.mLastKind == Epoch::ERowKind::Deleted ) continue;
+		outEpoch.mEntities.push_back( entity );
+	}
+	std::sort( outEpoch.mEntities.begin(), outEpoch.mEntities.end() );
+
+	entt::dense_map<entt::entity, uint32_t> rowOfEntity;
+	rowOfEntity.reserve( outEpoch.mEntities.size() );
+
+	for ( const entt::entity entity : outEpoch.mEntities ) {
+		const Row &row = mRows.find( entity )->second;
+
+		Epoch::ERowKind kind = Epoch::ERowKind::Updated;
+		if ( row.mFirstKind == Epoch::ERowKind::Created ) {
+			kind = Epoch::ERowKind::Created;
+			++outEpoch.mCreatedCount;
+		}
+		else if ( row.mLastKind == Epoch::ERowKind::Deleted ) {
+			kind = Epoch::ERowKind::Deleted;
+			++outEpoch.mDeletedCount;
+		}
+
+		rowOfEntity.emplace( entity, static_cast<uint32_t>( outEpoch.mRowKinds.size() ) );
+		outEpoch.mRowKinds.push_back( kind );
+		outEpoch.mPreviousEpochs.push_back( row.mPreviousEpoch );
+		outEpoch.mLastEpochs.push_back( row.mLastEpoch );
+	}
+
+	std::vector<std::pair<uint32_t, const Value *>> sortedValues;
+	for ( size_t index = 0; index < history_columns::size; ++index ) {
+		const size_t valueSize = kHistoryColumnSizes[index];
+		const Column &column = mColumns[index];
+		Epoch::Column &outColumn = outEpoch.mColumns[index];
+
+		sortedValues.clear();
+		for ( const auto &[entity, value] : column.mValues ) {
+			const auto it = rowOfEntity.find( entity );
+			if ( it != rowOfEntity.end() ) sortedValues.emplace_back( it->second, &value );
+		}
+		std::sort( sortedValues.begin(), sortedValues.end(), []( const auto &inLhs, const auto &inRhs ) { return inLhs.first < inRhs.first; } );
+
+		for ( const auto &[row, value] : sortedValues ) {
+			if ( value->mBefore != kAbsent ) {
+				outColumn.mBefore.mRows.push_back( row );
+				outColumn.mBefore.mBytes.insert( outColumn.mBefore.mBytes.end(), column.mBeforeBytes.begin() + value->mBefore, column.mBeforeBytes.begin() + value->mBefore + valueSize );
+			}
+
+			if ( value->mAfter != kAbsent ) {
+				outColumn.mAfter.mRows.push_back( row );
+				outColumn.mAfter.mBytes.insert( outColumn.mAfter.mBytes.end(), column.mAfterBytes.begin() + value->mAfter, column.mAfterBytes.begin() + value->mAfter + valueSize );
+			}
+		}
+	}
+
+	for ( const auto &[flag, change] : mContextChanges ) {
+		if ( change.mBefore != change.mAfter ) outEpoch.mContextChanges.push_back( change );
+	}
+
+	outEpoch.mEntityCount = outEpoch.mEntities.size();
+	outEpoch.mPayloadSize = outEpoch.GetMemoryUsage() - sizeof( Epoch );
+}
+
+void Cyclone::Core::History::EpochMerger::Clear()
+{
+	mRows.clear();
+	mColumns = {};
+	mContextChanges.clear();
+	mLastEpoch = Component::EpochNumber::Sentinel;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// Cyclone history
+#include "Cyclone/Core/History/Epoch.hpp"
+
+namespace Cyclone::Core::History
+{
+	/// @brief Folds a run of epochs, each applied or undone, into a single epoch with the net change of the whole run
+	/// @note Each entity and component keeps the before value of the first epoch touching it and the after value of the last one
+	class EpochMerger
+	{
+	public:
+		EpochMerger() = default;
+
+		/// @brief Adds the next epoch of the run, epochs must be added in the order they are applied and be resident
+		/// @param inInverse Adds the epoch as undone, its after side becomes the before side and created rows become deleted
+		/// @note Context changes are folded too, a flag keeps its first before value and its last after value
+		/// @note Values are copied, so the epoch may be spilled again once added
+		void					Add( const Epoch &inEpoch, bool inInverse = false );
+
+		/// @brief Writes the net change of every epoch added so far
+		/// @note Entities created and deleted within the run are dropped entirely
+		void					Build( Epoch &outEpoch ) const;
+
+		void					Clear();
+
+	protected:
+		static constexpr size_t kAbsent = std::numeric_limits<size_t>::max();
+
+		struct Row
+		{
+			Epoch::ERowKind			mFirstKind;
+			Epoch::ERowKind			mLastKind;
+			Component::EpochNumber	mPreviousEpoch;
+			Component::EpochNumber	mLastEpoch;
+		};
+
+		struct Value
+		{
+			size_t					mBefore = kAbsent;	///< Byte offset into mBeforeBytes, kAbsent if the component did not exist
+			size_t					mAfter = kAbsent;	///< Byte offset into mAfterBytes, kAbsent if the component did not exist
+		};
+
+		struct Column
+		{
+			entt::dense_map<entt::entity, Value> mValues;
+			std::vector<std::byte>	mBeforeBytes;
+			std::vector<std::byte>	mAfterBytes;
+		};
+
+		entt::dense_map<entt::entity, Row>			mRows;
+		std::array<Column, history_columns::size>	mColumns;
+		entt::dense_map<uint64_t, Epoch::ContextChange> mContextChanges;	///< Keyed by kind and key, first before value and last after value of each flag
+		Component::EpochNumber						mLastEpoch{ Component::EpochNumber::Sentinel };
+	};
+}
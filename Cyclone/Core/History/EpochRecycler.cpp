@@ -0,0 +1,91 @@
+#include "pch.h"
+#include "Cyclone/Core/History/EpochRecycler.hpp"
+
+std::unique_ptr<Cyclone::Core::History::Epoch> Cyclone::Core::History::EpochRecycler::Acquire()
+{
+	StartWorker();
+
+	{
+		std::lock_guard lock( mMutex );
+		if ( !mSpare.empty() ) {
+			std::unique_ptr<Epoch> epoch = std::move( mSpare.back() );
+			mSpare.pop_back();
+
+			// Topped up in batches, so the worker does not wake up for every action
+			if ( mSpare.size() <= kSpareEpochs / 2 ) mSignal.notify_one();
+			return epoch;
+		}
+	}
+
+	mSignal.notify_one();
+	return std::make_unique<Epoch>();
+}
+
+void Cyclone::Core::History::EpochRecycler::Recycle( std::unique_ptr<Epoch> inEpoch )
+{
+	StartWorker();
+
+	{
+		std::lock_guard lock( mMutex );
+		mRecycled.push_back( std::move( inEpoch ) );
+	}
+
+	mSignal.notify_one();
+}
+
+void Cyclone::Core::History::EpochRecycler::Enqueue( std::shared_ptr<void> inGarbage )
+{
+	StartWorker();
+
+	{
+		std::lock_guard lock( mMutex );
+		mGarbage.push_back( std::move( inGarbage ) );
+	}
+
+	mSignal.notify_one();
+}
+
+void Cyclone::Core::History::EpochRecycler::StartWorker()
+{
+	if ( !mWorker.joinable() ) {
+		mWorker = std::jthread( [this]( std::stop_token inStopToken ) { WorkerThread( inStopToken ); } );
+	}
+}
+
+void Cyclone::Core::History::EpochRecycler::WorkerThread( std::stop_token inStopToken )
+{
+	std::vector<std::unique_ptr<Epoch>> recycled;
+	std::vector<std::shared_ptr<void>> garbage;
+
+	std::unique_lock lock( mMutex );
+	while ( mSignal.wait( lock, inStopToken, [this] { return !mGarbage.empty() || !mRecycled.empty() || mSpare.size() <= kSpareEpochs / 2; } ) ) {
+		// Swapped, so both sides keep their capacity and queueing never allocates once warmed up
+		recycled.swap( mRecycled );
+		garbage.swap( mGarbage );
+		const size_t spareCount = mSpare.size();
+
+		lock.unlock();
+
+		garbage.clear();
+		for ( std::unique_ptr<Epoch> &epoch : recycled ) {
+			// Large buffers would only be trimmed again by Epoch::Build(), so they are freed here
+			if ( epoch->GetMemoryUsage() > kMaxSpareBytes ) *epoch = Epoch{};
+			else epoch->Clear();
+		}
+		while ( spareCount + recycled.size() < kSpareEpochs ) {
+			recycled.push_back( std::make_unique<Epoch>() );
+		}
+
+		lock.lock();
+
+		while ( !recycled.empty() && mSpare.size() < kSpareEpochs ) {
+			mSpare.push_back( std::move( recycled.back() ) );
+			recycled.pop_back();
+		}
+
+		// Anything beyond the pool is freed without holding the lock
+		lock.unlock();
+		recycled.clear();
+		lock.lock();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+// Cyclone utils
+#include "Cyclone/Util/NonCopyable.hpp"
+
+// Cyclone history
+#include "Cyclone/Core/History/Epoch.hpp"
+
+// STL
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace Cyclone::Core::History
+{
+	/// @brief Hands out cleared epochs and frees discarded history on a worker thread, so neither allocates nor frees on the UI thread
+	/// @note Pooled epochs keep the capacity of their buffers, so building a small epoch into one does not allocate
+	class EpochRecycler : public Cyclone::Util::NonCopyable
+	{
+	public:
+		static constexpr size_t kSpareEpochs = 32;			///< Cleared epochs kept ready, topped up by the worker once half of them are taken
+		static constexpr size_t kMaxSpareBytes = 16 * 1024;	///< Discarded epochs holding more are freed instead of pooled
+
+		EpochRecycler() = default;
+
+		/// @brief A cleared epoch from the pool, only allocated when the pool ran dry
+		std::unique_ptr<Epoch>	Acquire();
+
+		/// @brief Clears a discarded epoch on the worker, then returns it to the pool
+		void					Recycle( std::unique_ptr<Epoch> inEpoch );
+
+		/// @brief Destroys any other discarded object, such as a scratch registry, on the worker
+		/// @note Taken by value, so callers hand their object over with std::move rather than losing it silently
+		template<typename T>
+		void					Destroy( T inObject ) { Enqueue( std::make_shared<T>( std::move( inObject ) ) ); }
+
+	protected:
+		void					Enqueue( std::shared_ptr<void> inGarbage );
+		void					StartWorker();
+		void					WorkerThread( std::stop_token inStopToken );
+
+		std::mutex					mMutex;
+		std::condition_variable_any	mSignal;
+		std::vector<std::unique_ptr<Epoch>> mSpare;
+		std::vector<std::unique_ptr<Epoch>> mRecycled;
+		std::vector<std::shared_ptr<void>> mGarbage;
+		std::jthread				mWorker;	///< Declared last, so it is joined before the queues are destroyed
+	};
+}
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "pch.h"
+#include "Cyclone/Core/LevelDiff.hpp"
+
+// Cyclone utils
+#include "Cyclone/Util/Hash.hpp"
+#include "Cyclone/Util/Parallel.hpp"
+
+// Cyclone history
+#include "Cyclone/Core/History/Epoch.hpp"
+
+// Cyclone serialization
+#include "Cyclone/Core/Serialization/LevelFile.hpp"
+
+// STL
+#include <execution>
+
+namespace
+{
+	using Cyclone::Core::LevelDiff;
+	using Cyclone::Core::History::history_columns;
+
+	template<typename T>
+	uint64_t HashComponent( const entt::sparse_set &inStorage, entt::entity inEntity, uint64_t inSeed )
+	{
+		const T &value = static_cast<const entt::storage_for_t<T> &>( inStorage ).get( inEntity );
+		const entt::id_type type = entt::type_hash<T>::value();
+		return Cyclone::Util::Fnv1a64( std::as_bytes( std::span( &value, 1 ) ), Cyclone::Util::Fnv1a64( std::as_bytes( std::span( &type, 1 ) ), inSeed ) );
+	}
+
+	using HashComponentFn = uint64_t ( * )( const entt::sparse_set &, entt::entity, uint64_t );
+
+	constexpr auto kHashComponent = [] <typename... Types>( entt::type_list<Types...> ) { return std::array<HashComponentFn, sizeof...( Types )>{ &HashComponent<Types>... }; }( history_columns{} );
+	constexpr auto kColumnIds = [] <typename... Types>( entt::type_list<Types...> ) { return std::array<entt::id_type, sizeof...( Types )>{ entt::type_hash<Types>::value()... }; }( history_columns{} );
+
+	using ColumnStorages = std::array<const entt::sparse_set *, history_columns::size>;
+
+	ColumnStorages GetColumnStorages( const entt::registry &inRegistry )
+	{
+		ColumnStorages storages;
+		for ( size_t column = 0; column < history_columns::size; ++column ) {
+			storages[column] = inRegistry.storage( kColumnIds[column] );
+		}
+		return storages;
+	}
+
+	uint64_t HashEntity( const ColumnStorages &inStorages, entt::entity inEntity )
+	{
+		uint64_t hash = Cyclone::Util::kFnv1a64Offset;
+		for ( size_t column = 0; column < history_columns::size; ++column ) {
+			if ( inStorages[column] && inStorages[column]->contains( inEntity ) ) {
+				hash = kHashComponent[column]( *inStorages[column], inEntity, hash );
+			}
+		}
+		return hash;
+	}
+
+	/// A range of entities compared by one worker, every entity in [mFirst, mLast) of both levels
+	struct DiffTask
+	{
+		entt::entity			mFirst;
+		entt::entity			mLast;
+		bool					mIsLast = false;	///< Also covers every entity after mFirst
+		LevelDiff::Result		mResult;
+	};
+
+	std::span<const LevelDiff::EntityHash> GetRange( std::span<const LevelDiff::EntityHash> inHashes, const DiffTask &inTask )
+	{
+		const auto byEntity = []( const LevelDiff::EntityHash &inLhs, entt::entity inRhs ) { return inLhs.mEntity < inRhs; };
+		const auto first = std::lower_bound( inHashes.begin(), inHashes.end(), inTask.mFirst, byEntity );
+		const auto last = inTask.mIsLast ? inHashes.end() : std::lower_bound( first, inHashes.end(), inTask.mLast, byEntity );
+		return { first, last };
+	}
+}
+
+uint64_t Cyclone::Core::LevelDiff::sHashEntity( const entt::registry &inRegistry, entt::entity inEntity )
+{
+	return HashEntity( GetColumnStorages( inRegistry ), inEntity );
+}
+
+void Cyclone::Core::LevelDiff::sHashLevel( const entt::registry &inRegistry, bool inAllowParallel, std::vector<EntityHash> &outHashes )
+{
+	outHashes.clear();
+
+	std::vector<entt::entity> entities;
+	Serialization::LevelFile::sGatherEntities( inRegistry, entities );
+	outHashes.resize( entities.size() );
+	std::transform( entities.begin(), entities.end(), outHashes.begin(), []( entt::entity inEntity ) { return EntityHash{ inEntity, 0 }; } );
+
+	const bool parallel = inAllowParallel && outHashes.size() >= kParallelEntities;
+	const auto byEntity = []( const EntityHash &inLhs, const EntityHash &inRhs ) { return inLhs.mEntity < inRhs.mEntity; };
+	if ( parallel ) {
+		std::sort( std::execution::par, outHashes.begin(), outHashes.end(), byEntity );
+	}
+	else {
+		std::sort( outHashes.begin(), outHashes.end(), byEntity );
+	}
+
+	std::vector<std::span<EntityHash>> tasks;
+	for ( size_t begin = 0; begin < outHashes.size(); begin += kTaskEntities ) {
+		tasks.emplace_back( outHashes.data() + begin, std::min( kTaskEntities, outHashes.size() - begin ) );
+	}
+
+	const ColumnStorages storages = GetColumnStorages( inRegistry );
+	Cyclone::Util::ForEachTask( tasks, parallel, [&storages]( std::span<EntityHash> inTask ) {
+		for ( EntityHash &entityHash : inTask ) {
+			entityHash.mHash = HashEntity( storages, entityHash.mEntity );
+		}
+	} );
+}
+
+void Cyclone::Core::LevelDiff::sDiff( std::span<const EntityHash> inBefore, std::span<const EntityHash> inAfter, bool inAllowParallel, Result &outResult )
+{
+	outResult = {};
+
+	// Split the identifiers at every kTaskEntities of the larger level, each task merges its share of both lists
+	const std::span<const EntityHash> larger = inAfter.size() >= inBefore.size() ? inAfter : inBefore;
+	std::vector<DiffTask> tasks;
+	tasks.push_back( { entt::entity{ 0 } } );
+	for ( size_t split = kTaskEntities; split < larger.size(); split += kTaskEntities ) {
+		tasks.back().mLast = larger[split].mEntity;
+		tasks.push_back( { larger[split].mEntity } );
+	}
+	tasks.back().mIsLast = true;
+
+	const bool parallel = inAllowParallel && larger.size() >= kParallelEntities;
+	Cyclone::Util::ForEachTask( tasks, parallel, [inBefore, inAfter]( DiffTask &ioTask ) {
+		const std::span<const EntityHash> before = GetRange( inBefore, ioTask );
+		const std::span<const EntityHash> after = GetRange( inAfter, ioTask );
+
+		auto beforeIt = before.begin();
+		auto afterIt = after.begin();
+		while ( beforeIt != before.end() || afterIt != after.end() ) {
+			if ( afterIt == after.end() || ( beforeIt != before.end() && beforeIt->mEntity < afterIt->mEntity ) ) {
+				ioTask.mResult.mRemoved.push_back( ( beforeIt++ )->mEntity );
+			}
+			else if ( beforeIt == before.end() || afterIt->mEntity < beforeIt->mEntity ) {
+				ioTask.mResult.mAdded.push_back( ( afterIt++ )->mEntity );
+			}
+			else {
+				if ( beforeIt->mHash != afterIt->mHash ) ioTask.mResult.mModified.push_back( afterIt->mEntity );
+				++beforeIt;
+				++afterIt;
+			}
+		}
+	} );
+
+	// Tasks cover increasing identifiers, so appending keeps every list sorted
+	for ( const DiffTask &task : tasks ) {
+		outResult.mAdded.insert( outResult.mAdded.end(), task.mResult.mAdded.begin(), task.mResult.mAdded.end() );
+		outResult.mRemoved.insert( outResult.mRemoved.end(), task.mResult.mRemoved.begin(), task.mResult.mRemoved.end() );
+		outResult.mModified.insert( outResult.mModified.end(), task.mResult.mModified.begin(), task.mResult.mModified.end() );
+	}
+}
+
+void Cyclone::Core::LevelDiff::sDiff( const entt::registry &inBefore, const entt::registry &inAfter, Result &outResult )
+{
+	std::vector<EntityHash> before;
+	std::vector<EntityHash> after;
+	sHashLevel( inBefore, true, before );
+	sHashLevel( inAfter, true, after );
+	sDiff( before, after, true, outResult );
+}
\ No newline at end of file
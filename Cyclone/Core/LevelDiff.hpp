@@ -0,0 +1,42 @@
+#pragma once
+
+// STL
+#include <span>
+
+namespace Cyclone::Core
+{
+	/// @brief Compares levels through a content hash of each entity instead of component by component
+	/// @note An entity hash is 64 bit FNV-1a over each history component the entity holds, tagged with the type of the component, so it is the same in every session
+	class LevelDiff
+	{
+	public:
+		static constexpr size_t kParallelEntities = 32768;	///< Smaller levels are hashed and compared on the calling thread
+		static constexpr size_t kTaskEntities = 65536;		///< Entities hashed or compared by one worker
+
+		struct EntityHash
+		{
+			entt::entity			mEntity;
+			uint64_t				mHash;
+		};
+
+		/// Each list is sorted by entity
+		struct Result
+		{
+			std::vector<entt::entity> mAdded;		///< Only in the level compared against the other
+			std::vector<entt::entity> mRemoved;		///< Only in the other level
+			std::vector<entt::entity> mModified;	///< In both with different contents
+
+			bool					IsEmpty() const { return mAdded.empty() && mRemoved.empty() && mModified.empty(); }
+		};
+
+		static uint64_t			sHashEntity( const entt::registry &inRegistry, entt::entity inEntity );
+
+		/// @brief Hashes every entity of an entity class, sorted by entity
+		static void				sHashLevel( const entt::registry &inRegistry, bool inAllowParallel, std::vector<EntityHash> &outHashes );
+
+		/// @brief Joins two sorted lists of hashes, inAfter is the level compared against inBefore
+		static void				sDiff( std::span<const EntityHash> inBefore, std::span<const EntityHash> inAfter, bool inAllowParallel, Result &outResult );
+
+		static void				sDiff( const entt::registry &inBefore, const entt::registry &inAfter, Result &outResult );
+	};
+}
\ No newline at end of file
@@ -5,6 +5,10 @@
 #include "Cyclone/Core/Entity/PointDebug.hpp"
 #include "Cyclone/Core/Entity/InfoDebug.hpp"
 
+#include "Cyclone/Core/Serialization/LevelFile.hpp"
+#include "Cyclone/Core/Serialization/LevelText.hpp"
+#include "Cyclone/Core/Serialization/LevelBaker.hpp"
+
 Cyclone::Core::LevelInterface::LevelInterface()
 {
 	mLevel = std::make_unique<Level>();
@@ -15,9 +19,22 @@ void Cyclone::Core::LevelInterface::Initialize()
 {
 	mLevel->Initialize();
 	mEntityContext.Register();
+	mEntityContext.TrackRegistry( GetRegistry() );
 
 	mSelectionTool.ClearSelection();
 
+	// Recover the session which did not shut down cleanly instead of starting a new one
+	const auto loadLevel = [this]( const std::filesystem::path &inPath, entt::registry &ioRegistry ) {
+		if ( !Serialization::LevelFile::sLoad( inPath, ioRegistry ) ) return false;
+		mLevelPath = inPath;
+		return true;
+	};
+
+	if ( mEntityContext.OpenActionJournal( History::ActionJournal::sGetDefaultPath(), GetRegistry(), loadLevel ) ) {
+		ResetAutosave();
+		return;
+	}
+
 	mEntityContext.BeginAction();
 
 	mEntityContext.CreateEntity( "point_debug"_hs, GetRegistry(), { 0.0, 0.0, 0.0 } );
@@ -49,6 +66,8 @@ void Cyclone::Core::LevelInterface::Initialize()
 	}
 	mEntityContext.EndAction();
 
+	ResetAutosave();
+
 	//entt::registry save;
 	//Cyclone::Core::Entity::BaseEntity<Cyclone::Core::Entity::InfoDebug>::sSaveHistory( GetRegistry(), save, i );
 	//
@@ -62,6 +81,186 @@ void Cyclone::Core::LevelInterface::Initialize()
 
 }
 
+void Cyclone::Core::LevelInterface::NewLevel()
+{
+	mLevelStreamer.Cancel();
+
+	auto level = std::make_unique<Level>();
+	level->Initialize();
+
+	ReplaceLevel( std::move( level ), {} );
+}
+
+bool Cyclone::Core::LevelInterface::OpenLevelPartial( const std::filesystem::path &inPath, const Serialization::LevelFilter &inFilter )
+{
+	CancelLevelStream();
+
+	auto level = std::make_unique<Level>();
+	level->Initialize();
+
+	std::vector<entt::entity> unloaded;
+	if ( !Serialization::LevelFile::sLoadPartial( inPath, inFilter, level->GetRegistry(), unloaded ) ) return false;
+
+	ReplaceLevel( std::move( level ), inPath );
+	mLevelFilter = inFilter;
+	mUnloadedEntities = std::move( unloaded );
+	return true;
+}
+
+bool Cyclone::Core::LevelInterface::SaveLevel( const std::filesystem::path &inPath )
+{
+	if ( !mEntityContext.CanAquireActionLock() ) return false;
+
+	// A level still arriving is incomplete, and a failed stream leaves the previous level untouched
+	if ( mLevelStreamer.GetState() == Serialization::LevelStreamer::EState::Streaming ) return false;
+
+	// The unloaded entities are read back from the level file, which an autosave may still be reading as well
+	if ( !mUnloadedEntities.empty() ) mLevelAutosave.Wait();
+
+	// Saving to the same file only appends what changed, anything unexpected about the file falls back to rewriting it
+	bool saved = false;
+	std::vector<entt::entity> changed;
+	if ( inPath == mLevelPath && mEntityContext.GetEntitiesChangedSinceSave( changed ) ) {
+		saved = changed.empty() ? std::filesystem::exists( inPath ) : Serialization::LevelFile::sAppend( GetRegistry(), inPath, changed, mUnloadedEntities );
+	}
+
+	if ( !saved && !Serialization::LevelFile::sSavePartial( GetRegistry(), inPath, mUnloadedEntities, mLevelPath ) ) return false;
+
+	mLevelPath = inPath;
+	mEntityContext.MarkLevelSaved( inPath );
+	ResetAutosave();
+	return true;
+}
+
+bool Cyclone::Core::LevelInterface::ImportLevelText( const std::filesystem::path &inPath )
+{
+	CancelLevelStream();
+
+	auto level = std::make_unique<Level>();
+	level->Initialize();
+
+	if ( !Serialization::LevelText::sLoad( inPath, mEntityContext.GetEntityMetaContext(), level->GetRegistry() ) ) return false;
+
+	ReplaceLevel( std::move( level ), {} );
+	return true;
+}
+
+bool Cyclone::Core::LevelInterface::ExportLevelText( const std::filesystem::path &inPath ) const
+{
+	if ( !mEntityContext.CanAquireActionLock() ) return false;
+	if ( mLevelStreamer.GetState() == Serialization::LevelStreamer::EState::Streaming ) return false;
+
+	return Serialization::LevelText::sSave( GetRegistry(), mEntityContext.GetEntityMetaContext(), inPath );
+}
+
+bool Cyclone::Core::LevelInterface::BakeLevel( const std::filesystem::path &inPath ) const
+{
+	if ( !mEntityContext.CanAquireActionLock() ) return false;
+	if ( mLevelStreamer.GetState() == Serialization::LevelStreamer::EState::Streaming ) return false;
+
+	return Serialization::LevelBaker::sBake( GetRegistry(), inPath );
+}
+
+bool Cyclone::Core::LevelInterface::DiffLevelAgainstSave( LevelDiff::Result &outResult ) const
+{
+	if ( mLevelPath.empty() ) return false;
+
+	// Only the part of the file which was loaded is compared
+	entt::registry saved;
+	std::vector<entt::entity> unloaded;
+	if ( !Serialization::LevelFile::sLoadPartial( mLevelPath, mLevelFilter, saved, unloaded ) ) return false;
+
+	LevelDiff::sDiff( saved, GetRegistry(), outResult );
+	return true;
+}
+
+void Cyclone::Core::LevelInterface::StreamLevel( const std::filesystem::path &inPath )
+{
+	CancelLevelStream();
+
+	// Known before the worker sorts the cells, otherwise the first chunks are ordered by the origin
+	const std::array focus = { mOrthographicContext.mCenter2D, mPerspectiveContext.mCenter3D };
+	mLevelStreamer.SetFocus( focus );
+	mLevelStreamer.Start( inPath );
+}
+
+void Cyclone::Core::LevelInterface::UpdateLevelStream()
+{
+	if ( mLevelStreamer.GetState() != Serialization::LevelStreamer::EState::Streaming ) return;
+
+	// Swap the level in once every identifier is known, the history starts from the reserved but still empty entities
+	if ( !mLevelStreamer.IsReserved() ) {
+		auto level = std::make_unique<Level>();
+		level->Initialize();
+		if ( !mLevelStreamer.ReserveEntities( level->GetRegistry() ) ) return;
+
+		ReplaceLevel( std::move( level ), mLevelStreamer.GetPath() );
+		mEntityContext.SetStreamingLevel( true );
+	}
+
+	const std::array focus = { mOrthographicContext.mCenter2D, mPerspectiveContext.mCenter3D };
+	mLevelStreamer.SetFocus( focus );
+
+	mLevelStreamer.Commit( GetRegistry(), kStreamBudget, mStreamedEntities );
+	mEntityContext.CommitStreamedEntities( GetRegistry(), mStreamedEntities );
+
+	if ( mLevelStreamer.IsFinished() ) {
+		mEntityContext.SetStreamingLevel( false );
+		mLevelStreamer.Cancel();
+	}
+}
+
+void Cyclone::Core::LevelInterface::UpdateAutosave()
+{
+	// A level still arriving is incomplete
+	if ( mLevelStreamer.GetState() == Serialization::LevelStreamer::EState::Streaming ) return;
+	if ( std::chrono::steady_clock::now() - mAutosaveTime < Serialization::LevelAutosave::kInterval ) return;
+
+	// Undoing back to the saved epoch counts as unchanged, every new action gets an epoch of its own
+	if ( mEntityContext.GetUndoEpoch() == mAutosaveEpoch ) {
+		mAutosaveTime = std::chrono::steady_clock::now();
+		return;
+	}
+
+	if ( !mLevelAutosave.Start( GetRegistry(), Serialization::LevelAutosave::sGetPath( mLevelPath ), mUnloadedEntities, mLevelPath ) ) return;
+	ResetAutosave();
+}
+
+void Cyclone::Core::LevelInterface::ResetAutosave()
+{
+	mAutosaveEpoch = mEntityContext.GetUndoEpoch();
+	mAutosaveTime = std::chrono::steady_clock::now();
+}
+
+void Cyclone::Core::LevelInterface::CancelLevelStream()
+{
+	const bool isPartial = mLevelStreamer.IsReserved();
+	mLevelStreamer.Cancel();
+
+	// A level cut off while streaming must not be saved over its file, it is dropped
+	if ( isPartial ) {
+		auto level = std::make_unique<Level>();
+		level->Initialize();
+		ReplaceLevel( std::move( level ), {} );
+	}
+}
+
+void Cyclone::Core::LevelInterface::ReplaceLevel( std::unique_ptr<Level> inLevel, const std::filesystem::path &inPath )
+{
+	assert( mEntityContext.CanAquireActionLock() && "Cannot replace the level during an action!" );
+
+	mSelectionTool.ClearSelection();
+
+	mLevel = std::move( inLevel );
+	mLevelPath = inPath;
+	mLevelFilter = {};
+	mUnloadedEntities.clear();
+
+	mEntityContext.TrackRegistry( GetRegistry() );
+	mEntityContext.ResetHistory( GetRegistry(), inPath );
+	ResetAutosave();
+}
+
 void Cyclone::Core::LevelInterface::SetDevice( ID3D11Device3 *inDevice )
 {
 	if ( mDevice ) {
@@ -130,5 +329,9 @@ void Cyclone::Core::LevelInterface::OnUpdateEnd()
 				continue;
 			}
 		}
+
+		UpdateLevelStream();
+		UpdateAutosave();
+		mEntityContext.CompactHistory();
 	}
 }
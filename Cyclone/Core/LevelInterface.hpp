@@ -5,6 +5,7 @@
 
 // Cyclone core
 #include "Cyclone/Core/Level.hpp"
+#include "Cyclone/Core/LevelDiff.hpp"
 #include "Cyclone/Core/EntityContext.hpp"
 #include "Cyclone/Core/Editor/GridContext.hpp"
 #include "Cyclone/Core/Editor/OrthographicContext.hpp"
@@ -12,11 +13,17 @@
 #include "Cyclone/Core/Tool/SelectionToolContext.hpp"
 #include "Cyclone/Core/Tool/SelectionTransformToolContext.hpp"
 
+// Cyclone serialization
+#include "Cyclone/Core/Serialization/LevelStreamer.hpp"
+#include "Cyclone/Core/Serialization/LevelAutosave.hpp"
+
 namespace Cyclone::Core
 {
 	class LevelInterface : public Cyclone::Util::NonCopyable
 	{
 	public:
+		static constexpr std::chrono::milliseconds kStreamBudget{ 4 };	///< Time each frame may spend committing streamed chunks
+
 		LevelInterface();
 
 		void						Initialize();
@@ -26,6 +33,47 @@ namespace Cyclone::Core
 
 		void						OnUpdateEnd();
 
+		/// @brief Replaces the level with an empty one, the undo history starts over
+		void						NewLevel();
+
+		/// @brief Replaces the level with the partitions of the file at inPath matching inFilter, the current level is kept if the file cannot be loaded
+		/// @note Loaded at once rather than streamed, the entities left out keep their identifiers and every save writes them back as they are in the file
+		bool						OpenLevelPartial( const std::filesystem::path &inPath, const Serialization::LevelFilter &inFilter );
+
+		/// @brief Saves the level to inPath, which becomes the path of the level
+		/// @note Saving again to the same path only appends the entities changed since the last save
+		bool						SaveLevel( const std::filesystem::path &inPath );
+
+		/// @brief Replaces the level with the one stored at inPath once the file has been read, its entities then arrive over the following frames
+		/// @note The current level stays in place if the file cannot be loaded, the streamer reports the failure
+		void						StreamLevel( const std::filesystem::path &inPath );
+
+		/// @brief Stops a level being streamed, a level which already replaced the previous one is replaced by an empty one
+		void						CancelLevelStream();
+
+		/// @brief Replaces the level with the text level stored at inPath, the current level is kept if the file cannot be loaded
+		/// @note The imported level has no path, so the next save asks where to write it
+		bool						ImportLevelText( const std::filesystem::path &inPath );
+
+		/// @brief Writes the level as text to inPath, the path of the level is left as it is
+		bool						ExportLevelText( const std::filesystem::path &inPath ) const;
+
+		/// @brief Bakes the level into the runtime format at inPath, the path of the level is left as it is
+		bool						BakeLevel( const std::filesystem::path &inPath ) const;
+
+		/// @brief Lists the entities added, removed and modified since the level was last saved, by reading back its file
+		/// @return False if the level has no path or its file cannot be loaded
+		bool						DiffLevelAgainstSave( LevelDiff::Result &outResult ) const;
+
+		const Serialization::LevelStreamer & GetLevelStreamer() const	{ return mLevelStreamer; }
+		const Serialization::LevelAutosave & GetLevelAutosave() const	{ return mLevelAutosave; }
+
+		/// Path the level was last loaded from or saved to, empty for a level which was never saved
+		const std::filesystem::path & GetLevelPath() const				{ return mLevelPath; }
+
+		/// Entities of the level file left out by OpenLevelPartial(), none for a level loaded as a whole
+		size_t						GetUnloadedEntityCount() const		{ return mUnloadedEntities.size(); }
+
 		const ID3D11Device3 *		GetDevice() const					{ return mDevice.Get(); }
 		ID3D11Device3 *				GetDevice()							{ return mDevice.Get(); }
 
@@ -56,10 +104,25 @@ namespace Cyclone::Core
 		const Tool::SelectionTransformToolContext & GetSelectionTransformCtx() const { return mSelectionTransformTool; }
 
 	protected:
+		void						ReplaceLevel( std::unique_ptr<Level> inLevel, const std::filesystem::path &inPath );
+		void						UpdateLevelStream();
+
+		/// @brief Starts an autosave once kInterval has passed since the last save and the level changed meanwhile
+		void						UpdateAutosave();
+		void						ResetAutosave();
+
 		Microsoft::WRL::ComPtr<ID3D11Device3> mDevice;
 
 		std::unique_ptr<Level>		mLevel;
+		std::filesystem::path		mLevelPath;
+		Serialization::LevelFilter	mLevelFilter;		///< Parts of mLevelPath which were loaded
+		std::vector<entt::entity>	mUnloadedEntities;	///< Sorted, kept in mLevelPath and written back by every save
 		EntityContext				mEntityContext;
+		Serialization::LevelStreamer mLevelStreamer;
+		std::vector<entt::entity>	mStreamedEntities;	///< Reused for the entities committed each frame
+		Serialization::LevelAutosave mLevelAutosave;
+		size_t						mAutosaveEpoch = 0;	///< Undo epoch of the level as last saved or autosaved
+		std::chrono::steady_clock::time_point mAutosaveTime;
 
 		Editor::GridContext			mGridContext;
 		Editor::OrthographicContext mOrthographicContext;
@@ -0,0 +1,140 @@
+#include "pch.h"
+#include "Cyclone/Core/Serialization/LevelAutosave.hpp"
+
+// Cyclone utils
+#include "Cyclone/Util/TypeList.hpp"
+
+// STL
+#include <execution>
+
+template<typename T>
+void Cyclone::Core::Serialization::LevelAutosave::sCopyColumn( const entt::registry &inRegistry, ComponentColumns<level_components> &outSnapshot )
+{
+	std::vector<entt::entity> &entities = outSnapshot.GetEntities<T>();
+	std::vector<T> &values = outSnapshot.GetValues<T>();
+	entities.clear();
+	values.clear();
+
+	const auto *storage = inRegistry.storage<T>();
+	if ( !storage ) return;
+
+	// Both iterate the packed array in the same order, orphans are dropped by the worker
+	entities.assign( storage->entt::sparse_set::begin(), storage->entt::sparse_set::end() );
+	values.assign( storage->begin(), storage->end() );
+}
+
+struct Cyclone::Core::Serialization::LevelAutosave::DropOrphansFunctor
+{
+	template<typename T>
+	void Apply( ComponentColumns<level_components> &ioSnapshot, const entt::registry &inRegistry ) const
+	{
+		std::vector<entt::entity> &entities = ioSnapshot.GetEntities<T>();
+		std::vector<T> &values = ioSnapshot.GetValues<T>();
+
+		// Components of entities without an entity class are kept for the undo history only
+		size_t kept = 0;
+		for ( size_t row = 0; row < entities.size(); ++row ) {
+			if ( !inRegistry.valid( entities[row] ) ) continue;
+			entities[kept] = entities[row];
+			values[kept] = std::move( values[row] );
+			++kept;
+		}
+
+		entities.erase( entities.begin() + kept, entities.end() );
+		values.erase( values.begin() + kept, values.end() );
+	}
+};
+
+bool Cyclone::Core::Serialization::LevelAutosave::Start( const entt::registry &inRegistry, const std::filesystem::path &inPath, std::span<const entt::entity> inUnloaded, const std::filesystem::path &inSource )
+{
+	{
+		std::lock_guard lock( mMutex );
+		if ( mState == EState::Saving ) return false;
+	}
+
+	// The worker of the previous autosave has finished
+	if ( mWorker.joinable() ) mWorker.join();
+
+	const auto start = std::chrono::steady_clock::now();
+
+	// Each storage is copied by its own worker, the registry does not change meanwhile
+	static constexpr auto kCopyColumn = [] <typename... Types>( entt::type_list<Types...> ) { return std::array<CopyColumnFn, sizeof...( Types )>{ &sCopyColumn<Types>... }; }( level_components{} );
+	std::for_each( std::execution::par, kCopyColumn.begin(), kCopyColumn.end(), [&inRegistry, this]( CopyColumnFn inCopyColumn ) { inCopyColumn( inRegistry, mSnapshot ); } );
+
+	mPath = inPath;
+	mUnloaded.assign( inUnloaded.begin(), inUnloaded.end() );
+	mSource = inSource;
+	mProgress.store( 0.0f, std::memory_order_relaxed );
+	{
+		std::lock_guard lock( mMutex );
+		mState = EState::Saving;
+		mSnapshotMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+	}
+
+	mWorker = std::jthread( [this]() { WorkerThread(); } );
+	return true;
+}
+
+void Cyclone::Core::Serialization::LevelAutosave::Wait()
+{
+	if ( mWorker.joinable() ) mWorker.join();
+}
+
+Cyclone::Core::Serialization::LevelAutosave::EState Cyclone::Core::Serialization::LevelAutosave::GetState() const
+{
+	std::lock_guard lock( mMutex );
+	return mState;
+}
+
+double Cyclone::Core::Serialization::LevelAutosave::GetSnapshotMilliseconds() const
+{
+	std::lock_guard lock( mMutex );
+	return mSnapshotMilliseconds;
+}
+
+double Cyclone::Core::Serialization::LevelAutosave::GetWriteMilliseconds() const
+{
+	std::lock_guard lock( mMutex );
+	return mWriteMilliseconds;
+}
+
+std::filesystem::path Cyclone::Core::Serialization::LevelAutosave::sGetPath( const std::filesystem::path &inLevelPath )
+{
+	if ( !inLevelPath.empty() ) {
+		std::filesystem::path path = inLevelPath;
+		path.replace_extension( ".autosave" );
+		path += LevelFile::kExtension;
+		return path;
+	}
+
+	std::error_code error;
+	const std::filesystem::path directory = std::filesystem::temp_directory_path( error );
+	if ( error ) return {};
+
+	return directory / ( std::string( "Untitled.autosave" ) + LevelFile::kExtension );
+}
+
+void Cyclone::Core::Serialization::LevelAutosave::WorkerThread()
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	// Every entity of an entity class is in the entity type column
+	std::vector<entt::entity> entities = mSnapshot.mEntities[entt::type_list_index_v<Component::EntityType, level_components>];
+	std::sort( entities.begin(), entities.end() );
+
+	entt::registry registry;
+	LevelFile::sCreateEntities( entities, registry );
+	entities = {};
+
+	// Rebuilding the registry is counted as the first half, writing it as the second
+	Cyclone::Util::ApplyOverTypeList<level_components>( DropOrphansFunctor{}, mSnapshot, registry );
+	mSnapshot.MoveInto( registry );
+	mProgress.store( 0.5f, std::memory_order_relaxed );
+
+	const bool saved = !mPath.empty() && LevelFile::sSavePartial( registry, mPath, mUnloaded, mSource );
+	mProgress.store( 1.0f, std::memory_order_relaxed );
+
+	std::lock_guard lock( mMutex );
+	mState = saved ? EState::Saved : EState::Failed;
+	mWriteMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+// Cyclone utils
+#include "Cyclone/Util/NonCopyable.hpp"
+
+// Cyclone serialization
+#include "Cyclone/Core/Serialization/LevelFile.hpp"
+
+// STL
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace Cyclone::Core::Serialization
+{
+	/// @brief Saves a copy of the level on a worker thread, so editing goes on while it is written
+	/// @note The copy is a bulk copy of every level storage taken on the calling thread, the worker rebuilds a registry from it and writes it with LevelFile::sSavePartial()
+	class LevelAutosave : public Cyclone::Util::NonCopyable
+	{
+	public:
+		static constexpr std::chrono::seconds kInterval{ 60 };	///< Time between autosaves while the level keeps changing
+
+		enum class EState : uint8_t
+		{
+			Idle,
+			Saving,
+			Saved,
+			Failed,
+		};
+
+		LevelAutosave() = default;
+		~LevelAutosave() { Wait(); }
+
+		/// @brief Copies every level storage of inRegistry and writes them to inPath on the worker
+		/// @note Must be called between actions, the registry is only read until this returns
+		/// @param inUnloaded Entities of a partially loaded level, written as they are in inSource with LevelFile::sSavePartial()
+		/// @return False while the previous autosave is still being written, nothing is copied then
+		bool					Start( const entt::registry &inRegistry, const std::filesystem::path &inPath, std::span<const entt::entity> inUnloaded = {}, const std::filesystem::path &inSource = {} );
+
+		/// @brief Blocks until the autosave being written is done
+		void					Wait();
+
+		EState					GetState() const;
+		float					GetProgress() const { return mProgress.load( std::memory_order_relaxed ); }
+		double					GetSnapshotMilliseconds() const;	///< Time the last copy held up the calling thread
+		double					GetWriteMilliseconds() const;		///< Time the worker took for the last autosave
+
+		/// @brief Autosaves go next to the level, or to the temporary directory for a level which was never saved
+		static std::filesystem::path sGetPath( const std::filesystem::path &inLevelPath );
+
+	protected:
+		using CopyColumnFn = void ( * )( const entt::registry &, ComponentColumns<level_components> & );
+
+		template<typename T>
+		static void				sCopyColumn( const entt::registry &inRegistry, ComponentColumns<level_components> &outSnapshot );
+
+		struct DropOrphansFunctor;
+
+		void					WorkerThread();
+
+		ComponentColumns<level_components> mSnapshot;	///< Owned by the worker while it runs
+		std::filesystem::path	mPath;
+		std::vector<entt::entity> mUnloaded;
+		std::filesystem::path	mSource;
+
+		mutable std::mutex		mMutex;		///< Guards the state and timings shared with the worker
+		EState					mState = EState::Idle;
+		double					mSnapshotMilliseconds = 0.0;
+		double					mWriteMilliseconds = 0.0;
+		std::atomic<float>		mProgress = 0.0f;
+		std::jthread			mWorker;	///< Declared last, so it is joined before the snapshot is destroyed
+	};
+}
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "pch.h"
+#include "Cyclone/Core/Serialization/LevelBaker.hpp"
+
+// Cyclone utils
+#include "Cyclone/Util/MappedFile.hpp"
+#include "Cyclone/Util/Parallel.hpp"
+
+// Cyclone components
+#include "Cyclone/Core/Component/EntityType.hpp"
+#include "Cyclone/Core/Component/EntityCategory.hpp"
+#include "Cyclone/Core/Component/Position.hpp"
+#include "Cyclone/Core/Component/BoundingBox.hpp"
+
+// Cyclone serialization
+#include "Cyclone/Core/Serialization/LevelFile.hpp"
+
+// STL
+#include <execution>
+
+namespace
+{
+	using Cyclone::Core::Serialization::LevelBaker;
+
+	static_assert( sizeof( LevelBaker::FileHeader ) == 32 );
+	static_assert( sizeof( LevelBaker::CellEntry ) == 32 );
+	static_assert( sizeof( LevelBaker::CellHeader ) == 40 );
+	static_assert( sizeof( LevelBaker::BakedEntity ) == 28 );
+
+	constexpr uint64_t Align( uint64_t inOffset, uint64_t inAlignment )
+	{
+		return ( inOffset + inAlignment - 1 ) & ~( inAlignment - 1 );
+	}
+
+	/// Cell table right after the file header, blobs after it
+	constexpr uint64_t kCellTableOffset = sizeof( LevelBaker::FileHeader );
+
+	/// Entity placed in its cell, sorting these groups the level by cell and then by entity type
+	struct BakeRow
+	{
+		std::array<int32_t, 3>	mCell;
+		entt::id_type			mEntityType;
+		entt::entity			mEntity;
+
+		bool					operator < ( const BakeRow &inRhs ) const { return std::tie( mCell, mEntityType, mEntity ) < std::tie( inRhs.mCell, inRhs.mEntityType, inRhs.mEntity ); }
+	};
+
+	/// Rows of one cell and where its blob goes
+	struct BakeCell
+	{
+		std::span<const BakeRow> mRows;
+		uint32_t				mTypeRunCount = 0;
+		uint64_t				mOffset = 0;
+		uint64_t				mEntitiesOffset = 0;
+		uint64_t				mSize = 0;
+	};
+
+	std::array<double, 4> ToArray( Cyclone::Math::Vector4D inValue )
+	{
+		std::array<double, 4> values;
+		_mm256_storeu_pd( values.data(), inValue.mVector );
+		return values;
+	}
+
+	int32_t GetCell( double inCoordinate )
+	{
+		const double cell = std::floor( inCoordinate / LevelBaker::kCellSize );
+		return static_cast<int32_t>( std::clamp( cell, static_cast<double>( std::numeric_limits<int32_t>::min() ), static_cast<double>( std::numeric_limits<int32_t>::max() ) ) );
+	}
+
+	/// Storages read while baking, missing ones leave their values at zero
+	struct BakeSources
+	{
+		const entt::storage_for_t<Cyclone::Core::Component::EntityCategory> *mCategories;
+		const entt::storage_for_t<Cyclone::Core::Component::Position> *mPositions;
+		const entt::storage_for_t<Cyclone::Core::Component::BoundingBox> *mBounds;
+	};
+
+	void BakeBlob( const BakeSources &inSources, const BakeCell &inCell, std::byte *outBlob )
+	{
+		const std::array<int32_t, 3> &cell = inCell.mRows.front().mCell;
+		const std::array<double, 3> origin = { cell[0] * LevelBaker::kCellSize, cell[1] * LevelBaker::kCellSize, cell[2] * LevelBaker::kCellSize };
+
+		// Every center and extent of the cell fits in kMaxQuantized steps
+		double largest = 0.0;
+		if ( inSources.mBounds ) {
+			for ( const BakeRow &row : inCell.mRows ) {
+				if ( !inSources.mBounds->contains( row.mEntity ) ) continue;
+				const auto &bounds = inSources.mBounds->get( row.mEntity ).mValue;
+				const std::array<double, 4> center = ToArray( bounds.mCenter );
+				const std::array<double, 4> extent = ToArray( bounds.mExtent );
+				for ( size_t axis = 0; axis < 3; ++axis ) {
+					largest = std::max( { largest, std::abs( center[axis] ), std::abs( extent[axis] ) } );
+				}
+			}
+		}
+		const float scale = static_cast<float>( largest / LevelBaker::kMaxQuantized );
+
+		LevelBaker::CellHeader header{};
+		header.mOrigin[0] = origin[0];
+		header.mOrigin[1] = origin[1];
+		header.mOrigin[2] = origin[2];
+		header.mBoundsScale = scale;
+		header.mTypeRunCount = inCell.mTypeRunCount;
+		header.mEntityCount = static_cast<uint32_t>( inCell.mRows.size() );
+		header.mEntitiesOffset = static_cast<uint32_t>( inCell.mEntitiesOffset );
+		std::memcpy( outBlob, &header, sizeof( header ) );
+
+		std::byte *typeRuns = outBlob + sizeof( LevelBaker::CellHeader );
+		std::byte *entities = outBlob + inCell.mEntitiesOffset;
+		LevelBaker::TypeRun typeRun{ inCell.mRows.front().mEntityType, 0 };
+		for ( const BakeRow &row : inCell.mRows ) {
+			if ( row.mEntityType != typeRun.mEntityType ) {
+				std::memcpy( typeRuns, &typeRun, sizeof( typeRun ) );
+				typeRuns += sizeof( typeRun );
+				typeRun = { row.mEntityType, 0 };
+			}
+			++typeRun.mCount;
+
+			LevelBaker::BakedEntity baked{};
+			if ( inSources.mCategories && inSources.mCategories->contains( row.mEntity ) ) {
+				baked.mEntityCategory = static_cast<uint32_t>( inSources.mCategories->get( row.mEntity ) );
+			}
+
+			// Rounding the position and the center both widen the extent, so the baked bounds still contain the original ones
+			std::array<double, 3> error{};
+			if ( inSources.mPositions && inSources.mPositions->contains( row.mEntity ) ) {
+				const std::array<double, 4> position = ToArray( inSources.mPositions->get( row.mEntity ).mValue );
+				for ( size_t axis = 0; axis < 3; ++axis ) {
+					const double local = position[axis] - origin[axis];
+					baked.mPosition[axis] = static_cast<float>( local );
+					error[axis] = std::abs( local - static_cast<double>( baked.mPosition[axis] ) );
+				}
+			}
+
+			if ( scale > 0.0f && inSources.mBounds && inSources.mBounds->contains( row.mEntity ) ) {
+				const auto &bounds = inSources.mBounds->get( row.mEntity ).mValue;
+				const std::array<double, 4> center = ToArray( bounds.mCenter );
+				const std::array<double, 4> extent = ToArray( bounds.mExtent );
+				for ( size_t axis = 0; axis < 3; ++axis ) {
+					const double quantized = std::clamp( std::round( center[axis] / scale ), -static_cast<double>( LevelBaker::kMaxQuantized ), static_cast<double>( LevelBaker::kMaxQuantized ) );
+					baked.mBoundsCenter[axis] = static_cast<int16_t>( quantized );
+					error[axis] += std::abs( center[axis] - quantized * static_cast<double>( scale ) );
+
+					const double steps = std::ceil( ( std::abs( extent[axis] ) + error[axis] ) / scale );
+					baked.mBoundsExtent[axis] = static_cast<uint16_t>( std::min( steps, static_cast<double>( std::numeric_limits<uint16_t>::max() ) ) );
+				}
+			}
+
+			std::memcpy( entities, &baked, sizeof( baked ) );
+			entities += sizeof( baked );
+		}
+		std::memcpy( typeRuns, &typeRun, sizeof( typeRun ) );
+	}
+}
+
+bool Cyclone::Core::Serialization::LevelBaker::sBake( const entt::registry &inRegistry, const std::filesystem::path &inPath, bool inAllowParallel )
+{
+	const BakeSources sources{ inRegistry.storage<Component::EntityCategory>(), inRegistry.storage<Component::Position>(), inRegistry.storage<Component::BoundingBox>() };
+
+	std::vector<entt::entity> entities;
+	LevelFile::sGatherEntities( inRegistry, entities );
+
+	std::vector<BakeRow> rows;
+	rows.reserve( entities.size() );
+	for ( const entt::entity entity : entities ) {
+		const Cyclone::Math::Vector4D position = sources.mPositions && sources.mPositions->contains( entity ) ? sources.mPositions->get( entity ).mValue : Cyclone::Math::Vector4D::sZero();
+		rows.push_back( { { GetCell( position.GetX() ), GetCell( position.GetY() ), GetCell( position.GetZ() ) }, static_cast<entt::id_type>( inRegistry.get<Component::EntityType>( entity ) ), entity } );
+	}
+	entities = {};
+
+	const bool parallel = inAllowParallel && rows.size() >= kParallelEntities;
+	if ( parallel ) {
+		std::sort( std::execution::par, rows.begin(), rows.end() );
+	}
+	else {
+		std::sort( rows.begin(), rows.end() );
+	}
+
+	// Lay out every blob, a cell is a run of rows sharing a cell
+	std::vector<BakeCell> cells;
+	for ( size_t begin = 0; begin < rows.size(); ) {
+		size_t end = begin + 1;
+		uint32_t typeRunCount = 1;
+		for ( ; end < rows.size() && rows[end].mCell == rows[begin].mCell; ++end ) {
+			if ( rows[end].mEntityType != rows[end - 1].mEntityType ) ++typeRunCount;
+		}
+
+		BakeCell &cell = cells.emplace_back();
+		cell.mRows = std::span<const BakeRow>( rows.data() + begin, end - begin );
+		cell.mTypeRunCount = typeRunCount;
+		cell.mEntitiesOffset = Align( sizeof( CellHeader ) + typeRunCount * sizeof( TypeRun ), kEntityAlignment );
+		cell.mSize = cell.mEntitiesOffset + cell.mRows.size() * sizeof( BakedEntity );
+		begin = end;
+	}
+
+	uint64_t fileSize = Align( kCellTableOffset + cells.size() * sizeof( CellEntry ), kBlobAlignment );
+	for ( BakeCell &cell : cells ) {
+		cell.mOffset = fileSize;
+		fileSize = Align( fileSize + cell.mSize, kBlobAlignment );
+	}
+
+	return Cyclone::Util::MappedFile::sReplace( inPath, [&]( const std::filesystem::path &inTemporaryPath ) {
+		return Cyclone::Util::MappedFile::sWrite( inTemporaryPath, fileSize, [&]( std::byte *outData ) {
+			const FileHeader header{ kFileMagic, kVersion, static_cast<uint32_t>( cells.size() ), static_cast<uint32_t>( rows.size() ), kCellSize, fileSize };
+			std::memcpy( outData, &header, sizeof( header ) );
+
+			for ( size_t index = 0; index < cells.size(); ++index ) {
+				const BakeCell &cell = cells[index];
+				const std::array<int32_t, 3> &key = cell.mRows.front().mCell;
+				const CellEntry entry{ key[0], key[1], key[2], static_cast<uint32_t>( cell.mRows.size() ), cell.mOffset, cell.mSize };
+				std::memcpy( outData + kCellTableOffset + index * sizeof( CellEntry ), &entry, sizeof( entry ) );
+			}
+
+			Cyclone::Util::ForEachTask( cells, parallel, [&sources, outData]( const BakeCell &inCell ) { BakeBlob( sources, inCell, outData + inCell.mOffset ); } );
+		} );
+	} );
+}
+
+size_t Cyclone::Core::Serialization::LevelBaker::sBakeBatch( std::span<const std::filesystem::path> inLevels, const std::filesystem::path &inOutputDirectory )
+{
+	std::error_code error;
+	std::filesystem::create_directories( inOutputDirectory, error );
+
+	// Levels are baked one after another, each one already uses every worker
+	size_t failed = 0;
+	for ( const std::filesystem::path &level : inLevels ) {
+		entt::registry registry;
+		std::filesystem::path path = inOutputDirectory / level.filename();
+		path.replace_extension( kExtension );
+
+		if ( !LevelFile::sLoad( level, registry ) || !sBake( registry, path ) ) ++failed;
+	}
+
+	return failed;
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+// STL
+#include <span>
+#include <filesystem>
+
+namespace Cyclone::Core::Serialization
+{
+	/// @brief Runtime level format for the engine, the level split into cells which are each a contiguous blob loaded as is
+	/// @note A file is a FileHeader, a CellEntry per cell sorted by cell, and then the blobs, each starting at kBlobAlignment
+	/// @note A blob is a CellHeader, the TypeRun of each entity type in the cell, and then the BakedEntity of each entity sorted by entity type
+	/// @note Positions are floats relative to the origin of their cell, bounds are quantized with a scale per cell and always contain the bounds they were baked from
+	/// @note Editor only data such as the entity identifiers, Visible, Selectable and EpochNumber is not baked
+	class LevelBaker
+	{
+	public:
+		static constexpr uint32_t kFileMagic = 0x4B594343;	///< "CCYK"
+		static constexpr uint32_t kVersion = 1;
+		static constexpr const char *kExtension = ".cyb";
+		static constexpr double kCellSize = 64.0;
+		static constexpr size_t kBlobAlignment = 64;
+		static constexpr size_t kEntityAlignment = 16;		///< Of the entities inside a blob
+		static constexpr size_t kParallelEntities = 32768;	///< Smaller levels are baked on the calling thread
+		static constexpr int32_t kMaxQuantized = 32767;
+
+		struct FileHeader
+		{
+			uint32_t				mMagic;
+			uint32_t				mVersion;
+			uint32_t				mCellCount;
+			uint32_t				mEntityCount;
+			double					mCellSize;
+			uint64_t				mFileSize;
+		};
+
+		struct CellEntry
+		{
+			int32_t					mCellX;
+			int32_t					mCellY;
+			int32_t					mCellZ;
+			uint32_t				mEntityCount;
+			uint64_t				mOffset;		///< Of the blob from the start of the file
+			uint64_t				mSize;
+		};
+
+		struct CellHeader
+		{
+			double					mOrigin[3];		///< Corner of the cell with the lowest coordinates
+			float					mBoundsScale;	///< Size of one step of the quantized bounds
+			uint32_t				mTypeRunCount;
+			uint32_t				mEntityCount;
+			uint32_t				mEntitiesOffset;	///< From the start of the blob
+		};
+
+		struct TypeRun
+		{
+			uint32_t				mEntityType;
+			uint32_t				mCount;
+		};
+
+		struct BakedEntity
+		{
+			uint32_t				mEntityCategory;
+			float					mPosition[3];		///< Relative to the origin of the cell
+			int16_t					mBoundsCenter[3];	///< Relative to the position, in steps of mBoundsScale
+			uint16_t				mBoundsExtent[3];
+		};
+
+		/// @brief Bakes every entity of an entity class, each cell is baked by its own worker straight into the mapped file
+		/// @note Written next to inPath first and then moved over it, so a failed bake never damages the previous file
+		static bool				sBake( const entt::registry &inRegistry, const std::filesystem::path &inPath, bool inAllowParallel = true );
+
+		/// @brief Loads each level file and bakes it into inOutputDirectory, named after the level
+		/// @return Number of levels which could not be baked
+		static size_t			sBakeBatch( std::span<const std::filesystem::path> inLevels, const std::filesystem::path &inOutputDirectory );
+	};
+}
\ No newline at end of file
@@ -0,0 +1,1105 @@
+#include "pch.h"
+#include "Cyclone/Core/Serialization/LevelFile.hpp"
+
+// Cyclone utils
+#include "Cyclone/Util/TypeList.hpp"
+#include "Cyclone/Util/MappedFile.hpp"
+#include "Cyclone/Util/BlockCodec.hpp"
+#include "Cyclone/Util/Parallel.hpp"
+
+// STL
+#include <execution>
+#include <numeric>
+
+namespace
+{
+	using Cyclone::Core::Serialization::LevelFile;
+	using Cyclone::Core::Serialization::LevelFilter;
+	using Cyclone::Core::Serialization::level_components;
+
+	static_assert( sizeof( LevelFile::FileHeader ) == 32 );
+	static_assert( sizeof( LevelFile::PartitionEntry ) == 32 );
+
+	constexpr uint64_t AlignSection( uint64_t inOffset )
+	{
+		return ( inOffset + LevelFile::kSectionAlignment - 1 ) & ~static_cast<uint64_t>( LevelFile::kSectionAlignment - 1 );
+	}
+
+	/// The first segment starts right after the file header and the partition index
+	constexpr uint64_t GetSegmentsOffset( uint64_t inPartitionCount )
+	{
+		return AlignSection( sizeof( LevelFile::FileHeader ) + inPartitionCount * sizeof( LevelFile::PartitionEntry ) );
+	}
+
+	/// Order of the sections in every segment written, the entity section and then the tombstones come before the components
+	constexpr size_t kEntitySection = 0;
+	constexpr size_t kFirstColumnSection = 2;
+
+	/// Encoded data never expands further than this, larger counts in a compressed section are corrupt
+	constexpr uint64_t kMaxCompressionRatio = 512;
+
+	/// Shared by every entity of a partition, partitions are written in this order
+	struct PartitionKey
+	{
+		entt::id_type			mEntityType = 0;
+		entt::id_type			mEntityCategory = 0;
+		std::array<int32_t, 3>	mCell{};
+
+		auto					operator <=> ( const PartitionKey & ) const = default;
+	};
+
+	int32_t GetPartitionCell( double inCoordinate )
+	{
+		const double cell = std::floor( inCoordinate / LevelFile::kPartitionCellSize );
+		return static_cast<int32_t>( std::clamp( cell, static_cast<double>( std::numeric_limits<int32_t>::min() ), static_cast<double>( std::numeric_limits<int32_t>::max() ) ) );
+	}
+
+	PartitionKey MakePartitionKey( const Cyclone::Core::Component::EntityType *inType, const Cyclone::Core::Component::EntityCategory *inCategory, const Cyclone::Core::Component::Position *inPosition )
+	{
+		PartitionKey key;
+		if ( inType ) key.mEntityType = static_cast<entt::id_type>( *inType );
+		if ( inCategory ) key.mEntityCategory = static_cast<entt::id_type>( *inCategory );
+		if ( inPosition ) key.mCell = { GetPartitionCell( inPosition->mValue.GetX() ), GetPartitionCell( inPosition->mValue.GetY() ), GetPartitionCell( inPosition->mValue.GetZ() ) };
+		return key;
+	}
+
+	PartitionKey GetPartitionKey( const LevelFile::PartitionEntry &inEntry )
+	{
+		return PartitionKey{ inEntry.mEntityType, inEntry.mEntityCategory, { inEntry.mCellX, inEntry.mCellY, inEntry.mCellZ } };
+	}
+
+	bool MatchesKey( const LevelFilter &inFilter, const PartitionKey &inKey )
+	{
+		return inFilter.Matches( inKey.mEntityType, inKey.mEntityCategory, inKey.mCell );
+	}
+
+	/// Whether two sorted lists share an entity
+	bool HasCommonEntity( std::span<const entt::entity> inLhs, std::span<const entt::entity> inRhs )
+	{
+		size_t lhs = 0;
+		size_t rhs = 0;
+		while ( lhs < inLhs.size() && rhs < inRhs.size() ) {
+			if ( inLhs[lhs] == inRhs[rhs] ) return true;
+			if ( inLhs[lhs] < inRhs[rhs] ) ++lhs;
+			else ++rhs;
+		}
+		return false;
+	}
+
+	template<typename T>
+	void GatherColumn( const entt::registry &inRegistry, std::span<const entt::entity> inEntities, std::vector<entt::entity> &outEntities )
+	{
+		const auto *storage = inRegistry.storage<T>();
+		if ( !storage ) return;
+
+		// Walking the sorted entities keeps every section sorted as well
+		for ( const entt::entity entity : inEntities ) {
+			if ( storage->contains( entity ) ) outEntities.push_back( entity );
+		}
+	}
+
+	template<typename T>
+	void WriteColumnRows( const entt::registry &inRegistry, const LevelFile::SectionHeader &inSection, std::span<const entt::entity> inEntities, size_t inBegin, size_t inEnd, std::byte *ioData )
+	{
+		std::memcpy( ioData + inSection.mEntitiesOffset + inBegin * sizeof( entt::entity ), inEntities.data() + inBegin, ( inEnd - inBegin ) * sizeof( entt::entity ) );
+
+		const auto &storage = *inRegistry.storage<T>();
+		std::byte *values = ioData + inSection.mValuesOffset + inBegin * sizeof( T );
+		for ( size_t row = inBegin; row < inEnd; ++row ) {
+			std::memcpy( values, &storage.get( inEntities[row] ), sizeof( T ) );
+			values += sizeof( T );
+		}
+	}
+
+	using GatherColumnFn = void ( * )( const entt::registry &, std::span<const entt::entity>, std::vector<entt::entity> & );
+	using WriteColumnRowsFn = void ( * )( const entt::registry &, const LevelFile::SectionHeader &, std::span<const entt::entity>, size_t, size_t, std::byte * );
+
+	constexpr auto kGatherColumn = [] <typename... Types>( entt::type_list<Types...> ) { return std::array<GatherColumnFn, sizeof...( Types )>{ &GatherColumn<Types>... }; }( level_components{} );
+	constexpr auto kWriteColumnRows = [] <typename... Types>( entt::type_list<Types...> ) { return std::array<WriteColumnRowsFn, sizeof...( Types )>{ &WriteColumnRows<Types>... }; }( level_components{} );
+	constexpr auto kColumnIds = [] <typename... Types>( entt::type_list<Types...> ) { return std::array<entt::id_type, sizeof...( Types )>{ entt::type_hash<Types>::value()... }; }( level_components{} );
+	constexpr auto kColumnSizes = Cyclone::Core::History::ColumnSizes( level_components{} );
+
+	/// Rows of one section written by a single save task
+	struct SaveTask
+	{
+		size_t					mSection;
+		size_t					mBegin;
+		size_t					mEnd;
+	};
+
+	/// Where every section of a segment goes, computed before any byte of it is written
+	struct SegmentLayout
+	{
+		std::span<const entt::entity>	mEntities;		///< Sorted entities written with every level component they have
+		std::span<const entt::entity>	mTombstones;	///< Sorted entities deleted since the previous segment
+		std::array<std::vector<entt::entity>, level_components::size> mColumnEntities;
+		std::vector<LevelFile::SectionHeader> mSections;
+		std::vector<std::vector<std::byte>> mStreams;	///< Encoded entities and values of every section of a compressed segment
+		bool							mCompressed = false;
+		uint64_t						mOffset = 0;	///< Of the segment header in the file
+		uint64_t						mEnd = 0;
+	};
+
+	void LayoutSegment( const entt::registry &inRegistry, uint64_t inOffset, bool inParallel, SegmentLayout &ioLayout )
+	{
+		// Storages are only read, so every worker sees the same state of the registry
+		std::array<size_t, level_components::size> columns;
+		std::iota( columns.begin(), columns.end(), size_t{ 0 } );
+		Cyclone::Util::ForEachTask( columns, inParallel, [&]( size_t inColumn ) { kGatherColumn[inColumn]( inRegistry, ioLayout.mEntities, ioLayout.mColumnEntities[inColumn] ); } );
+
+		// Every offset is known before anything is written, so the sections can be filled in any order
+		ioLayout.mOffset = inOffset;
+		ioLayout.mSections.clear();
+		uint64_t offset = inOffset + sizeof( LevelFile::SegmentHeader ) + ( kFirstColumnSection + level_components::size ) * sizeof( LevelFile::SectionHeader );
+
+		const auto addSection = [&]( entt::id_type inId, size_t inValueSize, size_t inCount ) {
+			LevelFile::SectionHeader &section = ioLayout.mSections.emplace_back( LevelFile::SectionHeader{ inId, static_cast<uint32_t>( inValueSize ), inCount, 0, 0, inCount * sizeof( entt::entity ), inCount * inValueSize } );
+			section.mEntitiesOffset = offset = AlignSection( offset );
+			offset += section.mEntitiesSize;
+
+			if ( inValueSize == 0 ) return;
+			section.mValuesOffset = offset = AlignSection( offset );
+			offset += section.mValuesSize;
+		};
+
+		addSection( entt::type_hash<entt::entity>::value(), 0, ioLayout.mEntities.size() );
+		addSection( LevelFile::kTombstoneSectionId, 0, ioLayout.mTombstones.size() );
+		for ( size_t column = 0; column < level_components::size; ++column ) {
+			addSection( kColumnIds[column], kColumnSizes[column], ioLayout.mColumnEntities[column].size() );
+		}
+
+		ioLayout.mEnd = offset;
+	}
+
+	void WriteSegment( const entt::registry &inRegistry, const SegmentLayout &inLayout, bool inParallel, std::byte *ioData )
+	{
+		const LevelFile::SegmentHeader header{ static_cast<uint32_t>( inLayout.mSections.size() ), inLayout.mCompressed ? LevelFile::kCompressedSegment : 0, inLayout.mEnd - inLayout.mOffset };
+		std::memcpy( ioData + inLayout.mOffset, &header, sizeof( LevelFile::SegmentHeader ) );
+		std::memcpy( ioData + inLayout.mOffset + sizeof( LevelFile::SegmentHeader ), inLayout.mSections.data(), inLayout.mSections.size() * sizeof( LevelFile::SectionHeader ) );
+
+		if ( inLayout.mCompressed ) {
+			for ( size_t index = 0; index < inLayout.mSections.size(); ++index ) {
+				const LevelFile::SectionHeader &section = inLayout.mSections[index];
+				if ( section.mEntitiesSize != 0 ) std::memcpy( ioData + section.mEntitiesOffset, inLayout.mStreams[index * 2].data(), section.mEntitiesSize );
+				if ( section.mValuesSize != 0 ) std::memcpy( ioData + section.mValuesOffset, inLayout.mStreams[index * 2 + 1].data(), section.mValuesSize );
+			}
+			return;
+		}
+
+		// Large sections are split, so a level dominated by one storage still spreads over every core
+		std::vector<SaveTask> tasks;
+		for ( size_t index = 0; index < inLayout.mSections.size(); ++index ) {
+			for ( size_t begin = 0; begin < inLayout.mSections[index].mCount; begin += LevelFile::kSaveTaskRows ) {
+				tasks.push_back( SaveTask{ index, begin, std::min<size_t>( begin + LevelFile::kSaveTaskRows, inLayout.mSections[index].mCount ) } );
+			}
+		}
+
+		Cyclone::Util::ForEachTask( tasks, inParallel, [&]( const SaveTask &inTask ) {
+			const LevelFile::SectionHeader &section = inLayout.mSections[inTask.mSection];
+			if ( inTask.mSection < kFirstColumnSection ) {
+				const std::span<const entt::entity> entities = inTask.mSection == kEntitySection ? inLayout.mEntities : inLayout.mTombstones;
+				std::memcpy( ioData + section.mEntitiesOffset + inTask.mBegin * sizeof( entt::entity ), entities.data() + inTask.mBegin, ( inTask.mEnd - inTask.mBegin ) * sizeof( entt::entity ) );
+				return;
+			}
+
+			const size_t column = inTask.mSection - kFirstColumnSection;
+			kWriteColumnRows[column]( inRegistry, section, inLayout.mColumnEntities[column], inTask.mBegin, inTask.mEnd, ioData );
+		} );
+	}
+
+	/// @brief Turns a layout made at offset zero into a compressed segment at inOffset
+	/// @note The segment is written uncompressed into memory first, then every entity and value array is encoded on its own
+	void EncodeSegment( const entt::registry &inRegistry, uint64_t inOffset, bool inParallel, SegmentLayout &ioLayout )
+	{
+		assert( ioLayout.mOffset == 0 && !ioLayout.mCompressed && "Compressed segments are encoded from a layout at offset zero!" );
+
+		std::vector<std::byte> image( ioLayout.mEnd );
+		WriteSegment( inRegistry, ioLayout, inParallel, image.data() );
+
+		std::vector<size_t> streams( ioLayout.mSections.size() * 2 );
+		std::iota( streams.begin(), streams.end(), size_t{ 0 } );
+		ioLayout.mStreams.assign( streams.size(), {} );
+		Cyclone::Util::ForEachTask( streams, inParallel, [&]( size_t inStream ) {
+			const LevelFile::SectionHeader &section = ioLayout.mSections[inStream / 2];
+			const bool isValues = inStream % 2 != 0;
+			if ( isValues && section.mValueSize == 0 ) return;
+
+			const std::span<const std::byte> raw( image.data() + ( isValues ? section.mValuesOffset : section.mEntitiesOffset ), isValues ? section.mValuesSize : section.mEntitiesSize );
+			Cyclone::Util::BlockCodec::sEncode( raw, isValues ? section.mValueSize : sizeof( entt::entity ), inParallel, ioLayout.mStreams[inStream] );
+		} );
+
+		// Only now are the sizes in the file known
+		uint64_t offset = inOffset + sizeof( LevelFile::SegmentHeader ) + ioLayout.mSections.size() * sizeof( LevelFile::SectionHeader );
+		for ( size_t index = 0; index < ioLayout.mSections.size(); ++index ) {
+			LevelFile::SectionHeader &section = ioLayout.mSections[index];
+			section.mEntitiesOffset = offset = AlignSection( offset );
+			section.mEntitiesSize = ioLayout.mStreams[index * 2].size();
+			offset += section.mEntitiesSize;
+
+			if ( section.mValueSize == 0 ) continue;
+			section.mValuesOffset = offset = AlignSection( offset );
+			section.mValuesSize = ioLayout.mStreams[index * 2 + 1].size();
+			offset += section.mValuesSize;
+		}
+
+		ioLayout.mCompressed = true;
+		ioLayout.mOffset = inOffset;
+		ioLayout.mEnd = offset;
+	}
+
+	/// @brief Moves a segment laid out at offset zero to inOffset, every section stays aligned as inOffset is aligned
+	void PlaceSegment( uint64_t inOffset, SegmentLayout &ioLayout )
+	{
+		assert( ioLayout.mOffset == 0 && inOffset % LevelFile::kSectionAlignment == 0 && "Segments are placed once, at an aligned offset!" );
+
+		for ( LevelFile::SectionHeader &section : ioLayout.mSections ) {
+			section.mEntitiesOffset += inOffset;
+			if ( section.mValueSize != 0 ) section.mValuesOffset += inOffset;
+		}
+
+		ioLayout.mOffset = inOffset;
+		ioLayout.mEnd += inOffset;
+	}
+
+	/// A partition of the level being saved, all of its entities from the same registry
+	struct SavePartition
+	{
+		PartitionKey			mKey;
+		const entt::registry *	mRegistry = nullptr;
+		SegmentLayout			mLayout;
+	};
+
+	/// A partition of a previous file written again byte for byte
+	struct CopyPartition
+	{
+		LevelFile::PartitionEntry mEntry;	///< As listed by the previous file
+		uint64_t				mSize = 0;
+		uint64_t				mOffset = 0;	///< In the file being written
+	};
+
+	/// An entity being saved and the partition it goes to
+	struct PartitionRow
+	{
+		PartitionKey			mKey;
+		uint32_t				mRegistry;
+		entt::entity			mEntity;
+
+		bool					operator < ( const PartitionRow &inRhs ) const { return std::tie( mKey, mRegistry, mEntity ) < std::tie( inRhs.mKey, inRhs.mRegistry, inRhs.mEntity ); }
+	};
+
+	void GatherPartitionRows( const entt::registry &inRegistry, uint32_t inRegistryIndex, std::vector<PartitionRow> &ioRows )
+	{
+		std::vector<entt::entity> entities;
+		LevelFile::sGatherEntities( inRegistry, entities );
+		if ( entities.empty() ) return;
+
+		const auto &types = *inRegistry.storage<Cyclone::Core::Component::EntityType>();
+		const auto *categories = inRegistry.storage<Cyclone::Core::Component::EntityCategory>();
+		const auto *positions = inRegistry.storage<Cyclone::Core::Component::Position>();
+		ioRows.reserve( ioRows.size() + entities.size() );
+		for ( const entt::entity entity : entities ) {
+			const auto &type = types.get( entity );
+			const auto *category = categories && categories->contains( entity ) ? &categories->get( entity ) : nullptr;
+			const auto *position = positions && positions->contains( entity ) ? &positions->get( entity ) : nullptr;
+			ioRows.push_back( PartitionRow{ MakePartitionKey( &type, category, position ), inRegistryIndex, entity } );
+		}
+	}
+
+	/// @brief Copies a segment of another level file and moves the offsets of its sections along with it
+	void CopySegment( std::span<const std::byte> inSource, const CopyPartition &inCopy, std::byte *ioData )
+	{
+		const uint64_t from = inCopy.mEntry.mOffset;
+		std::memcpy( ioData + inCopy.mOffset, inSource.data() + from, inCopy.mSize );
+
+		LevelFile::SegmentHeader header;
+		std::memcpy( &header, ioData + inCopy.mOffset, sizeof( LevelFile::SegmentHeader ) );
+
+		std::byte *sections = ioData + inCopy.mOffset + sizeof( LevelFile::SegmentHeader );
+		for ( uint32_t index = 0; index < header.mSectionCount; ++index ) {
+			LevelFile::SectionHeader section;
+			std::memcpy( &section, sections + index * sizeof( LevelFile::SectionHeader ), sizeof( LevelFile::SectionHeader ) );
+			section.mEntitiesOffset = section.mEntitiesOffset - from + inCopy.mOffset;
+			if ( section.mValueSize != 0 ) section.mValuesOffset = section.mValuesOffset - from + inCopy.mOffset;
+			std::memcpy( sections + index * sizeof( LevelFile::SectionHeader ), &section, sizeof( LevelFile::SectionHeader ) );
+		}
+	}
+
+	/// @brief Writes the entities of an entity class of every registry as partitions, followed by the partitions of inSource listed by ioCopies
+	bool WriteLevel( std::span<const entt::registry *const> inRegistries, std::span<const std::byte> inSource, std::vector<CopyPartition> &ioCopies, const std::filesystem::path &inPath, bool inAllowParallel, bool inCompress )
+	{
+		std::vector<PartitionRow> rows;
+		for ( size_t index = 0; index < inRegistries.size(); ++index ) {
+			GatherPartitionRows( *inRegistries[index], static_cast<uint32_t>( index ), rows );
+		}
+
+		const bool parallel = inAllowParallel && rows.size() >= LevelFile::kParallelSaveRows;
+		if ( parallel ) {
+			std::sort( std::execution::par, rows.begin(), rows.end() );
+		}
+		else {
+			std::sort( rows.begin(), rows.end() );
+		}
+
+		// Each run of rows sharing a partition and a registry becomes a segment, its entities already sorted
+		std::vector<entt::entity> entities( rows.size() );
+		std::transform( rows.begin(), rows.end(), entities.begin(), []( const PartitionRow &inRow ) { return inRow.mEntity; } );
+
+		std::vector<SavePartition> partitions;
+		for ( size_t begin = 0; begin < rows.size(); ) {
+			size_t end = begin + 1;
+			while ( end < rows.size() && rows[end].mKey == rows[begin].mKey && rows[end].mRegistry == rows[begin].mRegistry ) ++end;
+
+			SavePartition &partition = partitions.emplace_back();
+			partition.mKey = rows[begin].mKey;
+			partition.mRegistry = inRegistries[rows[begin].mRegistry];
+			partition.mLayout.mEntities = std::span<const entt::entity>( entities.data() + begin, end - begin );
+			begin = end;
+		}
+
+		// Partitions are laid out side by side, a large one also spreads its own sections over every core
+		const auto isLarge = [inAllowParallel]( const SavePartition &inPartition ) { return inAllowParallel && inPartition.mLayout.mEntities.size() >= LevelFile::kParallelSaveRows; };
+		Cyclone::Util::ForEachTask( partitions, parallel, [&]( SavePartition &ioPartition ) {
+			LayoutSegment( *ioPartition.mRegistry, 0, isLarge( ioPartition ), ioPartition.mLayout );
+			if ( inCompress ) EncodeSegment( *ioPartition.mRegistry, 0, isLarge( ioPartition ), ioPartition.mLayout );
+		} );
+
+		const size_t partitionCount = partitions.size() + ioCopies.size();
+		uint64_t end = GetSegmentsOffset( partitionCount );
+		for ( SavePartition &partition : partitions ) {
+			PlaceSegment( AlignSection( end ), partition.mLayout );
+			end = partition.mLayout.mEnd;
+		}
+		for ( CopyPartition &copy : ioCopies ) {
+			copy.mOffset = AlignSection( end );
+			end = copy.mOffset + copy.mSize;
+		}
+
+		return Cyclone::Util::MappedFile::sWrite( inPath, end, [&]( std::byte *data ) {
+			const LevelFile::FileHeader header{ LevelFile::kFileMagic, LevelFile::kVersion, static_cast<uint32_t>( partitionCount ), static_cast<uint32_t>( partitionCount ), end, end };
+			std::memcpy( data, &header, sizeof( LevelFile::FileHeader ) );
+
+			std::byte *index = data + sizeof( LevelFile::FileHeader );
+			for ( const SavePartition &partition : partitions ) {
+				const PartitionKey &key = partition.mKey;
+				const LevelFile::PartitionEntry entry{ key.mEntityType, key.mEntityCategory, key.mCell[0], key.mCell[1], key.mCell[2], static_cast<uint32_t>( partition.mLayout.mEntities.size() ), partition.mLayout.mOffset };
+				std::memcpy( index, &entry, sizeof( LevelFile::PartitionEntry ) );
+				index += sizeof( LevelFile::PartitionEntry );
+			}
+			for ( const CopyPartition &copy : ioCopies ) {
+				LevelFile::PartitionEntry entry = copy.mEntry;
+				entry.mOffset = copy.mOffset;
+				std::memcpy( index, &entry, sizeof( LevelFile::PartitionEntry ) );
+				index += sizeof( LevelFile::PartitionEntry );
+			}
+
+			Cyclone::Util::ForEachTask( partitions, parallel, [&]( const SavePartition &inPartition ) { WriteSegment( *inPartition.mRegistry, inPartition.mLayout, isLarge( inPartition ), data ); } );
+			Cyclone::Util::ForEachTask( ioCopies, parallel, [&]( const CopyPartition &inCopy ) { CopySegment( inSource, inCopy, data ); } );
+		} );
+	}
+
+	/// Decoded sections keep the alignment they would have in a mapped file
+	struct alignas( LevelFile::kSectionAlignment ) ImageLine
+	{
+		std::byte						mBytes[LevelFile::kSectionAlignment];
+	};
+
+	/// A segment of a level file, every section already validated
+	struct SegmentView
+	{
+		std::span<const std::byte>		mData;			///< What the section offsets refer to, the file or the decoded image of a compressed segment
+		std::vector<LevelFile::SectionHeader> mSections;
+		std::vector<ImageLine>			mImage;
+		std::span<const entt::entity>	mEntities;
+		std::span<const entt::entity>	mTombstones;
+		std::array<const LevelFile::SectionHeader *, level_components::size> mColumnSections{};
+		uint64_t						mEnd = 0;
+	};
+
+	bool IsEntitySection( const LevelFile::SectionHeader &inSection )
+	{
+		return inSection.mId == entt::type_hash<entt::entity>::value() || inSection.mId == LevelFile::kTombstoneSectionId;
+	}
+
+	const LevelFile::SectionHeader *FindSection( std::span<const LevelFile::SectionHeader> inSections, entt::id_type inId )
+	{
+		for ( const LevelFile::SectionHeader &section : inSections ) {
+			if ( section.mId == inId ) return &section;
+		}
+		return nullptr;
+	}
+
+	bool IsInFile( std::span<const std::byte> inFile, uint64_t inOffset, uint64_t inCount, size_t inValueSize )
+	{
+		return inOffset <= inFile.size() && inCount <= ( inFile.size() - inOffset ) / std::max<size_t>( inValueSize, 1 );
+	}
+
+	/// Sorted, unique and never null, and if inSuperset is given each one must also be in it
+	bool ReadEntities( std::span<const std::byte> inFile, const LevelFile::SectionHeader &inSection, std::span<const entt::entity> inSuperset, bool inCheckSuperset, std::span<const entt::entity> &outEntities )
+	{
+		if ( inSection.mEntitiesOffset % alignof( entt::entity ) != 0 || !IsInFile( inFile, inSection.mEntitiesOffset, inSection.mCount, sizeof( entt::entity ) ) ) return false;
+
+		outEntities = std::span<const entt::entity>( reinterpret_cast<const entt::entity *>( inFile.data() + inSection.mEntitiesOffset ), inSection.mCount );
+
+		// Both lists are sorted, so membership is a single merge walk
+		size_t cursor = 0;
+		for ( size_t row = 0; row < outEntities.size(); ++row ) {
+			const entt::entity entity = outEntities[row];
+			if ( entity == entt::null || ( row != 0 && outEntities[row - 1] >= entity ) ) return false;
+			if ( !inCheckSuperset ) continue;
+
+			while ( cursor < inSuperset.size() && inSuperset[cursor] < entity ) ++cursor;
+			if ( cursor == inSuperset.size() || inSuperset[cursor] != entity ) return false;
+		}
+
+		return true;
+	}
+
+	/// Finds and validates the section of a component, a segment may omit any of them
+	struct ValidateColumnFunctor
+	{
+		template<typename T>
+		void Apply( std::span<const std::byte> inFile, std::span<const LevelFile::SectionHeader> inSections, SegmentView &ioSegment, bool &ioValid ) const
+		{
+			if ( !ioValid ) return;
+
+			const LevelFile::SectionHeader *section = FindSection( inSections, entt::type_hash<T>::value() );
+			if ( !section ) return;
+
+			std::span<const entt::entity> entities;
+			if ( section->mValueSize != sizeof( T ) || section->mValuesOffset % alignof( T ) != 0 || !IsInFile( inFile, section->mValuesOffset, section->mCount, sizeof( T ) ) ||
+				!ReadEntities( inFile, *section, ioSegment.mEntities, true, entities ) ) {
+				ioValid = false;
+				return;
+			}
+
+			ioSegment.mColumnSections[entt::type_list_index_v<T, level_components>] = section;
+		}
+	};
+
+	/// @brief Decodes the sections of a compressed segment into an image laid out as the uncompressed segment would be at offset zero
+	/// @param inColumns Decodes the sections of the components as well as the entities and tombstones
+	bool DecodeSegment( std::span<const std::byte> inFile, bool inColumns, SegmentView &ioSegment )
+	{
+		uint64_t imageSize = 0;
+		for ( const LevelFile::SectionHeader &section : ioSegment.mSections ) {
+			if ( !inColumns && !IsEntitySection( section ) ) continue;
+			if ( !IsInFile( inFile, section.mEntitiesOffset, section.mEntitiesSize, 1 ) || !IsInFile( inFile, section.mValuesOffset, section.mValuesSize, 1 ) ) return false;
+			if ( section.mCount > section.mEntitiesSize * kMaxCompressionRatio / sizeof( entt::entity ) ) return false;
+			if ( section.mValueSize != 0 && section.mCount > section.mValuesSize * kMaxCompressionRatio / section.mValueSize ) return false;
+
+			imageSize = AlignSection( imageSize ) + section.mCount * sizeof( entt::entity );
+			if ( section.mValueSize != 0 ) imageSize = AlignSection( imageSize ) + section.mCount * section.mValueSize;
+		}
+
+		ioSegment.mImage.resize( ( imageSize + LevelFile::kSectionAlignment - 1 ) / LevelFile::kSectionAlignment );
+		std::byte *image = reinterpret_cast<std::byte *>( ioSegment.mImage.data() );
+
+		// Stored sections are read from the file before their headers are pointed at the image
+		uint64_t offset = 0;
+		for ( LevelFile::SectionHeader &section : ioSegment.mSections ) {
+			if ( !inColumns && !IsEntitySection( section ) ) continue;
+
+			const auto decode = [&]( uint64_t &ioOffset, uint64_t &ioSize, size_t inStride ) {
+				const std::span<const std::byte> stored( inFile.data() + ioOffset, ioSize );
+				ioOffset = offset = AlignSection( offset );
+				ioSize = section.mCount * inStride;
+				offset += ioSize;
+				return Cyclone::Util::BlockCodec::sDecode( stored, inStride, true, std::span( image + ioOffset, ioSize ) );
+			};
+
+			if ( !decode( section.mEntitiesOffset, section.mEntitiesSize, sizeof( entt::entity ) ) ) return false;
+			if ( section.mValueSize != 0 && !decode( section.mValuesOffset, section.mValuesSize, section.mValueSize ) ) return false;
+		}
+
+		ioSegment.mData = std::span<const std::byte>( image, imageSize );
+		return true;
+	}
+
+	/// @param inColumns Reads the sections of the components, without it only the entities and tombstones are read
+	bool ReadSegment( std::span<const std::byte> inFile, uint64_t inOffset, bool inColumns, SegmentView &outSegment )
+	{
+		if ( !IsInFile( inFile, inOffset, 1, sizeof( LevelFile::SegmentHeader ) ) ) return false;
+
+		LevelFile::SegmentHeader header;
+		std::memcpy( &header, inFile.data() + inOffset, sizeof( LevelFile::SegmentHeader ) );
+		if ( header.mSize < sizeof( LevelFile::SegmentHeader ) || !IsInFile( inFile, inOffset, header.mSize, 1 ) ) return false;
+		if ( header.mSectionCount > ( header.mSize - sizeof( LevelFile::SegmentHeader ) ) / sizeof( LevelFile::SectionHeader ) ) return false;
+		if ( ( header.mFlags & ~LevelFile::kCompressedSegment ) != 0 ) return false;
+
+		// Segments start aligned in a page aligned mapping, so the section headers are aligned as well
+		const auto *sections = reinterpret_cast<const LevelFile::SectionHeader *>( inFile.data() + inOffset + sizeof( LevelFile::SegmentHeader ) );
+		outSegment.mSections.assign( sections, sections + header.mSectionCount );
+		outSegment.mData = inFile;
+
+		if ( header.mFlags & LevelFile::kCompressedSegment ) {
+			if ( !DecodeSegment( inFile, inColumns, outSegment ) ) return false;
+		}
+		else {
+			for ( const LevelFile::SectionHeader &section : outSegment.mSections ) {
+				if ( section.mEntitiesSize != section.mCount * sizeof( entt::entity ) || section.mValuesSize != section.mCount * section.mValueSize ) return false;
+			}
+		}
+
+		const LevelFile::SectionHeader *entitySection = FindSection( outSegment.mSections, entt::type_hash<entt::entity>::value() );
+		const LevelFile::SectionHeader *tombstoneSection = FindSection( outSegment.mSections, LevelFile::kTombstoneSectionId );
+		if ( !entitySection || !tombstoneSection ) return false;
+		if ( !ReadEntities( outSegment.mData, *entitySection, {}, false, outSegment.mEntities ) || !ReadEntities( outSegment.mData, *tombstoneSection, {}, false, outSegment.mTombstones ) ) return false;
+
+		bool valid = true;
+		if ( inColumns ) Cyclone::Util::ApplyOverTypeList<level_components>( ValidateColumnFunctor{}, outSegment.mData, std::span<const LevelFile::SectionHeader>( outSegment.mSections ), outSegment, valid );
+
+		outSegment.mEnd = inOffset + header.mSize;
+		return valid;
+	}
+
+	/// @brief Reads the file header and the partition index, every partition must start before the appended segments
+	bool ReadIndex( std::span<const std::byte> inFile, LevelFile::FileHeader &outHeader, std::vector<LevelFile::PartitionEntry> &outPartitions )
+	{
+		if ( inFile.size() < sizeof( LevelFile::FileHeader ) ) return false;
+
+		std::memcpy( &outHeader, inFile.data(), sizeof( LevelFile::FileHeader ) );
+		if ( outHeader.mMagic != LevelFile::kFileMagic || outHeader.mVersion != LevelFile::kVersion || outHeader.mSegmentCount < outHeader.mPartitionCount ) return false;
+		if ( outHeader.mFileSize > inFile.size() || outHeader.mPartitionsEnd > outHeader.mFileSize || GetSegmentsOffset( outHeader.mPartitionCount ) > outHeader.mPartitionsEnd ) return false;
+
+		outPartitions.resize( outHeader.mPartitionCount );
+		std::memcpy( outPartitions.data(), inFile.data() + sizeof( LevelFile::FileHeader ), outPartitions.size() * sizeof( LevelFile::PartitionEntry ) );
+		for ( const LevelFile::PartitionEntry &partition : outPartitions ) {
+			if ( partition.mOffset % LevelFile::kSectionAlignment != 0 || partition.mOffset < GetSegmentsOffset( outHeader.mPartitionCount ) || partition.mOffset >= outHeader.mPartitionsEnd ) return false;
+		}
+
+		return true;
+	}
+
+	template<typename T>
+	const T *FindValue( const SegmentView &inSegment, entt::entity inEntity )
+	{
+		const LevelFile::SectionHeader *section = inSegment.mColumnSections[entt::type_list_index_v<T, level_components>];
+		if ( !section ) return nullptr;
+
+		const auto *entities = reinterpret_cast<const entt::entity *>( inSegment.mData.data() + section->mEntitiesOffset );
+		const auto *found = std::lower_bound( entities, entities + section->mCount, inEntity );
+		if ( found == entities + section->mCount || *found != inEntity ) return nullptr;
+
+		return reinterpret_cast<const T *>( inSegment.mData.data() + section->mValuesOffset ) + ( found - entities );
+	}
+
+	/// The partition an entity of an appended segment would be saved to
+	PartitionKey GetEntityKey( const SegmentView &inSegment, entt::entity inEntity )
+	{
+		return MakePartitionKey( FindValue<Cyclone::Core::Component::EntityType>( inSegment, inEntity ), FindValue<Cyclone::Core::Component::EntityCategory>( inSegment, inEntity ), FindValue<Cyclone::Core::Component::Position>( inSegment, inEntity ) );
+	}
+
+	struct LoadColumnFunctor
+	{
+		template<typename T>
+		void Apply( const SegmentView &inSegment, entt::registry &ioRegistry ) const
+		{
+			const LevelFile::SectionHeader *section = inSegment.mColumnSections[entt::type_list_index_v<T, level_components>];
+			if ( !section || section->mCount == 0 ) return;
+
+			// Straight from the mapped file, or the decoded image, into the packed storage
+			const auto *entities = reinterpret_cast<const entt::entity *>( inSegment.mData.data() + section->mEntitiesOffset );
+			const auto *values = reinterpret_cast<const T *>( inSegment.mData.data() + section->mValuesOffset );
+			ioRegistry.storage<T>().insert( entities, entities + section->mCount, values );
+		}
+	};
+
+	/// Loads the rows of inEntities only, a sorted subset of the entities of the segment
+	struct LoadRowsFunctor
+	{
+		template<typename T>
+		void Apply( const SegmentView &inSegment, std::span<const entt::entity> inEntities, entt::registry &ioRegistry ) const
+		{
+			const LevelFile::SectionHeader *section = inSegment.mColumnSections[entt::type_list_index_v<T, level_components>];
+			if ( !section || section->mCount == 0 || inEntities.empty() ) return;
+
+			const auto *entities = reinterpret_cast<const entt::entity *>( inSegment.mData.data() + section->mEntitiesOffset );
+			const auto *values = reinterpret_cast<const T *>( inSegment.mData.data() + section->mValuesOffset );
+			auto &storage = ioRegistry.storage<T>();
+
+			size_t cursor = 0;
+			for ( size_t row = 0; row < section->mCount && cursor < inEntities.size(); ++row ) {
+				while ( cursor < inEntities.size() && inEntities[cursor] < entities[row] ) ++cursor;
+				if ( cursor < inEntities.size() && inEntities[cursor] == entities[row] ) storage.emplace( entities[row], values[row] );
+			}
+		}
+	};
+
+	/// Loads the partitions matching a filter, an appended entity is matched by the partition it would be saved to
+	struct FilterSelector
+	{
+		static constexpr bool	kPerEntity = false;	///< Every entity of a selected partition is loaded
+
+		const LevelFilter &		mFilter;
+
+		bool					SelectPartition( size_t, const PartitionKey &inKey ) const		{ return MatchesKey( mFilter, inKey ); }
+		bool					SelectEntity( const PartitionKey &inKey, entt::entity ) const	{ return MatchesKey( mFilter, inKey ); }
+	};
+
+	/// Loads a sorted list of entities, from the partitions asked for
+	struct EntitySelector
+	{
+		static constexpr bool	kPerEntity = true;
+
+		std::span<const entt::entity> mEntities;
+		std::span<const uint8_t> mPartitions;
+
+		bool					SelectPartition( size_t inIndex, const PartitionKey & ) const	{ return mPartitions[inIndex] != 0; }
+		bool					SelectEntity( const PartitionKey &, entt::entity inEntity ) const	{ return std::binary_search( mEntities.begin(), mEntities.end(), inEntity ); }
+	};
+
+	/// @brief Decides which segment holds the state of each entity, the last segment listing an entity holds it
+	/// @param outAppended Entities each appended segment holds the state of
+	/// @param outDecided Entities listed or deleted by any appended segment, their rows in the partitions are stale
+	/// @param outEntities Every entity of the level, sorted
+	/// @return False if two partitions share an entity
+	bool ResolveEntities( std::span<const SegmentView> inPartitions, std::span<const SegmentView> inAppended, std::vector<std::vector<entt::entity>> &outAppended, std::vector<entt::entity> &outDecided, std::vector<entt::entity> &outEntities )
+	{
+		// Appended segments are walked from the last one, so each entity is decided once
+		outAppended.assign( inAppended.size(), {} );
+		outDecided.clear();
+		std::vector<entt::entity> appendedEntities;
+		std::vector<entt::entity> scratch;
+		for ( size_t index = inAppended.size(); index-- > 0; ) {
+			const SegmentView &segment = inAppended[index];
+			std::set_difference( segment.mEntities.begin(), segment.mEntities.end(), outDecided.begin(), outDecided.end(), std::back_inserter( outAppended[index] ) );
+			appendedEntities.insert( appendedEntities.end(), outAppended[index].begin(), outAppended[index].end() );
+
+			scratch.clear();
+			std::set_union( segment.mEntities.begin(), segment.mEntities.end(), segment.mTombstones.begin(), segment.mTombstones.end(), std::back_inserter( scratch ) );
+			std::vector<entt::entity> merged;
+			std::set_union( outDecided.begin(), outDecided.end(), scratch.begin(), scratch.end(), std::back_inserter( merged ) );
+			outDecided = std::move( merged );
+		}
+
+		// Partitions never share an entity, the level is what they hold and what the appended segments left alive
+		outEntities.clear();
+		for ( const SegmentView &segment : inPartitions ) {
+			outEntities.insert( outEntities.end(), segment.mEntities.begin(), segment.mEntities.end() );
+		}
+		if ( outEntities.size() >= LevelFile::kParallelSaveRows ) {
+			std::sort( std::execution::par, outEntities.begin(), outEntities.end() );
+		}
+		else {
+			std::sort( outEntities.begin(), outEntities.end() );
+		}
+		if ( std::adjacent_find( outEntities.begin(), outEntities.end() ) != outEntities.end() ) return false;
+
+		if ( !inAppended.empty() ) {
+			std::sort( appendedEntities.begin(), appendedEntities.end() );
+			scratch.clear();
+			std::set_difference( outEntities.begin(), outEntities.end(), outDecided.begin(), outDecided.end(), std::back_inserter( scratch ) );
+			outEntities.clear();
+			std::merge( scratch.begin(), scratch.end(), appendedEntities.begin(), appendedEntities.end(), std::back_inserter( outEntities ) );
+		}
+
+		return true;
+	}
+
+	/// @brief Loads the entities picked by inSelector into an empty registry, every other entity of the level is created without components
+	/// @note Nothing is created unless every segment read is valid, partitions not selected only have their entities read
+	/// @param outUnloaded Receives the entities created without components, if given
+	template<typename Selector>
+	bool LoadLevel( std::span<const std::byte> inFile, const LevelFile::FileHeader &inHeader, std::span<const LevelFile::PartitionEntry> inPartitions, const Selector &inSelector, entt::registry &ioRegistry, std::vector<entt::entity> *outUnloaded )
+	{
+		std::vector<SegmentView> partitions( inPartitions.size() );
+		std::vector<uint8_t> selected( inPartitions.size() );
+		std::vector<uint8_t> valid( inPartitions.size() );
+		std::vector<size_t> indices( inPartitions.size() );
+		std::iota( indices.begin(), indices.end(), size_t{ 0 } );
+		Cyclone::Util::ForEachTask( indices, indices.size() > 1, [&]( size_t inIndex ) {
+			const LevelFile::PartitionEntry &entry = inPartitions[inIndex];
+			SegmentView &segment = partitions[inIndex];
+			selected[inIndex] = inSelector.SelectPartition( inIndex, GetPartitionKey( entry ) );
+			valid[inIndex] = ReadSegment( inFile, entry.mOffset, selected[inIndex] != 0, segment ) && segment.mEnd <= inHeader.mPartitionsEnd && segment.mTombstones.empty() && segment.mEntities.size() == entry.mEntityCount;
+		} );
+		if ( std::find( valid.begin(), valid.end(), uint8_t{ 0 } ) != valid.end() ) return false;
+
+		std::vector<SegmentView> appended( inHeader.mSegmentCount - inHeader.mPartitionCount );
+		uint64_t offset = AlignSection( inHeader.mPartitionsEnd );
+		for ( SegmentView &segment : appended ) {
+			if ( !ReadSegment( inFile, offset, true, segment ) ) return false;
+			offset = AlignSection( segment.mEnd );
+		}
+
+		std::vector<std::vector<entt::entity>> appendedLoads;
+		std::vector<entt::entity> decided;
+		std::vector<entt::entity> entities;
+		if ( !ResolveEntities( partitions, appended, appendedLoads, decided, entities ) ) return false;
+
+		for ( size_t index = 0; index < appended.size(); ++index ) {
+			std::erase_if( appendedLoads[index], [&]( entt::entity inEntity ) { return !inSelector.SelectEntity( GetEntityKey( appended[index], inEntity ), inEntity ); } );
+		}
+
+		LevelFile::sCreateEntities( entities, ioRegistry );
+
+		std::vector<entt::entity> loaded;
+		std::vector<entt::entity> rows;
+		for ( size_t index = 0; index < partitions.size(); ++index ) {
+			if ( !selected[index] ) continue;
+
+			const SegmentView &segment = partitions[index];
+			const PartitionKey key = GetPartitionKey( inPartitions[index] );
+			rows.clear();
+			for ( const entt::entity entity : segment.mEntities ) {
+				if ( std::binary_search( decided.begin(), decided.end(), entity ) ) continue;
+				if ( Selector::kPerEntity && !inSelector.SelectEntity( key, entity ) ) continue;
+				rows.push_back( entity );
+			}
+
+			// A partition nothing was appended for is bulk inserted as a whole
+			if ( rows.size() == segment.mEntities.size() ) {
+				Cyclone::Util::ApplyOverTypeList<level_components>( LoadColumnFunctor{}, segment, ioRegistry );
+			}
+			else {
+				Cyclone::Util::ApplyOverTypeList<level_components>( LoadRowsFunctor{}, segment, std::span<const entt::entity>( rows ), ioRegistry );
+			}
+			if ( outUnloaded ) loaded.insert( loaded.end(), rows.begin(), rows.end() );
+		}
+
+		for ( size_t index = 0; index < appended.size(); ++index ) {
+			Cyclone::Util::ApplyOverTypeList<level_components>( LoadRowsFunctor{}, appended[index], std::span<const entt::entity>( appendedLoads[index] ), ioRegistry );
+			if ( outUnloaded ) loaded.insert( loaded.end(), appendedLoads[index].begin(), appendedLoads[index].end() );
+		}
+
+		if ( outUnloaded ) {
+			std::sort( loaded.begin(), loaded.end() );
+			outUnloaded->clear();
+			std::set_difference( entities.begin(), entities.end(), loaded.begin(), loaded.end(), std::back_inserter( *outUnloaded ) );
+		}
+
+		return true;
+	}
+
+	/// Appends the rows of inEntities to packed columns, a sorted subset of the entities of the segment or every one of them if empty
+	struct ReadColumnFunctor
+	{
+		template<typename T>
+		void Apply( const SegmentView &inSegment, std::span<const entt::entity> inEntities, Cyclone::Core::Serialization::ComponentColumns<level_components> &ioColumns ) const
+		{
+			const LevelFile::SectionHeader *section = inSegment.mColumnSections[entt::type_list_index_v<T, level_components>];
+			if ( !section || section->mCount == 0 ) return;
+
+			const auto *entities = reinterpret_cast<const entt::entity *>( inSegment.mData.data() + section->mEntitiesOffset );
+			const auto *values = reinterpret_cast<const T *>( inSegment.mData.data() + section->mValuesOffset );
+			std::vector<entt::entity> &outEntities = ioColumns.GetEntities<T>();
+			std::vector<T> &outValues = ioColumns.GetValues<T>();
+			if ( inEntities.empty() ) {
+				outEntities.insert( outEntities.end(), entities, entities + section->mCount );
+				outValues.insert( outValues.end(), values, values + section->mCount );
+				return;
+			}
+
+			size_t cursor = 0;
+			for ( size_t row = 0; row < section->mCount && cursor < inEntities.size(); ++row ) {
+				while ( cursor < inEntities.size() && inEntities[cursor] < entities[row] ) ++cursor;
+				if ( cursor < inEntities.size() && inEntities[cursor] == entities[row] ) {
+					outEntities.push_back( entities[row] );
+					outValues.push_back( values[row] );
+				}
+			}
+		}
+	};
+}
+
+bool Cyclone::Core::Serialization::LevelFilter::Matches( entt::id_type inEntityType, entt::id_type inEntityCategory, const std::array<int32_t, 3> &inCell ) const
+{
+	const bool isAnyType = mEntityTypes.empty() && mEntityCategories.empty();
+	if ( !isAnyType && std::find( mEntityTypes.begin(), mEntityTypes.end(), inEntityType ) == mEntityTypes.end() && std::find( mEntityCategories.begin(), mEntityCategories.end(), inEntityCategory ) == mEntityCategories.end() ) return false;
+	if ( !mRegion ) return true;
+
+	// The w extent is unbounded, so only x, y and z decide
+	const double halfSize = LevelFile::kPartitionCellSize * 0.5;
+	Cyclone::Math::BoundingBox<Cyclone::Math::Vector4D> cell{
+		Cyclone::Math::Vector4D( ( inCell[0] + 0.5 ) * LevelFile::kPartitionCellSize, ( inCell[1] + 0.5 ) * LevelFile::kPartitionCellSize, ( inCell[2] + 0.5 ) * LevelFile::kPartitionCellSize ),
+		Cyclone::Math::Vector4D( halfSize, halfSize, halfSize, std::numeric_limits<double>::infinity() ),
+	};
+	return cell.Intersects( *mRegion );
+}
+
+bool Cyclone::Core::Serialization::LevelFile::sSave( const entt::registry &inRegistry, const std::filesystem::path &inPath, bool inAllowParallel, bool inCompress )
+{
+	return Cyclone::Util::MappedFile::sReplace( inPath, [&]( const std::filesystem::path &inTemporaryPath ) {
+		const std::array<const entt::registry *, 1> registries = { &inRegistry };
+		std::vector<CopyPartition> copies;
+		return WriteLevel( registries, {}, copies, inTemporaryPath, inAllowParallel, inCompress );
+	} );
+}
+
+bool Cyclone::Core::Serialization::LevelFile::sSavePartial( const entt::registry &inRegistry, const std::filesystem::path &inPath, std::span<const entt::entity> inUnloaded, const std::filesystem::path &inSource, bool inAllowParallel, bool inCompress )
+{
+	if ( inUnloaded.empty() ) return sSave( inRegistry, inPath, inAllowParallel, inCompress );
+
+	// The source is only mapped while the level is written, it may be the file being replaced once it is closed
+	return Cyclone::Util::MappedFile::sReplace( inPath, [&]( const std::filesystem::path &inTemporaryPath ) {
+		Cyclone::Util::MappedFile source;
+		if ( !source.Open( inSource, Cyclone::Util::MappedFile::EMode::Read ) ) return false;
+
+		FileHeader header;
+		std::vector<PartitionEntry> partitions;
+		if ( !ReadIndex( std::span<const std::byte>( source.GetData(), source.GetSize() ), header, partitions ) ) return false;
+		const std::span<const std::byte> data( source.GetData(), header.mFileSize );
+
+		// Appended segments hold newer states than the partitions of the entities they list
+		std::vector<entt::entity> appended;
+		uint64_t offset = AlignSection( header.mPartitionsEnd );
+		for ( uint32_t index = header.mPartitionCount; index < header.mSegmentCount; ++index ) {
+			SegmentView segment;
+			if ( !ReadSegment( data, offset, false, segment ) ) return false;
+			appended.insert( appended.end(), segment.mEntities.begin(), segment.mEntities.end() );
+			appended.insert( appended.end(), segment.mTombstones.begin(), segment.mTombstones.end() );
+			offset = AlignSection( segment.mEnd );
+		}
+		std::sort( appended.begin(), appended.end() );
+
+		// A partition holding only unloaded entities, none of them appended since, is copied as it is, any other one holding an unloaded entity is loaded
+		std::vector<uint8_t> copied( partitions.size() );
+		std::vector<uint8_t> needed( partitions.size() );
+		std::vector<uint8_t> valid( partitions.size() );
+		std::vector<uint64_t> sizes( partitions.size() );
+		std::vector<size_t> indices( partitions.size() );
+		std::iota( indices.begin(), indices.end(), size_t{ 0 } );
+		Cyclone::Util::ForEachTask( indices, inAllowParallel && indices.size() > 1, [&]( size_t inIndex ) {
+			SegmentView segment;
+			valid[inIndex] = ReadSegment( data, partitions[inIndex].mOffset, false, segment ) && segment.mEnd <= header.mPartitionsEnd;
+			if ( !valid[inIndex] ) return;
+
+			copied[inIndex] = std::includes( inUnloaded.begin(), inUnloaded.end(), segment.mEntities.begin(), segment.mEntities.end() ) && !HasCommonEntity( segment.mEntities, appended );
+			needed[inIndex] = !copied[inIndex] && HasCommonEntity( segment.mEntities, inUnloaded );
+			sizes[inIndex] = segment.mEnd - partitions[inIndex].mOffset;
+		} );
+		if ( std::find( valid.begin(), valid.end(), uint8_t{ 0 } ) != valid.end() ) return false;
+
+		entt::registry unloaded;
+		if ( !LoadLevel( data, header, partitions, EntitySelector{ inUnloaded, needed }, unloaded, nullptr ) ) return false;
+
+		std::vector<CopyPartition> copies;
+		for ( size_t index = 0; index < partitions.size(); ++index ) {
+			if ( copied[index] ) copies.push_back( CopyPartition{ partitions[index], sizes[index], 0 } );
+		}
+
+		const std::array<const entt::registry *, 2> registries = { &inRegistry, &unloaded };
+		return WriteLevel( registries, data, copies, inTemporaryPath, inAllowParallel, inCompress );
+	} );
+}
+
+bool Cyclone::Core::Serialization::LevelFile::sAppend( const entt::registry &inRegistry, const std::filesystem::path &inPath, std::span<const entt::entity> inEntities, std::span<const entt::entity> inUnloaded )
+{
+	std::vector<entt::entity> entities;
+	std::vector<entt::entity> tombstones;
+	const auto *types = inRegistry.storage<Component::EntityType>();
+	for ( const entt::entity entity : inEntities ) {
+		if ( types && types->contains( entity ) ) entities.push_back( entity );
+		else tombstones.push_back( entity );
+	}
+	std::sort( entities.begin(), entities.end() );
+	std::sort( tombstones.begin(), tombstones.end() );
+
+	Cyclone::Util::MappedFile file;
+	if ( !file.Open( inPath, Cyclone::Util::MappedFile::EMode::Append ) ) return false;
+
+	FileHeader header;
+	std::vector<PartitionEntry> partitions;
+	const std::span<const std::byte> data( file.GetData(), file.GetSize() );
+	if ( !ReadIndex( data, header, partitions ) ) return false;
+
+	// Appended segments are compressed as the partitions are
+	bool compress = true;
+	if ( !partitions.empty() ) {
+		SegmentHeader firstSegment;
+		if ( !IsInFile( data, partitions.front().mOffset, 1, sizeof( SegmentHeader ) ) ) return false;
+		std::memcpy( &firstSegment, data.data() + partitions.front().mOffset, sizeof( SegmentHeader ) );
+		compress = ( firstSegment.mFlags & kCompressedSegment ) != 0;
+	}
+
+	// Anything after the last complete segment was left by a torn append and is overwritten
+	SegmentLayout layout;
+	layout.mEntities = entities;
+	layout.mTombstones = tombstones;
+	if ( compress ) {
+		LayoutSegment( inRegistry, 0, false, layout );
+		EncodeSegment( inRegistry, AlignSection( header.mFileSize ), false, layout );
+	}
+	else {
+		LayoutSegment( inRegistry, AlignSection( header.mFileSize ), false, layout );
+	}
+
+	// Fold every segment back into partitions once the appended ones outweigh the level they patch
+	const uint64_t levelBytes = header.mPartitionsEnd - GetSegmentsOffset( header.mPartitionCount );
+	const uint64_t appendedBytes = layout.mEnd - header.mPartitionsEnd;
+	if ( header.mSegmentCount - header.mPartitionCount >= kMaxSegments || appendedBytes > levelBytes ) {
+		file.Close();
+		return sSavePartial( inRegistry, inPath, inUnloaded, inPath, true, compress );
+	}
+
+	if ( !file.Resize( layout.mEnd ) ) return false;
+	WriteSegment( inRegistry, layout, false, file.GetData() );
+	if ( !file.Flush( layout.mOffset, layout.mEnd - layout.mOffset ) ) return false;
+
+	// The segment only becomes part of the level once it reached the device
+	++header.mSegmentCount;
+	header.mFileSize = layout.mEnd;
+	std::memcpy( file.GetData(), &header, sizeof( FileHeader ) );
+	return file.Flush( 0, sizeof( FileHeader ) );
+}
+
+bool Cyclone::Core::Serialization::LevelFile::sLoad( const std::filesystem::path &inPath, entt::registry &ioRegistry )
+{
+	assert( ioRegistry.storage<entt::entity>().empty() && "Levels can only be loaded into an empty registry!" );
+
+	Cyclone::Util::MappedFile file;
+	if ( !file.Open( inPath, Cyclone::Util::MappedFile::EMode::Read ) ) return false;
+
+	FileHeader header;
+	std::vector<PartitionEntry> partitions;
+	if ( !ReadIndex( std::span<const std::byte>( file.GetData(), file.GetSize() ), header, partitions ) ) return false;
+
+	const LevelFilter everything;
+	return LoadLevel( std::span<const std::byte>( file.GetData(), header.mFileSize ), header, partitions, FilterSelector{ everything }, ioRegistry, nullptr );
+}
+
+bool Cyclone::Core::Serialization::LevelFile::sLoadPartial( const std::filesystem::path &inPath, const LevelFilter &inFilter, entt::registry &ioRegistry, std::vector<entt::entity> &outUnloaded )
+{
+	assert( ioRegistry.storage<entt::entity>().empty() && "Levels can only be loaded into an empty registry!" );
+
+	Cyclone::Util::MappedFile file;
+	if ( !file.Open( inPath, Cyclone::Util::MappedFile::EMode::Read ) ) return false;
+
+	FileHeader header;
+	std::vector<PartitionEntry> partitions;
+	if ( !ReadIndex( std::span<const std::byte>( file.GetData(), file.GetSize() ), header, partitions ) ) return false;
+
+	return LoadLevel( std::span<const std::byte>( file.GetData(), header.mFileSize ), header, partitions, FilterSelector{ inFilter }, ioRegistry, &outUnloaded );
+}
+
+void Cyclone::Core::Serialization::LevelFile::sGatherEntities( const entt::registry &inRegistry, std::vector<entt::entity> &ioEntities )
+{
+	const auto *types = inRegistry.storage<Component::EntityType>();
+	if ( !types ) return;
+
+	ioEntities.insert( ioEntities.end(), types->entt::sparse_set::begin(), types->entt::sparse_set::end() );
+}
+
+void Cyclone::Core::Serialization::LevelFile::sCreateEntities( std::span<const entt::entity> inEntities, entt::registry &ioRegistry )
+{
+	assert( ioRegistry.storage<entt::entity>().empty() && "Entities can only be created with their identifiers in an empty registry!" );
+
+	// A level saved without holes in its identifiers is created in one go, otherwise each identifier is requested
+	const bool isDense = inEntities.empty() || inEntities.back() == static_cast<entt::entity>( inEntities.size() - 1 );
+	if ( isDense ) {
+		std::vector<entt::entity> created( inEntities.size() );
+		ioRegistry.create( created.begin(), created.end() );
+		assert( std::equal( created.begin(), created.end(), inEntities.begin() ) );
+		return;
+	}
+
+	for ( const entt::entity entity : inEntities ) {
+		auto retEntity = ioRegistry.create( entity );
+		assert( retEntity == entity );
+	}
+}
+
+bool Cyclone::Core::Serialization::LevelFile::Reader::Open( const std::filesystem::path &inPath )
+{
+	Close();
+	if ( !mFile.Open( inPath, Cyclone::Util::MappedFile::EMode::Read ) ) return false;
+
+	FileHeader header;
+	std::vector<PartitionEntry> partitions;
+	if ( !ReadIndex( std::span<const std::byte>( mFile.GetData(), mFile.GetSize() ), header, partitions ) ) {
+		Close();
+		return false;
+	}
+	mData = std::span<const std::byte>( mFile.GetData(), header.mFileSize );
+
+	// Every section is validated now, a compressed segment is then read again for its entities only so the level is never decoded whole
+	const auto readSegment = [this]( uint64_t inOffset, SegmentView &outSegment ) {
+		if ( !ReadSegment( mData, inOffset, true, outSegment ) ) return false;
+		if ( outSegment.mImage.empty() ) return true;
+
+		outSegment = {};
+		return ReadSegment( mData, inOffset, false, outSegment );
+	};
+
+	std::vector<SegmentView> segments( partitions.size() );
+	std::vector<uint8_t> valid( partitions.size() );
+	std::vector<size_t> indices( partitions.size() );
+	std::iota( indices.begin(), indices.end(), size_t{ 0 } );
+	Cyclone::Util::ForEachTask( indices, indices.size() > 1, [&]( size_t inIndex ) {
+		const PartitionEntry &entry = partitions[inIndex];
+		SegmentView &segment = segments[inIndex];
+		valid[inIndex] = readSegment( entry.mOffset, segment ) && segment.mEnd <= header.mPartitionsEnd && segment.mTombstones.empty() && segment.mEntities.size() == entry.mEntityCount;
+	} );
+
+	std::vector<SegmentView> appended( header.mSegmentCount - header.mPartitionCount );
+	std::vector<uint64_t> appendedOffsets;
+	uint64_t offset = AlignSection( header.mPartitionsEnd );
+	bool isValid = std::find( valid.begin(), valid.end(), uint8_t{ 0 } ) == valid.end();
+	for ( SegmentView &segment : appended ) {
+		isValid = isValid && readSegment( offset, segment );
+		if ( !isValid ) break;
+
+		appendedOffsets.push_back( offset );
+		offset = AlignSection( segment.mEnd );
+	}
+
+	std::vector<std::vector<entt::entity>> appendedRows;
+	std::vector<entt::entity> decided;
+	if ( !isValid || !ResolveEntities( segments, appended, appendedRows, decided, mEntities ) ) {
+		Close();
+		return false;
+	}
+
+	// A partition whose entities were all replaced or deleted by appended segments holds nothing of the level anymore
+	std::vector<entt::entity> rows;
+	for ( size_t index = 0; index < segments.size(); ++index ) {
+		const SegmentView &segment = segments[index];
+		rows.clear();
+		std::set_difference( segment.mEntities.begin(), segment.mEntities.end(), decided.begin(), decided.end(), std::back_inserter( rows ) );
+		if ( rows.empty() ) continue;
+
+		const PartitionEntry &entry = partitions[index];
+		mParts.push_back( Part{ std::array{ entry.mCellX, entry.mCellY, entry.mCellZ }, rows.size() } );
+		mOffsets.push_back( entry.mOffset );
+		mRows.push_back( rows.size() == segment.mEntities.size() ? std::vector<entt::entity>{} : rows );
+	}
+
+	for ( size_t index = 0; index < appended.size(); ++index ) {
+		if ( appendedRows[index].empty() ) continue;
+
+		mParts.push_back( Part{ std::nullopt, appendedRows[index].size() } );
+		mOffsets.push_back( appendedOffsets[index] );
+		mRows.push_back( std::move( appendedRows[index] ) );
+	}
+
+	return true;
+}
+
+void Cyclone::Core::Serialization::LevelFile::Reader::Close()
+{
+	mFile.Close();
+	mData = {};
+	mEntities = {};
+	mParts = {};
+	mOffsets = {};
+	mRows = {};
+}
+
+void Cyclone::Core::Serialization::LevelFile::Reader::ReadPart( size_t inIndex, std::vector<entt::entity> &outEntities, ComponentColumns<level_components> &ioColumns ) const
+{
+	// Validated when the file was opened, the mapping keeps it from being changed since
+	SegmentView segment;
+	const bool isValid = ReadSegment( mData, mOffsets[inIndex], true, segment );
+	assert( isValid && "Level file changed while it was read!" );
+	if ( !isValid ) return;
+
+	const std::vector<entt::entity> &rows = mRows[inIndex];
+	if ( rows.empty() ) {
+		outEntities.insert( outEntities.end(), segment.mEntities.begin(), segment.mEntities.end() );
+	}
+	else {
+		outEntities.insert( outEntities.end(), rows.begin(), rows.end() );
+	}
+
+	Cyclone::Util::ApplyOverTypeList<level_components>( ReadColumnFunctor{}, segment, std::span<const entt::entity>( rows ), ioColumns );
+}
\ No newline at end of file
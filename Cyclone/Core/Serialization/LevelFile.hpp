@@ -0,0 +1,191 @@
+#pragma once
+
+// Cyclone utils
+#include "Cyclone/Util/MappedFile.hpp"
+
+// Cyclone history
+#include "Cyclone/Core/History/Epoch.hpp"
+
+// STL
+#include <span>
+#include <vector>
+#include <optional>
+#include <filesystem>
+
+namespace Cyclone::Core::Serialization
+{
+	/// Every component stored in a level file, each one is a separate section
+	using level_components = History::history_columns;
+
+	template<typename>
+	struct ComponentColumns;
+
+	/// @brief Values of each component of a type list packed with the entities owning them, ready to be bulk inserted into a registry
+	/// @note Shared by everything rebuilding a level from packed values, the streamed chunks, the autosave snapshot and the parsed text
+	template<typename... Types>
+	struct ComponentColumns<entt::type_list<Types...>>
+	{
+		std::array<std::vector<entt::entity>, sizeof...( Types )> mEntities;	///< In the order of the type list
+		std::tuple<std::vector<Types>...> mValues;
+
+		template<typename T>
+		std::vector<entt::entity> &				GetEntities()		{ return mEntities[entt::type_list_index_v<T, entt::type_list<Types...>>]; }
+		template<typename T>
+		const std::vector<entt::entity> &		GetEntities() const	{ return mEntities[entt::type_list_index_v<T, entt::type_list<Types...>>]; }
+		template<typename T>
+		std::vector<T> &						GetValues()			{ return std::get<std::vector<T>>( mValues ); }
+		template<typename T>
+		const std::vector<T> &					GetValues() const	{ return std::get<std::vector<T>>( mValues ); }
+
+		/// @brief Bulk inserts every column into ioRegistry, whose entities must exist without these components
+		void									Insert( entt::registry &ioRegistry ) const { ( sInsertColumn( GetEntities<Types>(), GetValues<Types>(), ioRegistry ), ... ); }
+
+		/// @brief As Insert(), each column is freed as soon as it is inserted so the values are never held twice
+		void									MoveInto( entt::registry &ioRegistry )
+		{
+			( ( sInsertColumn( GetEntities<Types>(), GetValues<Types>(), ioRegistry ), GetEntities<Types>() = {}, GetValues<Types>() = {} ), ... );
+		}
+
+		template<typename T>
+		static void								sInsertColumn( const std::vector<entt::entity> &inEntities, const std::vector<T> &inValues, entt::registry &ioRegistry )
+		{
+			if ( !inEntities.empty() ) ioRegistry.storage<T>().insert( inEntities.begin(), inEntities.end(), inValues.begin() );
+		}
+	};
+
+	/// @brief Part of a level to load, an empty filter matches the whole level
+	/// @note Matched against the partitions of a level file, so every entity sharing a partition with a matching one is loaded as well
+	struct LevelFilter
+	{
+		std::optional<Cyclone::Math::BoundingBox<Cyclone::Math::Vector4D>> mRegion;	///< Partitions whose cell overlaps it
+		std::vector<entt::id_type>	mEntityTypes;		///< Partitions of any of these entity types or entity categories, both empty for every one
+		std::vector<entt::id_type>	mEntityCategories;
+
+		bool					IsEverything() const { return !mRegion && mEntityTypes.empty() && mEntityCategories.empty(); }
+		bool					Matches( entt::id_type inEntityType, entt::id_type inEntityCategory, const std::array<int32_t, 3> &inCell ) const;
+	};
+
+	/// @brief Native binary level format, an index of partitions followed by segments each holding a table of contents and one aligned section per component storage
+	/// @note Sections hold the values exactly as the storages do, so loading maps the file and bulk inserts straight from it without parsing anything per entity
+	/// @note Entities keep their identifiers, so the undo history and the crash journal still refer to the right entities after a level is reloaded
+	/// @note The level is split into partitions, a segment for the entities sharing an entity type, an entity category and a cell of kPartitionCellSize, so part of a level is loaded without reading the rest
+	/// @note Every segment after the partitions replaces the entities it lists and deletes its tombstones
+	/// @note A compressed segment stores each entity and value array encoded with Util::BlockCodec, it is decoded into memory instead of being mapped
+	class LevelFile
+	{
+	public:
+		static constexpr uint32_t kFileMagic = 0x4C594343;	///< "CCYL"
+		static constexpr uint32_t kVersion = 4;
+		static constexpr size_t kSectionAlignment = 64;		///< Cache line, also satisfies the alignment of every component
+		static constexpr const char *kExtension = ".cyl";
+		static constexpr size_t kParallelSaveRows = 32768;	///< Smaller levels are saved on the calling thread
+		static constexpr size_t kSaveTaskRows = 65536;		///< Rows of a section written by one worker
+		static constexpr uint32_t kMaxSegments = 16;		///< Appending past this many segments rewrites the level into partitions
+		static constexpr entt::id_type kTombstoneSectionId = "tombstones"_hs.value();
+		static constexpr uint32_t kCompressedSegment = 1 << 0;	///< Segment flag
+		static constexpr double kPartitionCellSize = 256.0;
+
+		struct FileHeader
+		{
+			uint32_t				mMagic;
+			uint32_t				mVersion;
+			uint32_t				mSegmentCount;
+			uint32_t				mPartitionCount;	///< Leading segments, each listed by a PartitionEntry directly following the file header
+			uint64_t				mFileSize;			///< End of the last complete segment, anything after it was left by a torn append
+			uint64_t				mPartitionsEnd;		///< End of the last partition, appended segments follow it
+		};
+
+		struct PartitionEntry
+		{
+			uint32_t				mEntityType;
+			uint32_t				mEntityCategory;
+			int32_t					mCellX;
+			int32_t					mCellY;
+			int32_t					mCellZ;
+			uint32_t				mEntityCount;
+			uint64_t				mOffset;			///< Of the segment header
+		};
+
+		struct SegmentHeader
+		{
+			uint32_t				mSectionCount;	///< Section headers directly follow the segment header
+			uint32_t				mFlags;
+			uint64_t				mSize;			///< Bytes from the segment header to the end of its last section
+		};
+
+		struct SectionHeader
+		{
+			uint32_t				mId;				///< entt::type_hash of the component, of entt::entity for the entities of the segment, or kTombstoneSectionId
+			uint32_t				mValueSize;			///< Bytes of one value, zero for the entity and tombstone sections
+			uint64_t				mCount;
+			uint64_t				mEntitiesOffset;	///< Sorted entities owning the values
+			uint64_t				mValuesOffset;		///< Values in the order of the entities
+			uint64_t				mEntitiesSize;		///< Bytes stored at mEntitiesOffset, encoded in a compressed segment
+			uint64_t				mValuesSize;
+		};
+
+		/// @brief Writes every entity of an entity class and its level components split into partitions, orphans kept for the undo history are skipped
+		/// @note Partitions are gathered and written by their own workers straight into the mapped file, the registry must not change until this returns
+		/// @note Written next to inPath first and then moved over it, so a failed save never damages the previous file
+		/// @param inCompress Encodes every section, the blocks of each are compressed in parallel
+		/// @note Off by default, a compressed file is decoded into a temporary image on load instead of being inserted straight from the mapping
+		static bool				sSave( const entt::registry &inRegistry, const std::filesystem::path &inPath, bool inAllowParallel = true, bool inCompress = false );
+
+		/// @brief As sSave(), for a level loaded with sLoadPartial(), inUnloaded are written as they are in inSource
+		/// @note Partitions of inSource holding only unloaded entities are copied without being decoded, inSource may be inPath
+		static bool				sSavePartial( const entt::registry &inRegistry, const std::filesystem::path &inPath, std::span<const entt::entity> inUnloaded, const std::filesystem::path &inSource, bool inAllowParallel = true, bool inCompress = false );
+
+		/// @brief Appends a segment holding the current state of inEntities, those without an entity class are written as tombstones
+		/// @note The segment is compressed if the first partition of the file is
+		/// @note Once the appended segments outgrow the partitions, or there are kMaxSegments of them, the level is rewritten with sSave() or sSavePartial() instead
+		/// @param inUnloaded Entities of a level loaded with sLoadPartial() which must be kept if the level is rewritten
+		/// @return False if inPath is not a level file, nothing is written then
+		static bool				sAppend( const entt::registry &inRegistry, const std::filesystem::path &inPath, std::span<const entt::entity> inEntities, std::span<const entt::entity> inUnloaded = {} );
+
+		/// @brief Loads a level into an empty registry, nothing is created unless the whole file is valid
+		static bool				sLoad( const std::filesystem::path &inPath, entt::registry &ioRegistry );
+
+		/// @brief Loads the partitions matching inFilter into an empty registry, only their sections are decoded
+		/// @note Every other entity is created without components, so its identifier stays taken, and listed in outUnloaded
+		/// @note An entity replaced by an appended segment is matched by its state in that segment
+		static bool				sLoadPartial( const std::filesystem::path &inPath, const LevelFilter &inFilter, entt::registry &ioRegistry, std::vector<entt::entity> &outUnloaded );
+
+		/// @brief Appends every entity belonging to the level to ioEntities, in the order of the entity type storage
+		/// @note Only entities of an entity class belong to the level, orphans kept for the undo history are left out of every save, bake and diff
+		static void				sGatherEntities( const entt::registry &inRegistry, std::vector<entt::entity> &ioEntities );
+
+		/// @brief Creates sorted entities in an empty registry with their exact identifiers, in a single call if they have no holes
+		static void				sCreateEntities( std::span<const entt::entity> inEntities, entt::registry &ioRegistry );
+
+		/// @brief A level file read one part at a time in any order, each part is a partition or what an appended segment still holds of the level
+		/// @note Opening validates the whole file but keeps only the entities, the sections of a part are read when it is asked for
+		class Reader : public Cyclone::Util::NonCopyable
+		{
+		public:
+			struct Part
+			{
+				std::optional<std::array<int32_t, 3>> mCell;	///< Of the partition, none for an appended segment whose entities may be anywhere
+				size_t				mEntityCount = 0;
+			};
+
+			/// @return False if inPath is not a valid level file
+			bool				Open( const std::filesystem::path &inPath );
+			void				Close();
+
+			/// @brief Every entity of the level, sorted
+			std::span<const entt::entity> GetEntities() const	{ return mEntities; }
+			std::span<const Part> GetParts() const				{ return mParts; }
+
+			/// @brief Appends the entities of a part to outEntities and their components to ioColumns, both sorted by entity
+			void				ReadPart( size_t inIndex, std::vector<entt::entity> &outEntities, ComponentColumns<level_components> &ioColumns ) const;
+
+		protected:
+			Cyclone::Util::MappedFile mFile;
+			std::span<const std::byte> mData;				///< The mapping up to the end of the last complete segment
+			std::vector<entt::entity> mEntities;
+			std::vector<Part>		mParts;
+			std::vector<uint64_t>	mOffsets;				///< Of the segment each part is read from
+			std::vector<std::vector<entt::entity>> mRows;	///< Entities each part holds the state of, empty if every entity of its segment
+		};
+	};
+}
\ No newline at end of file
@@ -0,0 +1,321 @@
+#include "pch.h"
+#include "Cyclone/Core/Serialization/LevelStreamer.hpp"
+
+// Cyclone utils
+#include "Cyclone/Util/TypeList.hpp"
+
+// Cyclone components
+#include "Cyclone/Core/Component/Position.hpp"
+
+// STL
+#include <cmath>
+
+namespace
+{
+	double DistanceSquared( Cyclone::Math::Vector4D inLhs, Cyclone::Math::Vector4D inRhs )
+	{
+		const Cyclone::Math::Vector4D delta = inLhs - inRhs;
+		return delta.GetX() * delta.GetX() + delta.GetY() * delta.GetY() + delta.GetZ() * delta.GetZ();
+	}
+
+	/// Squared distance to the nearest focus point, to the origin without any
+	double GetFocusDistance( std::span<const Cyclone::Math::Vector4D> inFocus, Cyclone::Math::Vector4D inPoint )
+	{
+		double distance = inFocus.empty() ? DistanceSquared( inPoint, Cyclone::Math::Vector4D::sZero() ) : std::numeric_limits<double>::max();
+		for ( const Cyclone::Math::Vector4D focus : inFocus ) {
+			distance = std::min( distance, DistanceSquared( inPoint, focus ) );
+		}
+		return distance;
+	}
+
+	/// Orders partitions nearest last and chunk heaps nearest on top
+	constexpr auto IsFarther = []( const auto &inLhs, const auto &inRhs ) { return inLhs.mDistance > inRhs.mDistance; };
+
+	/// A part of the level file not packed yet
+	struct Part
+	{
+		size_t						mIndex = 0;			///< In the parts of the reader
+		Cyclone::Math::Vector4D		mCenter = Cyclone::Math::Vector4D::sZero();
+		double						mDistance = 0.0;	///< Squared, to the focus the parts were last sorted by
+		bool						mIsAnywhere = false;	///< An appended segment, holding the latest edits anywhere in the level
+	};
+
+	/// Cell of the chunk grid holding inPosition, 21 bits per axis cover far more than any level
+	uint64_t GetCellKey( Cyclone::Math::Vector4D inPosition, Cyclone::Math::Vector4D &outCenter )
+	{
+		const double chunkSize = Cyclone::Core::Serialization::LevelStreamer::kChunkSize;
+		const auto cellX = static_cast<int64_t>( std::floor( inPosition.GetX() / chunkSize ) );
+		const auto cellY = static_cast<int64_t>( std::floor( inPosition.GetY() / chunkSize ) );
+		const auto cellZ = static_cast<int64_t>( std::floor( inPosition.GetZ() / chunkSize ) );
+
+		outCenter = Cyclone::Math::Vector4D( ( cellX + 0.5 ) * chunkSize, ( cellY + 0.5 ) * chunkSize, ( cellZ + 0.5 ) * chunkSize );
+		return ( static_cast<uint64_t>( cellX ) & 0x1FFFFF ) | ( static_cast<uint64_t>( cellY ) & 0x1FFFFF ) << 21 | ( static_cast<uint64_t>( cellZ ) & 0x1FFFFF ) << 42;
+	}
+}
+
+struct Cyclone::Core::Serialization::LevelStreamer::SplitColumnFunctor
+{
+	/// Moves each row of a column of the partition to the chunk its entity is packed in, the column is freed once split
+	template<typename T>
+	void Apply( ComponentColumns<level_components> &ioPart, std::span<const entt::entity> inEntities, std::span<const uint32_t> inChunks, std::span<Chunk> ioChunks ) const
+	{
+		std::vector<entt::entity> &entities = ioPart.GetEntities<T>();
+		std::vector<T> &values = ioPart.GetValues<T>();
+
+		// Both are sorted by entity, so the chunk of each row is found by a single merge walk
+		size_t cursor = 0;
+		for ( size_t row = 0; row < entities.size(); ++row ) {
+			while ( inEntities[cursor] != entities[row] ) ++cursor;
+
+			Chunk &chunk = ioChunks[inChunks[cursor]];
+			chunk.mColumns.GetEntities<T>().push_back( entities[row] );
+			chunk.mColumns.GetValues<T>().push_back( std::move( values[row] ) );
+		}
+
+		entities = {};
+		values = {};
+	}
+};
+
+void Cyclone::Core::Serialization::LevelStreamer::Start( const std::filesystem::path &inPath )
+{
+	Cancel();
+
+	{
+		std::lock_guard lock( mMutex );
+		mPath = inPath;
+		mState = EState::Loading;
+	}
+
+	mWorker = std::jthread( [this]( std::stop_token inStopToken ) { WorkerThread( inStopToken ); } );
+}
+
+void Cyclone::Core::Serialization::LevelStreamer::Cancel()
+{
+	if ( mWorker.joinable() ) {
+		mWorker.request_stop();
+		mWorker.join();
+	}
+
+	std::lock_guard lock( mMutex );
+	mPath.clear();
+	mState = EState::Idle;
+	mEntities = {};
+	mReserved = false;
+	mPacked = false;
+	mChunks = {};
+	mEntityCount = 0;
+	mCommittedCount = 0;
+}
+
+void Cyclone::Core::Serialization::LevelStreamer::SetFocus( std::span<const Cyclone::Math::Vector4D> inPoints )
+{
+	std::lock_guard lock( mMutex );
+
+	bool moved = inPoints.size() != mFocus.size();
+	for ( size_t index = 0; !moved && index < inPoints.size(); ++index ) {
+		moved = DistanceSquared( inPoints[index], mFocus[index] ) >= kRefocusDistance * kRefocusDistance;
+	}
+	if ( !moved ) return;
+
+	mFocus.assign( inPoints.begin(), inPoints.end() );
+	++mFocusVersion;
+	mSignal.notify_one();
+}
+
+bool Cyclone::Core::Serialization::LevelStreamer::ReserveEntities( entt::registry &ioRegistry )
+{
+	std::vector<entt::entity> entities;
+	{
+		std::lock_guard lock( mMutex );
+		if ( mState != EState::Streaming || mReserved ) return false;
+
+		mReserved = true;
+		entities = std::move( mEntities );
+	}
+
+	LevelFile::sCreateEntities( entities, ioRegistry );
+	return true;
+}
+
+void Cyclone::Core::Serialization::LevelStreamer::Commit( entt::registry &ioRegistry, std::chrono::microseconds inBudget, std::vector<entt::entity> &outEntities )
+{
+	assert( mReserved && "Entities must be reserved before any chunk is committed!" );
+
+	const auto start = std::chrono::steady_clock::now();
+	outEntities.clear();
+
+	std::unique_lock lock( mMutex );
+	while ( !mChunks.empty() && std::chrono::steady_clock::now() - start < inBudget ) {
+		// The worker keeps the heap ordered by the current focus
+		std::pop_heap( mChunks.begin(), mChunks.end(), IsFarther );
+		Chunk chunk = std::move( mChunks.back() );
+		mChunks.pop_back();
+
+		// Inserted without the lock, so the worker keeps packing meanwhile
+		lock.unlock();
+		chunk.mColumns.Insert( ioRegistry );
+		outEntities.insert( outEntities.end(), chunk.mEntities.begin(), chunk.mEntities.end() );
+		lock.lock();
+
+		mCommittedCount += chunk.mEntities.size();
+	}
+
+	if ( mChunks.empty() ) mSignal.notify_one();
+}
+
+Cyclone::Core::Serialization::LevelStreamer::EState Cyclone::Core::Serialization::LevelStreamer::GetState() const
+{
+	std::lock_guard lock( mMutex );
+	return mState;
+}
+
+bool Cyclone::Core::Serialization::LevelStreamer::IsReserved() const
+{
+	std::lock_guard lock( mMutex );
+	return mReserved;
+}
+
+bool Cyclone::Core::Serialization::LevelStreamer::IsFinished() const
+{
+	std::lock_guard lock( mMutex );
+	// Counted rather than checking mChunks, which is briefly empty while the worker reorders it
+	return mState == EState::Streaming && mReserved && mPacked && mCommittedCount == mEntityCount;
+}
+
+float Cyclone::Core::Serialization::LevelStreamer::GetProgress() const
+{
+	std::lock_guard lock( mMutex );
+	return mEntityCount == 0 ? 0.0f : static_cast<float>( mCommittedCount ) / static_cast<float>( mEntityCount );
+}
+
+void Cyclone::Core::Serialization::LevelStreamer::WorkerThread( std::stop_token inStopToken )
+{
+	std::filesystem::path path;
+	{
+		std::lock_guard lock( mMutex );
+		path = mPath;
+	}
+
+	// Segments and tombstones are resolved up front, only the entities of the level are kept until a partition is read
+	LevelFile::Reader reader;
+	if ( !reader.Open( path ) ) {
+		std::lock_guard lock( mMutex );
+		mState = EState::Failed;
+		return;
+	}
+
+	std::vector<Part> parts( reader.GetParts().size() );
+	for ( size_t index = 0; index < parts.size(); ++index ) {
+		const std::optional<std::array<int32_t, 3>> &cell = reader.GetParts()[index].mCell;
+		parts[index].mIndex = index;
+		parts[index].mIsAnywhere = !cell;
+		if ( cell ) {
+			const double cellSize = LevelFile::kPartitionCellSize;
+			parts[index].mCenter = Cyclone::Math::Vector4D( ( ( *cell )[0] + 0.5 ) * cellSize, ( ( *cell )[1] + 0.5 ) * cellSize, ( ( *cell )[2] + 0.5 ) * cellSize );
+		}
+	}
+
+	{
+		std::lock_guard lock( mMutex );
+		mEntityCount = reader.GetEntities().size();
+		mEntities.assign( reader.GetEntities().begin(), reader.GetEntities().end() );
+		mState = EState::Streaming;
+	}
+
+	std::vector<Cyclone::Math::Vector4D> focus;
+	uint64_t focusVersion = 0;
+
+	// Chunks packed for an earlier focus are taken out and reordered without the lock, the UI thread just finds nothing to commit meanwhile
+	const auto reorderChunks = [&]() {
+		std::vector<Chunk> chunks;
+		{
+			std::lock_guard lock( mMutex );
+			chunks.swap( mChunks );
+		}
+
+		for ( Chunk &chunk : chunks ) chunk.mDistance = GetFocusDistance( focus, chunk.mCenter );
+		std::make_heap( chunks.begin(), chunks.end(), IsFarther );
+
+		std::lock_guard lock( mMutex );
+		assert( mChunks.empty() && "Only the worker adds chunks!" );
+		mChunks.swap( chunks );
+	};
+
+	// Partitions nearest to the focus are read and packed first, the focus may move while packing
+	bool isSorted = false;
+	std::vector<entt::entity> entities;
+	ComponentColumns<level_components> columns;
+	while ( !parts.empty() && !inStopToken.stop_requested() ) {
+		{
+			std::lock_guard lock( mMutex );
+			if ( !isSorted || focusVersion != mFocusVersion ) {
+				focus = mFocus;
+				focusVersion = mFocusVersion;
+				isSorted = false;
+			}
+		}
+
+		if ( !isSorted ) {
+			// Sorted without the lock, so the UI thread never waits on it
+			for ( Part &part : parts ) part.mDistance = part.mIsAnywhere ? 0.0 : GetFocusDistance( focus, part.mCenter );
+			std::sort( parts.begin(), parts.end(), IsFarther );
+			reorderChunks();
+			isSorted = true;
+		}
+
+		const Part part = parts.back();
+		parts.pop_back();
+
+		entities.clear();
+		reader.ReadPart( part.mIndex, entities, columns );
+
+		// Split by cell of the chunk grid, entities without a position go to the cell at the origin, and larger cells into several chunks
+		const std::vector<entt::entity> &positioned = columns.GetEntities<Component::Position>();
+		const std::vector<Component::Position> &positions = columns.GetValues<Component::Position>();
+		std::vector<Chunk> chunks;
+		std::vector<uint32_t> entityChunks( entities.size() );
+		std::unordered_map<uint64_t, uint32_t> cellChunks;	///< Last chunk of each cell
+		size_t cursor = 0;
+		for ( size_t row = 0; row < entities.size(); ++row ) {
+			const entt::entity entity = entities[row];
+			while ( cursor < positioned.size() && positioned[cursor] < entity ) ++cursor;
+			const Cyclone::Math::Vector4D position = cursor < positioned.size() && positioned[cursor] == entity ? positions[cursor].mValue : Cyclone::Math::Vector4D::sZero();
+
+			Cyclone::Math::Vector4D center = Cyclone::Math::Vector4D::sZero();
+			auto [it, inserted] = cellChunks.try_emplace( GetCellKey( position, center ), static_cast<uint32_t>( chunks.size() ) );
+			if ( !inserted && chunks[it->second].mEntities.size() == kMaxChunkEntities ) {
+				it->second = static_cast<uint32_t>( chunks.size() );
+				inserted = true;
+			}
+			if ( inserted ) {
+				Chunk &chunk = chunks.emplace_back();
+				chunk.mCenter = center;
+				chunk.mDistance = GetFocusDistance( focus, center );
+			}
+
+			entityChunks[row] = it->second;
+			chunks[it->second].mEntities.push_back( entity );
+		}
+		Cyclone::Util::ApplyOverTypeList<level_components>( SplitColumnFunctor{}, columns, std::span<const entt::entity>( entities ), std::span<const uint32_t>( entityChunks ), std::span<Chunk>( chunks ) );
+
+		std::lock_guard lock( mMutex );
+		for ( Chunk &chunk : chunks ) {
+			mChunks.push_back( std::move( chunk ) );
+			std::push_heap( mChunks.begin(), mChunks.end(), IsFarther );
+		}
+	}
+	reader.Close();
+
+	// Packing usually ends long before the last chunk is committed, the chunks keep following the focus until then
+	std::unique_lock lock( mMutex );
+	mPacked = true;
+	while ( mSignal.wait( lock, inStopToken, [&] { return mChunks.empty() || focusVersion != mFocusVersion; } ) && !mChunks.empty() ) {
+		focus = mFocus;
+		focusVersion = mFocusVersion;
+
+		lock.unlock();
+		reorderChunks();
+		lock.lock();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+// Cyclone utils
+#include "Cyclone/Util/NonCopyable.hpp"
+
+// Cyclone serialization
+#include "Cyclone/Core/Serialization/LevelFile.hpp"
+
+// STL
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <condition_variable>
+
+namespace Cyclone::Core::Serialization
+{
+	/// @brief Loads a level file on a worker thread and hands it over in spatial chunks, the chunks nearest to the focus first
+	/// @note The worker reads the partitions of the file nearest to the focus first and packs each into chunks, the UI thread only bulk inserts finished chunks within a time budget, so the editor keeps drawing while a large level arrives
+	/// @note Only the partition being packed and the chunks not committed yet are held, never the whole level
+	class LevelStreamer : public Cyclone::Util::NonCopyable
+	{
+	public:
+		static constexpr double kChunkSize = 64.0;			///< Edge of the cubic cells entities are grouped by
+		static constexpr size_t kMaxChunkEntities = 4096;		///< Larger cells are split, bounding the time one chunk takes to commit
+		static constexpr double kRefocusDistance = kChunkSize;	///< A focus point moving less than this keeps the current order of partitions and chunks
+
+		enum class EState : uint8_t
+		{
+			Idle,
+			Loading,	///< The worker is validating the file, no entity is known yet
+			Streaming,	///< Every entity is known, partitions are packed into chunks and committed
+			Failed,		///< The file could not be loaded, kept until the next Start() or Cancel()
+		};
+
+		LevelStreamer() = default;
+		~LevelStreamer() { Cancel(); }
+
+		/// @brief Starts loading inPath on the worker, a level still streaming is cancelled
+		void					Start( const std::filesystem::path &inPath );
+
+		/// @brief Stops the worker and drops every chunk not committed yet, waits for a file still being read
+		void					Cancel();
+
+		/// @brief Chunks nearest to any of inPoints are packed and committed first
+		/// @note Only a move by kRefocusDistance or more reorders them, so calling this every frame costs next to nothing
+		void					SetFocus( std::span<const Cyclone::Math::Vector4D> inPoints );
+
+		/// @brief Creates every entity of the level in ioRegistry without components, so their identifiers are taken before any chunk arrives
+		/// @return False until the worker has read the file, and after the entities were reserved once
+		bool					ReserveEntities( entt::registry &ioRegistry );
+
+		/// @brief Inserts finished chunks into ioRegistry, nearest to the focus first, until inBudget is used up
+		/// @param outEntities Receives every entity committed by this call
+		void					Commit( entt::registry &ioRegistry, std::chrono::microseconds inBudget, std::vector<entt::entity> &outEntities );
+
+		EState					GetState() const;
+		bool					IsReserved() const;
+		bool					IsFinished() const;	///< Every chunk was committed
+		float					GetProgress() const;
+		const std::filesystem::path &GetPath() const { return mPath; }
+
+	protected:
+		/// Entities of one cell packed per storage, ready to be bulk inserted
+		struct Chunk
+		{
+			Cyclone::Math::Vector4D		mCenter = Cyclone::Math::Vector4D::sZero();
+			double						mDistance = 0.0;	///< Squared, to the focus the chunk was ordered by
+			std::vector<entt::entity>	mEntities;
+			ComponentColumns<level_components> mColumns;
+		};
+
+		struct SplitColumnFunctor;
+
+		void					WorkerThread( std::stop_token inStopToken );
+
+		mutable std::mutex			mMutex;		///< Guards everything below shared with the worker
+		std::filesystem::path		mPath;
+		EState						mState = EState::Idle;
+		std::vector<Cyclone::Math::Vector4D> mFocus;	///< Focus the cells and chunks are ordered by
+		uint64_t					mFocusVersion = 0;	///< Bumped whenever mFocus is replaced
+		std::condition_variable_any	mSignal;	///< Wakes the worker once it packed every chunk, on a new focus or when the last chunk was committed
+		std::vector<entt::entity>	mEntities;	///< Every entity of the level, until they are reserved
+		bool						mReserved = false;
+		bool						mPacked = false;	///< The worker has packed every chunk
+		std::vector<Chunk>			mChunks;	///< Packed and waiting to be committed, a heap with the nearest chunk on top
+		size_t						mEntityCount = 0;
+		size_t						mCommittedCount = 0;
+		std::jthread				mWorker;	///< Declared last, so it is joined before the chunks are destroyed
+	};
+}
\ No newline at end of file
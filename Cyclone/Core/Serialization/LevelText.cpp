@@ -0,0 +1,322 @@
+#include "pch.h"
+#include "Cyclone/Core/Serialization/LevelText.hpp"
+
+// Cyclone utils
+#include "Cyclone/Util/MappedFile.hpp"
+#include "Cyclone/Util/Parallel.hpp"
+
+// Cyclone entities
+#include "Cyclone/Core/Entity/BaseEntity.hpp"
+
+// Cyclone serialization
+#include "Cyclone/Core/Serialization/TextCodec.hpp"
+
+// STL
+#include <execution>
+
+namespace
+{
+	using Cyclone::Core::Serialization::LevelText;
+	using Cyclone::Core::Serialization::TextCodec;
+
+	/// Components written as fields, the entity type is the class name starting each line instead
+	using text_components = entt::type_list_diff_t<Cyclone::Core::Serialization::level_components, entt::type_list<Cyclone::Core::Component::EntityType>>;
+
+	/// Lines written by one worker
+	struct SaveTask
+	{
+		size_t					mBegin;
+		size_t					mEnd;
+		std::vector<char>		mText;
+		bool					mValid = true;
+	};
+
+	/// Lines parsed by one worker, kept apart until every worker succeeded
+	struct LoadTask
+	{
+		const char *			mFirst;
+		const char *			mLast;
+		std::vector<entt::entity> mEntities;
+		std::vector<Cyclone::Core::Component::EntityType> mTypes;
+		Cyclone::Core::Serialization::ComponentColumns<text_components> mColumns;
+		bool					mValid = true;
+	};
+
+	template<typename T>
+	char *WriteField( const entt::sparse_set &inStorage, entt::entity inEntity, char *outText )
+	{
+		return TextCodec<T>::sWrite( outText, static_cast<const entt::storage_for_t<T> &>( inStorage ).get( inEntity ) );
+	}
+
+	template<typename T>
+	bool ReadField( const char *inFirst, const char *inLast, entt::entity inEntity, Cyclone::Core::Serialization::ComponentColumns<text_components> &ioColumns )
+	{
+		const std::optional<T> value = TextCodec<T>::sRead( inFirst, inLast );
+		if ( !value ) return false;
+
+		ioColumns.GetEntities<T>().push_back( inEntity );
+		ioColumns.GetValues<T>().push_back( *value );
+		return true;
+	}
+
+	using WriteFieldFn = char *( * )( const entt::sparse_set &, entt::entity, char * );
+	using ReadFieldFn = bool ( * )( const char *, const char *, entt::entity, Cyclone::Core::Serialization::ComponentColumns<text_components> & );
+
+	constexpr auto kWriteField = [] <typename... Types>( entt::type_list<Types...> ) { return std::array<WriteFieldFn, sizeof...( Types )>{ &WriteField<Types>... }; }( text_components{} );
+	constexpr auto kReadField = [] <typename... Types>( entt::type_list<Types...> ) { return std::array<ReadFieldFn, sizeof...( Types )>{ &ReadField<Types>... }; }( text_components{} );
+	constexpr auto kFieldIds = [] <typename... Types>( entt::type_list<Types...> ) { return std::array<entt::id_type, sizeof...( Types )>{ entt::type_hash<Types>::value()... }; }( text_components{} );
+	constexpr auto kFieldNames = [] <typename... Types>( entt::type_list<Types...> ) { return std::array<std::string_view, sizeof...( Types )>{ TextCodec<Types>::kName... }; }( text_components{} );
+	constexpr auto kFieldMaxChars = [] <typename... Types>( entt::type_list<Types...> ) { return std::array<size_t, sizeof...( Types )>{ TextCodec<Types>::kMaxChars... }; }( text_components{} );
+
+	static_assert( text_components::size <= 32, "Fields seen on a line are tracked in a 32 bit mask" );
+
+	/// Digits of the largest entity identifier
+	constexpr size_t kMaxEntityChars = std::numeric_limits<std::underlying_type_t<entt::entity>>::digits10 + 1;
+
+	/// An entity class as reflected by its meta type
+	struct TextClass
+	{
+		entt::id_type			mType;
+		std::string_view		mName;
+		std::vector<size_t>		mFields;		///< Indices into text_components, in that order
+		uint32_t				mFieldMask = 0;
+		size_t					mMaxLineChars = 0;
+	};
+
+	bool GatherClasses( const entt::meta_ctx &inMetaContext, std::vector<TextClass> &outClasses )
+	{
+		for ( const auto [typeHash, type] : entt::resolve( inMetaContext ) ) {
+			const Cyclone::Core::Entity::EntityComponents *components = type.custom();
+			if ( !components ) continue;
+
+			TextClass textClass{ type.id(), type.name() ? std::string_view( type.name() ) : std::string_view{} };
+			if ( textClass.mName.empty() || textClass.mName.find_first_of( " \t\r\n#" ) != std::string_view::npos ) return false;
+
+			for ( const entt::id_type componentType : components->mTypes ) {
+				if ( componentType == entt::type_hash<Cyclone::Core::Component::EntityType>::value() ) continue;
+
+				const auto field = std::find( kFieldIds.begin(), kFieldIds.end(), componentType );
+				assert( field != kFieldIds.end() && "Every history component needs a TextCodec!" );
+				if ( field == kFieldIds.end() ) return false;
+				textClass.mFieldMask |= 1u << ( field - kFieldIds.begin() );
+			}
+
+			// Fields are written in a fixed order, so the same level always gives the same text
+			textClass.mMaxLineChars = textClass.mName.size() + 1 + kMaxEntityChars + 1;
+			for ( size_t field = 0; field < text_components::size; ++field ) {
+				if ( !( textClass.mFieldMask & ( 1u << field ) ) ) continue;
+				textClass.mFields.push_back( field );
+				textClass.mMaxLineChars += 1 + kFieldNames[field].size() + 1 + kFieldMaxChars[field];
+			}
+
+			outClasses.push_back( std::move( textClass ) );
+		}
+
+		std::sort( outClasses.begin(), outClasses.end(), []( const TextClass &inLhs, const TextClass &inRhs ) { return inLhs.mType < inRhs.mType; } );
+		return true;
+	}
+
+	const TextClass *FindClass( const std::vector<TextClass> &inClasses, entt::id_type inType )
+	{
+		const auto it = std::lower_bound( inClasses.begin(), inClasses.end(), inType, []( const TextClass &inLhs, entt::id_type inRhs ) { return inLhs.mType < inRhs; } );
+		if ( it != inClasses.end() && it->mType == inType ) return &*it;
+		return nullptr;
+	}
+
+	/// @brief Parses one line without its line end
+	/// @return False if the line is not a valid entity, blank lines and comments are valid
+	bool ParseLine( const char *inFirst, const char *inLast, const std::vector<TextClass> &inClasses, LoadTask &ioTask )
+	{
+		if ( inFirst != inLast && inLast[-1] == '\r' ) --inLast;
+		if ( inFirst == inLast || *inFirst == '#' ) return true;
+
+		const char *nameEnd = std::find( inFirst, inLast, ' ' );
+		const std::string_view name( inFirst, nameEnd - inFirst );
+		const TextClass *textClass = FindClass( inClasses, entt::hashed_string::value( name.data(), name.size() ) );
+		if ( !textClass || textClass->mName != name || nameEnd == inLast ) return false;
+
+		std::underlying_type_t<entt::entity> identifier;
+		const char *entityEnd = std::find( nameEnd + 1, inLast, ' ' );
+		const auto [ptr, error] = std::from_chars( nameEnd + 1, entityEnd, identifier );
+		const entt::entity entity = static_cast<entt::entity>( identifier );
+		if ( error != std::errc{} || ptr != entityEnd || entity == entt::null ) return false;
+
+		uint32_t fieldMask = 0;
+		for ( const char *text = entityEnd; text != inLast; ) {
+			const char *fieldFirst = text + 1;
+			const char *fieldLast = std::find( fieldFirst, inLast, ' ' );
+			const char *equals = std::find( fieldFirst, fieldLast, '=' );
+			if ( equals == fieldLast ) return false;
+
+			const auto field = std::find( kFieldNames.begin(), kFieldNames.end(), std::string_view( fieldFirst, equals - fieldFirst ) );
+			if ( field == kFieldNames.end() ) return false;
+
+			// Each field of the class exactly once, a field of another class is rejected as well
+			const uint32_t fieldBit = 1u << ( field - kFieldNames.begin() );
+			if ( !( textClass->mFieldMask & fieldBit ) || ( fieldMask & fieldBit ) ) return false;
+			fieldMask |= fieldBit;
+
+			if ( !kReadField[field - kFieldNames.begin()]( equals + 1, fieldLast, entity, ioTask.mColumns ) ) return false;
+			text = fieldLast;
+		}
+		if ( fieldMask != textClass->mFieldMask ) return false;
+
+		ioTask.mEntities.push_back( entity );
+		ioTask.mTypes.push_back( static_cast<Cyclone::Core::Component::EntityType>( textClass->mType ) );
+		return true;
+	}
+
+	void ParseTask( const std::vector<TextClass> &inClasses, LoadTask &ioTask )
+	{
+		for ( const char *line = ioTask.mFirst; line != ioTask.mLast; ) {
+			const char *lineEnd = std::find( line, ioTask.mLast, '\n' );
+			if ( !ParseLine( line, lineEnd, inClasses, ioTask ) ) {
+				ioTask.mValid = false;
+				return;
+			}
+			line = lineEnd == ioTask.mLast ? lineEnd : lineEnd + 1;
+		}
+	}
+}
+
+bool Cyclone::Core::Serialization::LevelText::sSave( const entt::registry &inRegistry, const entt::meta_ctx &inMetaContext, const std::filesystem::path &inPath, bool inAllowParallel )
+{
+	std::vector<TextClass> classes;
+	if ( !GatherClasses( inMetaContext, classes ) ) return false;
+
+	// Sorted so the same level always gives the same text
+	const auto *types = inRegistry.storage<Component::EntityType>();
+	std::vector<entt::entity> entities;
+	LevelFile::sGatherEntities( inRegistry, entities );
+
+	const bool parallel = inAllowParallel && entities.size() > kSaveTaskEntities;
+	if ( parallel ) {
+		std::sort( std::execution::par, entities.begin(), entities.end() );
+	}
+	else {
+		std::sort( entities.begin(), entities.end() );
+	}
+
+	std::array<const entt::sparse_set *, text_components::size> storages;
+	for ( size_t field = 0; field < text_components::size; ++field ) {
+		storages[field] = inRegistry.storage( kFieldIds[field] );
+	}
+
+	size_t maxLineChars = 0;
+	for ( const TextClass &textClass : classes ) {
+		maxLineChars = std::max( maxLineChars, textClass.mMaxLineChars );
+	}
+
+	std::vector<SaveTask> tasks;
+	for ( size_t begin = 0; begin < entities.size(); begin += kSaveTaskEntities ) {
+		tasks.push_back( { begin, std::min( begin + kSaveTaskEntities, entities.size() ) } );
+	}
+
+	Cyclone::Util::ForEachTask( tasks, parallel, [&]( SaveTask &ioTask ) {
+		ioTask.mText.resize( ( ioTask.mEnd - ioTask.mBegin ) * maxLineChars );
+
+		char *text = ioTask.mText.data();
+		const TextClass *textClass = nullptr;
+		for ( size_t row = ioTask.mBegin; row < ioTask.mEnd; ++row ) {
+			const entt::entity entity = entities[row];
+			const entt::id_type type = static_cast<entt::id_type>( types->get( entity ) );
+			if ( !textClass || textClass->mType != type ) textClass = FindClass( classes, type );
+			if ( !textClass ) {
+				ioTask.mValid = false;
+				return;
+			}
+
+			text = std::copy( textClass->mName.begin(), textClass->mName.end(), text );
+			*text++ = ' ';
+			text = std::to_chars( text, text + kMaxEntityChars, static_cast<std::underlying_type_t<entt::entity>>( entity ) ).ptr;
+
+			for ( const size_t field : textClass->mFields ) {
+				if ( !storages[field] || !storages[field]->contains( entity ) ) {
+					ioTask.mValid = false;
+					return;
+				}
+
+				*text++ = ' ';
+				text = std::copy( kFieldNames[field].begin(), kFieldNames[field].end(), text );
+				*text++ = '=';
+				text = kWriteField[field]( *storages[field], entity, text );
+			}
+			*text++ = '\n';
+		}
+		ioTask.mText.resize( text - ioTask.mText.data() );
+	} );
+
+	size_t fileSize = kHeader.size() + 1;
+	for ( const SaveTask &task : tasks ) {
+		if ( !task.mValid ) return false;
+		fileSize += task.mText.size();
+	}
+
+	return Cyclone::Util::MappedFile::sReplace( inPath, [&]( const std::filesystem::path &inTemporaryPath ) {
+		return Cyclone::Util::MappedFile::sWrite( inTemporaryPath, fileSize, [&tasks]( std::byte *outData ) {
+			char *text = reinterpret_cast<char *>( outData );
+			text = std::copy( kHeader.begin(), kHeader.end(), text );
+			*text++ = '\n';
+			for ( const SaveTask &task : tasks ) {
+				text = std::copy( task.mText.begin(), task.mText.end(), text );
+			}
+		} );
+	} );
+}
+
+bool Cyclone::Core::Serialization::LevelText::sLoad( const std::filesystem::path &inPath, const entt::meta_ctx &inMetaContext, entt::registry &ioRegistry, bool inAllowParallel )
+{
+	assert( ioRegistry.storage<entt::entity>().empty() && "Levels can only be loaded into an empty registry!" );
+
+	std::vector<TextClass> classes;
+	if ( !GatherClasses( inMetaContext, classes ) ) return false;
+
+	Cyclone::Util::MappedFile file;
+	if ( !file.Open( inPath, Cyclone::Util::MappedFile::EMode::Read ) ) return false;
+
+	const char *first = reinterpret_cast<const char *>( file.GetData() );
+	const char *last = first + file.GetSize();
+
+	const char *headerEnd = std::find( first, last, '\n' );
+	std::string_view header( first, headerEnd - first );
+	if ( !header.empty() && header.back() == '\r' ) header.remove_suffix( 1 );
+	if ( header != kHeader ) return false;
+	first = headerEnd == last ? last : headerEnd + 1;
+
+	// Every task starts at a line and ends after the line end closest past its share of the text
+	const size_t taskCount = std::max<size_t>( static_cast<size_t>( last - first ) / kLoadTaskBytes, 1 );
+	std::vector<LoadTask> tasks;
+	for ( const char *taskFirst = first; taskFirst != last; ) {
+		const char *split = std::min( last, taskFirst + std::max<size_t>( static_cast<size_t>( last - first ) / taskCount, 1 ) );
+		const char *taskLast = split == last ? last : std::find( split - 1, last, '\n' );
+		if ( taskLast != last ) ++taskLast;
+
+		tasks.emplace_back().mFirst = taskFirst;
+		tasks.back().mLast = taskLast;
+		taskFirst = taskLast;
+	}
+
+	Cyclone::Util::ForEachTask( tasks, inAllowParallel && tasks.size() > 1, [&classes]( LoadTask &ioTask ) { ParseTask( classes, ioTask ); } );
+
+	std::vector<entt::entity> entities;
+	for ( const LoadTask &task : tasks ) {
+		if ( !task.mValid ) return false;
+		entities.insert( entities.end(), task.mEntities.begin(), task.mEntities.end() );
+	}
+
+	if ( inAllowParallel && tasks.size() > 1 ) {
+		std::sort( std::execution::par, entities.begin(), entities.end() );
+	}
+	else {
+		std::sort( entities.begin(), entities.end() );
+	}
+	if ( std::adjacent_find( entities.begin(), entities.end() ) != entities.end() ) return false;
+
+	LevelFile::sCreateEntities( entities, ioRegistry );
+	for ( const LoadTask &task : tasks ) {
+		ioRegistry.storage<Component::EntityType>().insert( task.mEntities.begin(), task.mEntities.end(), task.mTypes.begin() );
+		task.mColumns.Insert( ioRegistry );
+	}
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+// Cyclone serialization
+#include "Cyclone/Core/Serialization/LevelFile.hpp"
+
+// STL
+#include <string_view>
+
+namespace Cyclone::Core::Serialization
+{
+	/// @brief Text level format for diffing and for tools outside the editor, one entity per line
+	/// @note A line holds the entity class, the entity and then one field per component of the class, in the order of level_components
+	///       point_debug 42 category=414084241 visible=1 selectable=1 position=16,0,16 bounds=0,0,0;0.25,0.25,0.25,0.25
+	/// @note Entity classes and their components are found through the meta context filled by Entity::BaseEntity::sRegister(), each value is converted by its TextCodec
+	/// @note Numbers are written with std::to_chars in their shortest exact form, so a level reads back unchanged
+	/// @note Blank lines and lines starting with # are skipped when loading
+	class LevelText
+	{
+	public:
+		static constexpr std::string_view kHeader = "cyclone_level_text 1";
+		static constexpr const char *kExtension = ".cyt";
+		static constexpr size_t kSaveTaskEntities = 16384;	///< Lines written by one worker
+		static constexpr size_t kLoadTaskBytes = 1 << 20;	///< Text parsed by one worker, extended to the end of its last line
+
+		/// @brief Writes every entity of an entity class, fails if an entity lacks a component of its class
+		/// @note Written next to inPath first and then moved over it, so a failed save never damages the previous file
+		static bool				sSave( const entt::registry &inRegistry, const entt::meta_ctx &inMetaContext, const std::filesystem::path &inPath, bool inAllowParallel = true );
+
+		/// @brief Loads a text level into an empty registry, nothing is created unless every line is valid
+		/// @note The file is split at line ends and each part is parsed by its own worker straight from the mapped file
+		static bool				sLoad( const std::filesystem::path &inPath, const entt::meta_ctx &inMetaContext, entt::registry &ioRegistry, bool inAllowParallel = true );
+	};
+}
\ No newline at end of file
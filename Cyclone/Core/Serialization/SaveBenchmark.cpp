@@ -0,0 +1,87 @@
+#include "pch.h"
+#include "Cyclone/Core/Serialization/SaveBenchmark.hpp"
+
+// Cyclone utils
+#include "Cyclone/Util/MappedFile.hpp"
+#include "Cyclone/Util/Benchmark.hpp"
+
+// Cyclone entities
+#include "Cyclone/Core/Entity/EntityClasses.hpp"
+
+// Cyclone serialization
+#include "Cyclone/Core/Serialization/LevelFile.hpp"
+
+// STL
+#include <chrono>
+#include <thread>
+
+namespace
+{
+	double TimeSave( const entt::registry &inRegistry, const std::filesystem::path &inPath, bool inAllowParallel )
+	{
+		const auto start = std::chrono::steady_clock::now();
+		if ( !Cyclone::Core::Serialization::LevelFile::sSave( inRegistry, inPath, inAllowParallel, true ) ) return std::numeric_limits<double>::max();
+		return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+	}
+
+	double TimeLoad( const std::filesystem::path &inPath, entt::registry &outRegistry )
+	{
+		const auto start = std::chrono::steady_clock::now();
+		if ( !Cyclone::Core::Serialization::LevelFile::sLoad( inPath, outRegistry ) ) return std::numeric_limits<double>::max();
+		return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+	}
+
+	bool CompareFiles( const std::filesystem::path &inLhs, const std::filesystem::path &inRhs )
+	{
+		Cyclone::Util::MappedFile lhs;
+		Cyclone::Util::MappedFile rhs;
+		if ( !lhs.Open( inLhs, Cyclone::Util::MappedFile::EMode::Read ) || !rhs.Open( inRhs, Cyclone::Util::MappedFile::EMode::Read ) ) return false;
+
+		return lhs.GetSize() == rhs.GetSize() && std::memcmp( lhs.GetData(), rhs.GetData(), lhs.GetSize() ) == 0;
+	}
+}
+
+Cyclone::Core::Serialization::SaveBenchmarkResult Cyclone::Core::Serialization::RunSaveBenchmark( size_t inEntityCount )
+{
+	SaveBenchmarkResult result;
+	result.mEntityCount = inEntityCount;
+	result.mThreadCount = std::thread::hardware_concurrency();
+
+	const Entity::EntityClassFunctions *pointClass = Entity::FindEntityClass( Entity::PointDebug::kEntityType.value() );
+	const Entity::EntityClassFunctions *infoClass = Entity::FindEntityClass( Entity::InfoDebug::kEntityType.value() );
+
+	// Mixed classes and some hidden entities, so the tag storages differ from the entity section
+	entt::registry level;
+	for ( size_t i = 0; i < inEntityCount; ++i ) {
+		const Entity::EntityClassFunctions *entityClass = i % 4 == 0 ? infoClass : pointClass;
+		const entt::entity entity = entityClass->mCreateEntity( level, { double( i % 1024 ) * 2.0, 0.0, double( i / 1024 ) * 2.0 } );
+		if ( i % 7 == 0 ) level.replace<Component::Visible>( entity, static_cast<Component::Visible>( false ) );
+	}
+
+	const std::filesystem::path directory = std::filesystem::temp_directory_path();
+	const std::filesystem::path serialPath = directory / "CycloneSaveBenchmarkSerial.cyl";
+	const std::filesystem::path parallelPath = directory / "CycloneSaveBenchmarkParallel.cyl";
+	const std::filesystem::path uncompressedPath = directory / "CycloneSaveBenchmarkUncompressed.cyl";
+
+	Cyclone::Util::TimeSerialAndParallel( [&]( bool inParallel ) {
+		return TimeSave( level, inParallel ? parallelPath : serialPath, inParallel );
+	}, result.mSerialMilliseconds, result.mParallelMilliseconds );
+
+	// Both loads land in fresh registries, so their storages are compared value by value
+	entt::registry compressedLevel;
+	entt::registry uncompressedLevel;
+	const bool savedUncompressed = Cyclone::Core::Serialization::LevelFile::sSave( level, uncompressedPath, true, false );
+	result.mLoadMilliseconds = TimeLoad( parallelPath, compressedLevel );
+	result.mUncompressedLoadMilliseconds = TimeLoad( uncompressedPath, uncompressedLevel );
+
+	std::error_code error;
+	result.mFileBytes = static_cast<size_t>( std::filesystem::file_size( parallelPath, error ) );
+	result.mUncompressedFileBytes = static_cast<size_t>( std::filesystem::file_size( uncompressedPath, error ) );
+	result.mResultsMatch = savedUncompressed && CompareFiles( serialPath, parallelPath ) && Cyclone::Util::RegistriesMatch<level_components>( compressedLevel, uncompressedLevel );
+
+	std::filesystem::remove( serialPath, error );
+	std::filesystem::remove( parallelPath, error );
+	std::filesystem::remove( uncompressedPath, error );
+
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+namespace Cyclone::Core::Serialization
+{
+	struct SaveBenchmarkResult
+	{
+		size_t					mEntityCount = 0;
+		unsigned				mThreadCount = 0;
+		double					mSerialMilliseconds = 0.0;
+		double					mParallelMilliseconds = 0.0;
+		size_t					mFileBytes = 0;
+		size_t					mUncompressedFileBytes = 0;
+		double					mLoadMilliseconds = 0.0;
+		double					mUncompressedLoadMilliseconds = 0.0;
+		bool					mResultsMatch = false;	///< Both saves wrote the same bytes, and both files load the same level
+	};
+
+	/// @brief Times saving a synthetic level of inEntityCount entities compressed, once serially and once on the thread pool
+	/// @note Also saves it uncompressed, as levels are saved by default, and times loading both files
+	/// @note Writes to the temporary directory, the open level is left untouched
+	SaveBenchmarkResult RunSaveBenchmark( size_t inEntityCount );
+}
\ No newline at end of file
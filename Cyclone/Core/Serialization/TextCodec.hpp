@@ -0,0 +1,172 @@
+#pragma once
+
+// Cyclone components
+#include "Cyclone/Core/Component/Position.hpp"
+#include "Cyclone/Core/Component/BoundingBox.hpp"
+#include "Cyclone/Core/Component/EntityCategory.hpp"
+#include "Cyclone/Core/Component/Visible.hpp"
+#include "Cyclone/Core/Component/Selectable.hpp"
+
+// STL
+#include <bit>
+#include <charconv>
+#include <optional>
+#include <string_view>
+
+namespace Cyclone::Core::Serialization
+{
+	/// @brief Converts a component to and from the value of its field in a text level
+	/// @note sWrite() writes at most kMaxChars, sRead() must consume the whole value and returns nothing for anything else
+	template<typename T>
+	struct TextCodec;
+
+	namespace TextCodecDetail
+	{
+		/// Longest shortest round trip form of a double, such as -2.2250738585072014e-308
+		inline constexpr size_t kMaxDoubleChars = 24;
+		inline constexpr size_t kMaxVectorChars = 4 * kMaxDoubleChars + 3;
+
+		inline char *WriteDouble( char *outText, double inValue )
+		{
+			return std::to_chars( outText, outText + kMaxDoubleChars, inValue ).ptr;
+		}
+
+		inline const char *ReadDouble( const char *inFirst, const char *inLast, double &outValue )
+		{
+			const auto [ptr, error] = std::from_chars( inFirst, inLast, outValue );
+			return error == std::errc{} ? ptr : nullptr;
+		}
+
+		/// Written as x,y,z and a fourth value only if w is not zero
+		inline char *WriteVector( char *outText, Cyclone::Math::Vector4D inValue )
+		{
+			outText = WriteDouble( outText, inValue.GetX() );
+			*outText++ = ',';
+			outText = WriteDouble( outText, inValue.GetY() );
+			*outText++ = ',';
+			outText = WriteDouble( outText, inValue.GetZ() );
+			if ( std::bit_cast<uint64_t>( inValue.GetW() ) != 0 ) {
+				*outText++ = ',';
+				outText = WriteDouble( outText, inValue.GetW() );
+			}
+			return outText;
+		}
+
+		inline const char *ReadVector( const char *inFirst, const char *inLast, Cyclone::Math::Vector4D &outValue )
+		{
+			// A missing w is zero, as written by WriteVector()
+			std::array<double, 4> values{};
+			const char *text = inFirst;
+			for ( size_t index = 0; index < values.size(); ++index ) {
+				if ( index != 0 ) {
+					if ( text == inLast || *text != ',' ) {
+						if ( index < 3 ) return nullptr;
+						break;
+					}
+					++text;
+				}
+				text = ReadDouble( text, inLast, values[index] );
+				if ( !text ) return nullptr;
+			}
+			outValue = Cyclone::Math::Vector4D( values[0], values[1], values[2], values[3] );
+			return text;
+		}
+
+		template<typename T>
+		char *WriteInteger( char *outText, T inValue )
+		{
+			return std::to_chars( outText, outText + std::numeric_limits<T>::digits10 + 1, inValue ).ptr;
+		}
+
+		template<typename T>
+		std::optional<T> ReadInteger( const char *inFirst, const char *inLast )
+		{
+			T value;
+			const auto [ptr, error] = std::from_chars( inFirst, inLast, value );
+			if ( error != std::errc{} || ptr != inLast ) return std::nullopt;
+			return value;
+		}
+
+		template<typename T>
+		std::optional<T> ReadFlag( const char *inFirst, const char *inLast )
+		{
+			if ( inLast - inFirst != 1 || ( *inFirst != '0' && *inFirst != '1' ) ) return std::nullopt;
+			return static_cast<T>( *inFirst == '1' );
+		}
+	}
+
+	template<>
+	struct TextCodec<Component::EntityCategory>
+	{
+		static constexpr std::string_view kName = "category";
+		static constexpr size_t kMaxChars = 10;
+
+		static char *			sWrite( char *outText, Component::EntityCategory inValue )	{ return TextCodecDetail::WriteInteger( outText, static_cast<entt::id_type>( inValue ) ); }
+		static std::optional<Component::EntityCategory> sRead( const char *inFirst, const char *inLast )
+		{
+			const std::optional<entt::id_type> value = TextCodecDetail::ReadInteger<entt::id_type>( inFirst, inLast );
+			if ( !value ) return std::nullopt;
+			return static_cast<Component::EntityCategory>( *value );
+		}
+	};
+
+	template<>
+	struct TextCodec<Component::Visible>
+	{
+		static constexpr std::string_view kName = "visible";
+		static constexpr size_t kMaxChars = 1;
+
+		static char *			sWrite( char *outText, Component::Visible inValue )	{ *outText = static_cast<bool>( inValue ) ? '1' : '0'; return outText + 1; }
+		static std::optional<Component::Visible> sRead( const char *inFirst, const char *inLast )	{ return TextCodecDetail::ReadFlag<Component::Visible>( inFirst, inLast ); }
+	};
+
+	template<>
+	struct TextCodec<Component::Selectable>
+	{
+		static constexpr std::string_view kName = "selectable";
+		static constexpr size_t kMaxChars = 1;
+
+		static char *			sWrite( char *outText, Component::Selectable inValue )	{ *outText = static_cast<bool>( inValue ) ? '1' : '0'; return outText + 1; }
+		static std::optional<Component::Selectable> sRead( const char *inFirst, const char *inLast )	{ return TextCodecDetail::ReadFlag<Component::Selectable>( inFirst, inLast ); }
+	};
+
+	template<>
+	struct TextCodec<Component::Position>
+	{
+		static constexpr std::string_view kName = "position";
+		static constexpr size_t kMaxChars = TextCodecDetail::kMaxVectorChars;
+
+		static char *			sWrite( char *outText, const Component::Position &inValue )	{ return TextCodecDetail::WriteVector( outText, inValue.mValue ); }
+		static std::optional<Component::Position> sRead( const char *inFirst, const char *inLast )
+		{
+			Cyclone::Math::Vector4D value = Cyclone::Math::Vector4D::sZero();
+			if ( TextCodecDetail::ReadVector( inFirst, inLast, value ) != inLast ) return std::nullopt;
+			return Component::Position{ value };
+		}
+	};
+
+	/// Written as the center and the extent separated by a semicolon
+	template<>
+	struct TextCodec<Component::BoundingBox>
+	{
+		static constexpr std::string_view kName = "bounds";
+		static constexpr size_t kMaxChars = 2 * TextCodecDetail::kMaxVectorChars + 1;
+
+		static char *			sWrite( char *outText, const Component::BoundingBox &inValue )
+		{
+			outText = TextCodecDetail::WriteVector( outText, inValue.mValue.mCenter );
+			*outText++ = ';';
+			return TextCodecDetail::WriteVector( outText, inValue.mValue.mExtent );
+		}
+
+		static std::optional<Component::BoundingBox> sRead( const char *inFirst, const char *inLast )
+		{
+			Cyclone::Math::Vector4D center = Cyclone::Math::Vector4D::sZero();
+			Cyclone::Math::Vector4D extent = Cyclone::Math::Vector4D::sZero();
+			const char *text = TextCodecDetail::ReadVector( inFirst, inLast, center );
+			if ( !text || text == inLast || *text != ';' ) return std::nullopt;
+			if ( TextCodecDetail::ReadVector( text + 1, inLast, extent ) != inLast ) return std::nullopt;
+			return Component::BoundingBox{ { center, extent } };
+		}
+	};
+}
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "Cyclone/Core/LevelInterface.hpp"
 #include "Cyclone/Core/Component/Visible.hpp"
 #include "Cyclone/Core/Component/Selectable.hpp"
+#include "Cyclone/Core/Entity/EntityClasses.hpp"
 
 // Cyclone UI includes
 #include "Cyclone/UI/ViewportManager.hpp"
@@ -15,9 +16,48 @@
 #include <imgui.h>
 #include <imgui_internal.h>
 
+// Windows
+#include <commdlg.h>
+
 // STL
+#include <chrono>
 #include <format>
 
+/// Level file formats the file dialog filters by, in the order of its filter and extension tables
+enum class ELevelFileType
+{
+	Level,
+	Text,
+	Baked,
+};
+
+/// @brief Asks for a level file with the common file dialog
+/// @param inType Format of the level file asked for
+/// @return Empty if the dialog was cancelled
+static std::filesystem::path ShowLevelFileDialog( bool inSave, ELevelFileType inType = ELevelFileType::Level )
+{
+	static constexpr const wchar_t *kFilters[] = {
+		L"Cyclone Level (*.cyl)\0*.cyl\0All Files (*.*)\0*.*\0",
+		L"Cyclone Text Level (*.cyt)\0*.cyt\0All Files (*.*)\0*.*\0",
+		L"Cyclone Baked Level (*.cyb)\0*.cyb\0All Files (*.*)\0*.*\0",
+	};
+	static constexpr const wchar_t *kExtensions[] = { L"cyl", L"cyt", L"cyb" };
+
+	wchar_t fileName[MAX_PATH] = {};
+
+	OPENFILENAMEW dialog{};
+	dialog.lStructSize = sizeof( dialog );
+	dialog.hwndOwner = GetActiveWindow();
+	dialog.lpstrFilter = kFilters[static_cast<size_t>( inType )];
+	dialog.lpstrFile = fileName;
+	dialog.nMaxFile = MAX_PATH;
+	dialog.lpstrDefExt = kExtensions[static_cast<size_t>( inType )];
+	dialog.Flags = OFN_NOCHANGEDIR | ( inSave ? OFN_OVERWRITEPROMPT : OFN_FILEMUSTEXIST );
+
+	const BOOL accepted = inSave ? GetSaveFileNameW( &dialog ) : GetOpenFileNameW( &dialog );
+	return accepted ? std::filesystem::path( fileName ) : std::filesystem::path{};
+}
+
 Cyclone::UI::MainUI::MainUI() noexcept :
 	mVerticalSyncEnabled( true )
 {}
@@ -44,8 +84,77 @@ void Cyclone::UI::MainUI::Update( float inDeltaTime, Cyclone::Core::LevelInterfa
 
 	//ImGui::SetKeyOwner( ImGuiMod_Alt, 0, ImGuiInputFlags_None );
 
+	EFileCommand fileCommand = EFileCommand::None;
+	const bool canRunFileCommand = inLevelInterface->GetEntityCtx().CanAquireActionLock();
+
+	// The previous level stays in place when a streamed file cannot be read
+	using EStreamState = Cyclone::Core::Serialization::LevelStreamer::EState;
+	const Cyclone::Core::Serialization::LevelStreamer &levelStreamer = inLevelInterface->GetLevelStreamer();
+	if ( levelStreamer.GetState() == EStreamState::Failed ) {
+		mFileError = std::format( "Failed to open {}", levelStreamer.GetPath().filename().string() );
+		inLevelInterface->CancelLevelStream();
+	}
+	const bool canSave = canRunFileCommand && levelStreamer.GetState() != EStreamState::Streaming;
+
 	if ( ImGui::BeginMainMenuBar() ) {
 		if ( ImGui::BeginMenu( "File" ) ) {
+			if ( ImGui::MenuItem( "New", "Ctrl+N", false, canRunFileCommand ) ) fileCommand = EFileCommand::New;
+			if ( ImGui::MenuItem( "Open...", "Ctrl+O", false, canRunFileCommand ) ) fileCommand = EFileCommand::Open;
+			if ( ImGui::BeginMenu( "Open Partial", canRunFileCommand ) ) {
+				// No entity type ticked loads every entity type
+				for ( const Cyclone::Core::Entity::EntityClassFunctions &entityClass : Cyclone::Core::Entity::kEntityClassTable ) {
+					const char *name = inLevelInterface->GetEntityCtx().GetEntityTypeName( Cyclone::Core::Component::EntityType{ entityClass.mEntityType } );
+					std::vector<entt::id_type> &entityTypes = mPartialFilter.mEntityTypes;
+					const auto it = std::find( entityTypes.begin(), entityTypes.end(), entityClass.mEntityType );
+					bool isLoaded = it != entityTypes.end();
+					if ( ImGui::Checkbox( name ? name : "Unnamed", &isLoaded ) ) {
+						if ( isLoaded ) entityTypes.push_back( entityClass.mEntityType );
+						else entityTypes.erase( it );
+					}
+				}
+
+				ImGui::Separator();
+
+				ImGui::Checkbox( "Region", &mPartialRegionEnabled );
+				ImGui::BeginDisabled( !mPartialRegionEnabled );
+				ImGui::InputScalarN( "Min", ImGuiDataType_Double, mPartialRegionMin.data(), 3 );
+				ImGui::InputScalarN( "Max", ImGuiDataType_Double, mPartialRegionMax.data(), 3 );
+				ImGui::EndDisabled();
+
+				ImGui::Separator();
+
+				if ( ImGui::MenuItem( "Open..." ) ) fileCommand = EFileCommand::OpenPartial;
+				ImGui::EndMenu();
+			}
+
+			ImGui::Separator();
+
+			if ( ImGui::MenuItem( "Save", "Ctrl+S", false, canSave ) ) fileCommand = EFileCommand::Save;
+			if ( ImGui::MenuItem( "Save As...", "Ctrl+Shift+S", false, canSave ) ) fileCommand = EFileCommand::SaveAs;
+
+			ImGui::Separator();
+
+			if ( ImGui::MenuItem( "Import Text...", nullptr, false, canRunFileCommand ) ) fileCommand = EFileCommand::ImportText;
+			if ( ImGui::MenuItem( "Export Text...", nullptr, false, canSave ) ) fileCommand = EFileCommand::ExportText;
+			if ( ImGui::MenuItem( "Bake...", nullptr, false, canSave ) ) fileCommand = EFileCommand::Bake;
+
+			ImGui::Separator();
+
+			if ( ImGui::MenuItem( "Compare With Saved", nullptr, false, canSave && !inLevelInterface->GetLevelPath().empty() ) ) {
+				const auto start = std::chrono::steady_clock::now();
+				if ( inLevelInterface->DiffLevelAgainstSave( mLevelDiff ) ) {
+					mLevelDiffMilliseconds = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+				}
+				else {
+					mLevelDiffMilliseconds = -1.0;
+					mFileError = std::format( "Failed to read {}", inLevelInterface->GetLevelPath().filename().string() );
+				}
+			}
+
+			if ( mLevelDiffMilliseconds >= 0.0 ) {
+				ImGui::TextDisabled( "%zu added, %zu removed, %zu modified (%.2f ms)", mLevelDiff.mAdded.size(), mLevelDiff.mRemoved.size(), mLevelDiff.mModified.size(), mLevelDiffMilliseconds );
+			}
+
 			ImGui::EndMenu();
 		}
 
@@ -58,11 +167,78 @@ void Cyclone::UI::MainUI::Update( float inDeltaTime, Cyclone::Core::LevelInterfa
 		if ( ImGui::BeginMenu( "Debug" ) ) {
 			ImGui::MenuItem( "Show Demo Menu", nullptr, &showDemoMenu );
 
+			ImGui::Separator();
+
+			auto &entityContext = inLevelInterface->GetEntityCtx();
+			constexpr size_t kMiB = 1024 * 1024;
+
+			int undoBudgetMiB = static_cast<int>( entityContext.GetUndoMemoryBudget() / kMiB );
+			if ( ImGui::InputInt( "Undo Budget (MiB)", &undoBudgetMiB, 64, 256, ImGuiInputTextFlags_EnterReturnsTrue ) ) {
+				entityContext.SetUndoMemoryBudget( static_cast<size_t>( std::max( undoBudgetMiB, 0 ) ) * kMiB );
+			}
+
+			ImGui::TextDisabled( "Undo resident %.1f MiB, spilled %.1f MiB", static_cast<double>( entityContext.GetUndoMemoryUsage() ) / kMiB, static_cast<double>( entityContext.GetUndoJournalSize() ) / kMiB );
+
+			ImGui::Separator();
+
+			if ( ImGui::MenuItem( "Benchmark Undo Apply (200k)" ) ) {
+				mApplyBenchmark = Cyclone::Core::History::RunApplyBenchmark( 200000 );
+			}
+
+			if ( mApplyBenchmark.mEntityCount != 0 ) {
+				ImGui::TextDisabled( "Serial %.2f ms, parallel %.2f ms on %u threads (%.1fx)%s", mApplyBenchmark.mSerialMilliseconds, mApplyBenchmark.mParallelMilliseconds, mApplyBenchmark.mThreadCount,
+					mApplyBenchmark.mSerialMilliseconds / std::max( mApplyBenchmark.mParallelMilliseconds, 1e-6 ), mApplyBenchmark.mResultsMatch ? "" : ", MISMATCH" );
+			}
+
+			if ( ImGui::MenuItem( "Benchmark Level Save (1M)" ) ) {
+				mSaveBenchmark = Cyclone::Core::Serialization::RunSaveBenchmark( 1000000 );
+			}
+
+			if ( mSaveBenchmark.mEntityCount != 0 ) {
+				ImGui::TextDisabled( "Serial %.2f ms, parallel %.2f ms on %u threads (%.1fx), %.1f MiB%s", mSaveBenchmark.mSerialMilliseconds, mSaveBenchmark.mParallelMilliseconds, mSaveBenchmark.mThreadCount,
+					mSaveBenchmark.mSerialMilliseconds / std::max( mSaveBenchmark.mParallelMilliseconds, 1e-6 ), static_cast<double>( mSaveBenchmark.mFileBytes ) / kMiB, mSaveBenchmark.mResultsMatch ? "" : ", MISMATCH" );
+				ImGui::TextDisabled( "Load %.2f ms, uncompressed %.2f ms and %.1f MiB", mSaveBenchmark.mLoadMilliseconds, mSaveBenchmark.mUncompressedLoadMilliseconds, static_cast<double>( mSaveBenchmark.mUncompressedFileBytes ) / kMiB );
+			}
+
 			ImGui::EndMenu();
 		}
 
 		ImGui::Separator();
 
+		const std::filesystem::path &levelPath = inLevelInterface->GetLevelPath();
+		ImGui::TextDisabled( "%s", levelPath.empty() ? "Untitled" : reinterpret_cast<const char *>( levelPath.filename().u8string().c_str() ) );
+		if ( levelStreamer.GetState() == EStreamState::Loading ) {
+			ImGui::TextDisabled( "Reading %s", reinterpret_cast<const char *>( levelStreamer.GetPath().filename().u8string().c_str() ) );
+		}
+		else if ( levelStreamer.GetState() == EStreamState::Streaming ) {
+			ImGui::TextDisabled( "Loading %.0f%%", levelStreamer.GetProgress() * 100.0f );
+		}
+		if ( inLevelInterface->GetUnloadedEntityCount() != 0 ) {
+			ImGui::TextDisabled( "%zu entities not loaded", inLevelInterface->GetUnloadedEntityCount() );
+		}
+		if ( !mFileError.empty() ) ImGui::TextColored( { 1.0f, 0.4f, 0.4f, 1.0f }, "%s", mFileError.c_str() );
+
+		ImGui::Separator();
+
+		using EAutosaveState = Cyclone::Core::Serialization::LevelAutosave::EState;
+		const Cyclone::Core::Serialization::LevelAutosave &levelAutosave = inLevelInterface->GetLevelAutosave();
+		switch ( levelAutosave.GetState() ) {
+			case EAutosaveState::Idle:
+				break;
+			case EAutosaveState::Saving:
+				ImGui::TextDisabled( "Autosaving %.0f%%", levelAutosave.GetProgress() * 100.0f );
+				ImGui::Separator();
+				break;
+			case EAutosaveState::Saved:
+				ImGui::TextDisabled( "Autosaved in %.0f ms (%.1f ms copy)", levelAutosave.GetWriteMilliseconds(), levelAutosave.GetSnapshotMilliseconds() );
+				ImGui::Separator();
+				break;
+			case EAutosaveState::Failed:
+				ImGui::TextColored( { 1.0f, 0.4f, 0.4f, 1.0f }, "Autosave failed" );
+				ImGui::Separator();
+				break;
+		}
+
 		ImGui::TextDisabled( "%.0f FPS", ImGui::GetIO().Framerate );
 
 		ImGui::EndMainMenuBar();
@@ -130,18 +306,75 @@ void Cyclone::UI::MainUI::Update( float inDeltaTime, Cyclone::Core::LevelInterfa
 
 		if ( ImGui::IsKeyChordPressed( ImGuiKey_H | ImGuiMod_Ctrl ) ) {
 			entityContext.BeginAction();
-			auto view = inLevelInterface->GetRegistry().view<Cyclone::Core::Component::Visible>();
 			for ( entt::entity entity : inLevelInterface->GetSelectionCtx().GetSelectedEntities() ) {
-				view.get<Cyclone::Core::Component::Visible>( entity ) = static_cast<Cyclone::Core::Component::Visible>( false );
-				entityContext.UpdateEntity( entity, inLevelInterface->GetRegistry() );
+				inLevelInterface->GetRegistry().replace<Cyclone::Core::Component::Visible>( entity, static_cast<Cyclone::Core::Component::Visible>( false ) );
 			}
 			entityContext.EndAction();
 		}
+
+		if ( ImGui::IsKeyChordPressed( ImGuiKey_N | ImGuiMod_Ctrl ) ) fileCommand = EFileCommand::New;
+		if ( ImGui::IsKeyChordPressed( ImGuiKey_O | ImGuiMod_Ctrl ) ) fileCommand = EFileCommand::Open;
+		if ( canSave && ImGui::IsKeyChordPressed( ImGuiKey_S | ImGuiMod_Ctrl ) ) fileCommand = EFileCommand::Save;
+		if ( canSave && ImGui::IsKeyChordPressed( ImGuiKey_S | ImGuiMod_Ctrl | ImGuiMod_Shift ) ) fileCommand = EFileCommand::SaveAs;
 	}
 
+	// Runs after every other user of the level this frame, so nothing still refers to a replaced registry
+	if ( fileCommand != EFileCommand::None && canRunFileCommand ) RunFileCommand( fileCommand, inLevelInterface );
+
 	inLevelInterface->OnUpdateEnd();
 }
 
+void Cyclone::UI::MainUI::RunFileCommand( EFileCommand inCommand, Cyclone::Core::LevelInterface *inLevelInterface )
+{
+	mFileError.clear();
+
+	std::filesystem::path path;
+	switch ( inCommand ) {
+		case EFileCommand::New:
+			inLevelInterface->NewLevel();
+			return;
+		case EFileCommand::Open:
+			path = ShowLevelFileDialog( false );
+			if ( path.empty() ) return;
+			inLevelInterface->StreamLevel( path );
+			return;
+		case EFileCommand::OpenPartial:
+			path = ShowLevelFileDialog( false );
+			if ( path.empty() ) return;
+			mPartialFilter.mRegion.reset();
+			if ( mPartialRegionEnabled ) {
+				const Cyclone::Math::Vector4D regionMin( mPartialRegionMin[0], mPartialRegionMin[1], mPartialRegionMin[2] );
+				const Cyclone::Math::Vector4D regionMax( mPartialRegionMax[0], mPartialRegionMax[1], mPartialRegionMax[2] );
+				mPartialFilter.mRegion = Cyclone::Math::BoundingBox<Cyclone::Math::Vector4D>::sFromMinMax( regionMin, regionMax );
+			}
+			if ( !inLevelInterface->OpenLevelPartial( path, mPartialFilter ) ) mFileError = std::format( "Failed to open {}", path.filename().string() );
+			return;
+		case EFileCommand::Save:
+			path = inLevelInterface->GetLevelPath();
+			[[fallthrough]];
+		case EFileCommand::SaveAs:
+			if ( path.empty() ) path = ShowLevelFileDialog( true );
+			if ( path.empty() ) return;
+			if ( !inLevelInterface->SaveLevel( path ) ) mFileError = std::format( "Failed to save {}", path.filename().string() );
+			return;
+		case EFileCommand::ImportText:
+			path = ShowLevelFileDialog( false, ELevelFileType::Text );
+			if ( path.empty() ) return;
+			if ( !inLevelInterface->ImportLevelText( path ) ) mFileError = std::format( "Failed to import {}", path.filename().string() );
+			return;
+		case EFileCommand::ExportText:
+			path = ShowLevelFileDialog( true, ELevelFileType::Text );
+			if ( path.empty() ) return;
+			if ( !inLevelInterface->ExportLevelText( path ) ) mFileError = std::format( "Failed to export {}", path.filename().string() );
+			return;
+		case EFileCommand::Bake:
+			path = ShowLevelFileDialog( true, ELevelFileType::Baked );
+			if ( path.empty() ) return;
+			if ( !inLevelInterface->BakeLevel( path ) ) mFileError = std::format( "Failed to bake {}", path.filename().string() );
+			return;
+	}
+}
+
 void Cyclone::UI::MainUI::Render( ID3D11DeviceContext3 *inDeviceContext, const Cyclone::Core::LevelInterface *inLevelInterface )
 {
 	if ( ImGui::GetFrameCount() <= 1 ) return;
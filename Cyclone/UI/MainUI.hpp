@@ -3,12 +3,35 @@
 // Cyclone utils
 #include "Cyclone/Util/NonCopyable.hpp"
 
+// Cyclone core
+#include "Cyclone/Core/LevelDiff.hpp"
+
+// Cyclone history
+#include "Cyclone/Core/History/ApplyBenchmark.hpp"
+
+// Cyclone serialization
+#include "Cyclone/Core/Serialization/SaveBenchmark.hpp"
+#include "Cyclone/Core/Serialization/LevelFile.hpp"
+
 namespace Cyclone::Core {
 	class LevelInterface;
 }
 
 namespace Cyclone::UI
 {
+	enum class EFileCommand
+	{
+		None,
+		New,
+		Open,
+		Save,
+		SaveAs,
+		ImportText,
+		ExportText,
+		Bake,
+		OpenPartial,
+	};
+
 	class ViewportManager;
 	class Outliner;
 	class Toolbar;
@@ -36,8 +59,24 @@ namespace Cyclone::UI
 		bool IsVerticalSyncEnabled() const noexcept { return mVerticalSyncEnabled; }
 
 	protected:
+		/// @brief Runs a command of the File menu or its shortcut, the file dialogs block until they are closed
+		void RunFileCommand( EFileCommand inCommand, Cyclone::Core::LevelInterface *inLevelInterface );
+
 		bool mVerticalSyncEnabled;
 
+		std::string mFileError;	///< Shown in the menu bar until the next file command
+
+		Cyclone::Core::Serialization::LevelFilter mPartialFilter;	///< Parts of a level loaded by Open Partial, its region is set from the fields below
+		bool mPartialRegionEnabled = false;
+		std::array<double, 3> mPartialRegionMin{ -1024.0, -1024.0, -1024.0 };
+		std::array<double, 3> mPartialRegionMax{ 1024.0, 1024.0, 1024.0 };
+
+		Cyclone::Core::History::ApplyBenchmarkResult mApplyBenchmark;
+		Cyclone::Core::Serialization::SaveBenchmarkResult mSaveBenchmark;
+
+		Cyclone::Core::LevelDiff::Result mLevelDiff;
+		double mLevelDiffMilliseconds = -1.0;	///< Negative until the level was compared with its file
+
 		std::unique_ptr<Cyclone::UI::ViewportManager> mViewportManager;
 		std::unique_ptr<Cyclone::UI::Outliner> mOutliner;
 		std::unique_ptr<Cyclone::UI::Toolbar> mToolbar;
@@ -38,9 +38,8 @@ namespace
 	void UpdateBoolPerPredicate( entt::registry &inRegistry, Cyclone::Core::EntityContext &inEntityContext, P inPredicate, bool inSet )
 	{
 		inEntityContext.BeginAction();
-		for ( auto [entity, type, tag] : inRegistry.view<const P, T>().each() ) {
-			if ( inPredicate == type ) tag = static_cast<T>( inSet );
-			inEntityContext.UpdateEntity( entity, inRegistry );
+		for ( auto [entity, type, tag] : inRegistry.view<const P, const T>().each() ) {
+			if ( inPredicate == type && tag != static_cast<T>( inSet ) ) inRegistry.replace<T>( entity, static_cast<T>( inSet ) );
 		}
 		inEntityContext.EndAction();
 	}
@@ -62,10 +61,11 @@ namespace
 
 	void UpdateBoolPerEntity( entt::registry &inRegistry, Cyclone::Core::EntityContext &inEntityContext, Cyclone::Core::Tool::SelectionToolContext &inSelectionContext, entt::entity inEntity, auto &ioTag )
 	{
+		using T = std::remove_cvref_t<decltype( ioTag )>;
+
 		inEntityContext.BeginAction();
-		*reinterpret_cast<bool *>( &ioTag ) ^= true;
+		inRegistry.replace<T>( inEntity, static_cast<T>( !static_cast<bool>( ioTag ) ) );
 		inSelectionContext.DeselectEntity( inEntity );
-		inEntityContext.UpdateEntity( inEntity, inRegistry );
 		inEntityContext.EndAction();
 	}
 }
@@ -131,6 +131,13 @@ void Cyclone::UI::Outliner::Update( Cyclone::Core::LevelInterface *inLevelInterf
 										if ( entityCategory == category ) selectionContext.DeselectEntity( entity );
 									}
 								};
+								if ( ImGui::Selectable( "Show only this category" ) ) {
+									entityContext.BeginAction();
+									for ( const auto &[otherCategory, otherTypeMap] : mOutlinerTree ) {
+										entityContext.SetEntityCategoryIsVisible( otherCategory, otherCategory == entityCategory );
+									}
+									entityContext.EndAction();
+								}
 								ImGui::Separator();
 								if ( ImGui::Selectable( "Set all children Visible" ) ) UpdateBoolPerPredicate<Cyclone::Core::Component::Visible>( registry, entityContext, entityCategory, true );
 								if ( ImGui::Selectable( "Set all children Hidden" ) ) UpdateBoolPerPredicate<Cyclone::Core::Component::Visible>( registry, entityContext, entityCategory, false );
@@ -329,12 +336,16 @@ void Cyclone::UI::Outliner::Update( Cyclone::Core::LevelInterface *inLevelInterf
 			auto view = registry.view<Cyclone::Core::Component::EntityType, Cyclone::Core::Component::Visible, Cyclone::Core::Component::Selectable>();
 			ImGui::SetNextWindowSizeConstraints( { ImGui::GetContentRegionAvail().x, 32.0f }, { ImGui::GetContentRegionAvail().x, mUndoHistoryHeight + mRemainingHeight } );
 			if ( ImGui::BeginChild( "UndoHistoryChild", { 0.0f, 256.0f }, sectionChildFlags, sectionWindowFlags ) ) {
-				if ( ImGui::BeginTable( "UndoHistoryTable", 4, tableFlags, { 0.0f, -1.0f } ) ) {
+				if ( ImGui::BeginTable( "UndoHistoryTable", 8, tableFlags, { 0.0f, -1.0f } ) ) {
 
 					ImGui::TableSetupColumn( "Epoch" );
+					ImGui::TableSetupColumn( "Parent" );
 					ImGui::TableSetupColumn( "Total" );
 					ImGui::TableSetupColumn( "Created" );
 					ImGui::TableSetupColumn( "Updated" );
+					ImGui::TableSetupColumn( "KiB" );
+					ImGui::TableSetupColumn( "Record ms" );
+					ImGui::TableSetupColumn( "Restore ms" );
 					ImGui::TableSetupScrollFreeze( 0, 1 );
 					ImGui::TableHeadersRow();
 
@@ -342,16 +353,25 @@ void Cyclone::UI::Outliner::Update( Cyclone::Core::LevelInterface *inLevelInterf
 					const size_t currentEpoch = inLevelInterface->GetEntityCtx().GetUndoEpoch();
 					size_t chosenEpoch = currentEpoch;
 
+					// Only the current epoch and its ancestors are applied, every other branch is shown disabled
+					mAppliedEpochs.assign( undoStack.size(), false );
+					for ( size_t epoch = currentEpoch; epoch < undoStack.size(); epoch = inLevelInterface->GetEntityCtx().GetEpochParent( epoch ) ) {
+						mAppliedEpochs[epoch] = true;
+					}
+
 					for ( int epoch = static_cast<int>( undoStack.size() ) - 1; epoch >= 0; --epoch ) {
+						if ( inLevelInterface->GetEntityCtx().IsEpochCompacted( epoch ) ) continue;
+
 						ImGui::PushID( epoch );
 
-						const entt::registry &epochRegistry = undoStack[epoch];
+						const Cyclone::Core::History::Epoch &epochHistory = *undoStack[epoch];
+						const auto &stats = inLevelInterface->GetEntityCtx().GetEpochStats( epoch );
 
-						size_t nChanges = epochRegistry.view<entt::entity>().size();
-						size_t nUpdates = epochRegistry.view<Cyclone::Core::Component::EpochNumber>().size();
+						size_t nChanges = stats.mEntityCount;
+						size_t nUpdates = nChanges - epochHistory.GetCreatedCount();
 
 						bool isCurrent = epoch == currentEpoch;
-						bool disabled = epoch > currentEpoch;
+						bool disabled = !mAppliedEpochs[epoch];
 
 						if ( disabled ) ImGui::PushStyleColor( ImGuiCol_Text, style.Colors[ImGuiCol_TextDisabled] );
 
@@ -362,28 +382,44 @@ void Cyclone::UI::Outliner::Update( Cyclone::Core::LevelInterface *inLevelInterf
 							chosenEpoch = epoch;
 						};
 
+						if ( ImGui::IsItemHovered() ) {
+							ImGui::BeginTooltip();
+							for ( size_t column = 0; column < Cyclone::Core::History::history_columns::size; ++column ) {
+								if ( stats.mColumnBytes[column] != 0 ) ImGui::Text( "%s: %zu bytes", Cyclone::Core::History::kHistoryColumnNames[column], stats.mColumnBytes[column] );
+							}
+							ImGui::Text( "Restored %zu times", stats.mRestoreCount );
+							ImGui::EndTooltip();
+						}
+
 						ImGui::TableSetColumnIndex( 1 );
-						ImGui::Text( Cyclone::Util::PrefixString( "", nChanges ) );
+						const size_t parentEpoch = inLevelInterface->GetEntityCtx().GetEpochParent( epoch );
+						if ( parentEpoch != Cyclone::Core::EntityContext::kNoEpoch ) ImGui::Text( Cyclone::Util::PrefixString( "", parentEpoch ) );
 
 						ImGui::TableSetColumnIndex( 2 );
-						ImGui::Text( Cyclone::Util::PrefixString( "", nChanges - nUpdates ) );
+						ImGui::Text( Cyclone::Util::PrefixString( "", nChanges ) );
 
 						ImGui::TableSetColumnIndex( 3 );
+						ImGui::Text( Cyclone::Util::PrefixString( "", nChanges - nUpdates ) );
+
+						ImGui::TableSetColumnIndex( 4 );
 						ImGui::Text( Cyclone::Util::PrefixString( "", nUpdates ) );
 
+						ImGui::TableSetColumnIndex( 5 );
+						ImGui::Text( "%.1f", stats.mPayloadBytes / 1024.0 );
+
+						ImGui::TableSetColumnIndex( 6 );
+						ImGui::Text( "%.2f", stats.mRecordMilliseconds );
+
+						ImGui::TableSetColumnIndex( 7 );
+						if ( stats.mRestoreCount != 0 ) ImGui::Text( "%.2f", stats.mRestoreMilliseconds );
+
 						if ( disabled ) ImGui::PopStyleColor( 1 );
 
 						ImGui::PopID();
 					}
 
 					if ( chosenEpoch != currentEpoch ) {
-						while ( inLevelInterface->GetEntityCtx().GetUndoEpoch() > chosenEpoch ) {
-							inLevelInterface->GetEntityCtx().UndoAction( inLevelInterface->GetRegistry() );
-						}
-
-						while ( inLevelInterface->GetEntityCtx().GetUndoEpoch() < chosenEpoch ) {
-							inLevelInterface->GetEntityCtx().RedoAction( inLevelInterface->GetRegistry() );
-						}
+						inLevelInterface->GetEntityCtx().JumpToEpoch( chosenEpoch, inLevelInterface->GetRegistry() );
 					}
 
 					ImGui::EndTable();
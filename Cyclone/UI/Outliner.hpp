@@ -24,6 +24,8 @@ namespace Cyclone::UI
 		using EntityCategoryTree = std::map<Cyclone::Core::Component::EntityCategory, EntityTypeTree>;
 		EntityCategoryTree mOutlinerTree;
 
+		std::vector<bool> mAppliedEpochs;	///< Epochs on the path to the current one, rebuilt every frame
+
 		float mOutlinerHeight = 256.0f;
 		float mSelectionHeight = 256.0f;
 		float mUndoHistoryHeight = 256.0f;
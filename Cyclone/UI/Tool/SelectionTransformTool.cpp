@@ -88,9 +88,6 @@ inline void Cyclone::UI::Tool::SelectionTransformTool::OnUpdate( Cyclone::Core::
 			}
 		}
 		else if ( !ImGui::IsMouseDown( ImGuiMouseButton_Left ) && transformContext.GetActiveEntity() != entt::null ) {
-			for ( const entt::entity entity : selectedEntities ) {
-				inLevelInterface->GetEntityCtx().UpdateEntity( entity, registry );
-			}
 			inLevelInterface->GetEntityCtx().EndAction();
 
 			transformContext.Deactivate();
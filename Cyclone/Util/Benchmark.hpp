@@ -0,0 +1,61 @@
+#pragma once
+
+// Cyclone utils
+#include "Cyclone/Util/TypeList.hpp"
+
+namespace Cyclone::Util
+{
+	/// Runs of each variant timed by TimeSerialAndParallel()
+	inline constexpr int kBenchmarkRuns = 3;
+
+	/// @brief Times the serial and the parallel variant of a benchmark, keeping the best of kBenchmarkRuns each
+	/// @param inRun Called with whether to run in parallel, returns the milliseconds it measured
+	template<typename Function>
+	void TimeSerialAndParallel( const Function &inRun, double &outSerialMilliseconds, double &outParallelMilliseconds )
+	{
+		// Interleaved, and the first run also warms up the thread pool
+		outSerialMilliseconds = std::numeric_limits<double>::max();
+		outParallelMilliseconds = std::numeric_limits<double>::max();
+		for ( int run = 0; run < kBenchmarkRuns; ++run ) {
+			outSerialMilliseconds = std::min( outSerialMilliseconds, inRun( false ) );
+			outParallelMilliseconds = std::min( outParallelMilliseconds, inRun( true ) );
+		}
+	}
+
+	/// @brief Clears ioMatch unless both registries hold the same entities with bitwise equal values in storage T
+	struct CompareStorageFunctor
+	{
+		template<typename T>
+		void Apply( const entt::registry &inLhs, const entt::registry &inRhs, bool &ioMatch ) const
+		{
+			if ( !ioMatch ) return;
+
+			const auto *lhs = inLhs.storage<T>();
+			const auto *rhs = inRhs.storage<T>();
+			const size_t lhsSize = lhs ? lhs->size() : 0;
+			const size_t rhsSize = rhs ? rhs->size() : 0;
+			if ( lhsSize != rhsSize ) {
+				ioMatch = false;
+				return;
+			}
+
+			if ( lhsSize == 0 ) return;
+
+			for ( const auto [entity, value] : lhs->each() ) {
+				if ( !rhs->contains( entity ) || std::memcmp( &value, &rhs->get( entity ), sizeof( T ) ) != 0 ) {
+					ioMatch = false;
+					return;
+				}
+			}
+		}
+	};
+
+	/// @brief Whether two registries hold the same values in every storage of TypeList, used to check the variants of a benchmark agree
+	template<typename TypeList>
+	bool RegistriesMatch( const entt::registry &inLhs, const entt::registry &inRhs )
+	{
+		bool match = true;
+		ApplyOverTypeList<TypeList>( CompareStorageFunctor{}, inLhs, inRhs, match );
+		return match;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,367 @@
+#include "pch.h"
+#include "Cyclone/Util/BlockCodec.hpp"
+
+// STL
+#include <execution>
+#include <numeric>
+
+namespace
+{
+	constexpr size_t kHashBits = 14;
+	constexpr size_t kLastLiterals = 5;		///< Every block ends with literals, no match reaches its last bytes
+	constexpr size_t kMatchSearchEnd = 12;	///< No match starts closer than this to the end of a block
+	constexpr size_t kLengthMask = 15;		///< Lengths this long continue in extra bytes after the token
+
+	uint32_t Read32( const std::byte *inData )
+	{
+		uint32_t value;
+		std::memcpy( &value, inData, sizeof( uint32_t ) );
+		return value;
+	}
+
+	uint32_t HashOf( uint32_t inValue )
+	{
+		return ( inValue * 2654435761u ) >> ( 32 - kHashBits );
+	}
+
+	void WriteLength( size_t inLength, std::vector<std::byte> &ioOutput )
+	{
+		for ( ; inLength >= 255; inLength -= 255 ) ioOutput.push_back( std::byte{ 255 } );
+		ioOutput.push_back( static_cast<std::byte>( inLength ) );
+	}
+
+	bool ReadLength( std::span<const std::byte> inInput, size_t &ioPosition, size_t &ioLength )
+	{
+		uint8_t byte;
+		do {
+			if ( ioPosition >= inInput.size() ) return false;
+			byte = static_cast<uint8_t>( inInput[ioPosition++] );
+			ioLength += byte;
+		} while ( byte == 255 );
+		return true;
+	}
+
+	/// A run of literals followed by a match, a match of length zero ends the block
+	void WriteSequence( std::span<const std::byte> inLiterals, size_t inOffset, size_t inMatchLength, std::vector<std::byte> &ioOutput )
+	{
+		const size_t matchCode = inMatchLength == 0 ? 0 : inMatchLength - Cyclone::Util::BlockCodec::kMinMatch;
+		ioOutput.push_back( static_cast<std::byte>( std::min( inLiterals.size(), kLengthMask ) << 4 | std::min( matchCode, kLengthMask ) ) );
+		if ( inLiterals.size() >= kLengthMask ) WriteLength( inLiterals.size() - kLengthMask, ioOutput );
+		ioOutput.insert( ioOutput.end(), inLiterals.begin(), inLiterals.end() );
+
+		if ( inMatchLength == 0 ) return;
+		ioOutput.push_back( static_cast<std::byte>( inOffset & 0xFF ) );
+		ioOutput.push_back( static_cast<std::byte>( inOffset >> 8 ) );
+		if ( matchCode >= kLengthMask ) WriteLength( matchCode - kLengthMask, ioOutput );
+	}
+
+	/// Transposes a matrix of 8 by 8 bytes held as one row per word
+	void Transpose8x8( std::array<uint64_t, 8> &ioRows )
+	{
+		const auto swap = [&]( size_t inRow, size_t inOther, unsigned inShift, uint64_t inMask ) {
+			const uint64_t bits = ( ( ioRows[inRow] >> inShift ) ^ ioRows[inOther] ) & inMask;
+			ioRows[inRow] ^= bits << inShift;
+			ioRows[inOther] ^= bits;
+		};
+
+		for ( size_t row : { 0, 1, 2, 3 } ) swap( row, row + 4, 32, 0x00000000FFFFFFFFull );
+		for ( size_t row : { 0, 1, 4, 5 } ) swap( row, row + 2, 16, 0x0000FFFF0000FFFFull );
+		for ( size_t row : { 0, 2, 4, 6 } ) swap( row, row + 1, 8, 0x00FF00FF00FF00FFull );
+	}
+
+	/// @brief Subtracts the same word of the previous record from each word and scatters its bytes into their planes in one pass
+	/// @note Fields are delta encoded in words as wide as the stride allows, so doubles on a grid become small repeating differences
+	template<typename Word>
+	void DeltaEncodeShuffle( const std::byte *inRaw, size_t inRecords, size_t inStride, std::byte *outShuffled )
+	{
+		const size_t words = inStride / sizeof( Word );
+		std::vector<Word> previous( words, 0 );
+
+		size_t record = 0;
+		if constexpr ( sizeof( Word ) == sizeof( uint64_t ) ) {
+			std::array<uint64_t, 8> rows;
+			for ( ; record + 8 <= inRecords; record += 8 ) {
+				for ( size_t word = 0; word < words; ++word ) {
+					const std::byte *source = inRaw + record * inStride + word * sizeof( Word );
+					for ( size_t row = 0; row < 8; ++row ) {
+						Word value;
+						std::memcpy( &value, source + row * inStride, sizeof( Word ) );
+						rows[row] = value - previous[word];
+						previous[word] = value;
+					}
+					Transpose8x8( rows );
+
+					std::byte *plane = outShuffled + word * sizeof( Word ) * inRecords + record;
+					for ( size_t byte = 0; byte < 8; ++byte ) {
+						std::memcpy( plane + byte * inRecords, &rows[byte], sizeof( uint64_t ) );
+					}
+				}
+			}
+		}
+
+		for ( ; record < inRecords; ++record ) {
+			const std::byte *source = inRaw + record * inStride;
+			for ( size_t word = 0; word < words; ++word ) {
+				Word value;
+				std::memcpy( &value, source + word * sizeof( Word ), sizeof( Word ) );
+				const Word delta = value - previous[word];
+				previous[word] = value;
+
+				std::byte *plane = outShuffled + word * sizeof( Word ) * inRecords + record;
+				for ( size_t byte = 0; byte < sizeof( Word ); ++byte ) {
+					plane[byte * inRecords] = static_cast<std::byte>( delta >> ( byte * 8 ) );
+				}
+			}
+		}
+	}
+
+	/// Gathers each word from its byte planes and adds the same word of the previous record in one pass, this is the hot loop of decoding
+	template<typename Word>
+	void UnshuffleDeltaDecode( const std::byte *inShuffled, size_t inRecords, size_t inStride, std::byte *outRaw )
+	{
+		const size_t words = inStride / sizeof( Word );
+		std::vector<Word> previous( words, 0 );
+
+		// Eight records of a 64 bit word are gathered with one load per plane
+		size_t record = 0;
+		if constexpr ( sizeof( Word ) == sizeof( uint64_t ) ) {
+			std::array<uint64_t, 8> rows;
+			for ( ; record + 8 <= inRecords; record += 8 ) {
+				for ( size_t word = 0; word < words; ++word ) {
+					const std::byte *plane = inShuffled + word * sizeof( Word ) * inRecords + record;
+					for ( size_t byte = 0; byte < 8; ++byte ) {
+						std::memcpy( &rows[byte], plane + byte * inRecords, sizeof( uint64_t ) );
+					}
+					Transpose8x8( rows );
+
+					std::byte *target = outRaw + record * inStride + word * sizeof( Word );
+					for ( size_t row = 0; row < 8; ++row ) {
+						previous[word] += rows[row];
+						std::memcpy( target + row * inStride, &previous[word], sizeof( Word ) );
+					}
+				}
+			}
+		}
+
+		for ( ; record < inRecords; ++record ) {
+			std::byte *target = outRaw + record * inStride;
+			for ( size_t word = 0; word < words; ++word ) {
+				const std::byte *plane = inShuffled + word * sizeof( Word ) * inRecords + record;
+				Word value = 0;
+				for ( size_t byte = 0; byte < sizeof( Word ); ++byte ) {
+					value |= static_cast<Word>( static_cast<uint8_t>( plane[byte * inRecords] ) ) << ( byte * 8 );
+				}
+
+				previous[word] += value;
+				std::memcpy( target + word * sizeof( Word ), &previous[word], sizeof( Word ) );
+			}
+		}
+	}
+
+	template<typename Function>
+	bool ForEachBlock( size_t inBlockCount, bool inParallel, const Function &inFunction )
+	{
+		std::vector<size_t> blocks( inBlockCount );
+		std::iota( blocks.begin(), blocks.end(), size_t{ 0 } );
+
+		if ( inParallel && inBlockCount > 1 ) {
+			return std::all_of( std::execution::par, blocks.begin(), blocks.end(), inFunction );
+		}
+		return std::all_of( blocks.begin(), blocks.end(), inFunction );
+	}
+}
+
+void Cyclone::Util::BlockCodec::sEncode( std::span<const std::byte> inRaw, size_t inStride, bool inParallel, std::vector<std::byte> &outEncoded )
+{
+	assert( inStride != 0 && "Records must have a size!" );
+
+	const size_t blockBytes = sGetBlockBytes( inStride );
+	const size_t blockCount = ( inRaw.size() + blockBytes - 1 ) / blockBytes;
+
+	std::vector<std::vector<std::byte>> blocks( blockCount );
+	ForEachBlock( blockCount, inParallel, [&]( size_t inBlock ) {
+		const size_t begin = inBlock * blockBytes;
+		const std::span<const std::byte> raw = inRaw.subspan( begin, std::min( blockBytes, inRaw.size() - begin ) );
+
+		std::vector<std::byte> shuffled( raw.size() );
+		sTransform( raw, inStride, shuffled );
+
+		// Data that does not shrink is kept raw, which also skips the transform when it is decoded
+		std::vector<std::byte> &block = blocks[inBlock];
+		if ( sCompress( shuffled, block ) >= raw.size() ) block.assign( raw.begin(), raw.end() );
+		return true;
+	} );
+
+	// A table of stored block sizes, followed by the blocks
+	size_t encodedSize = blockCount * sizeof( uint32_t );
+	for ( const std::vector<std::byte> &block : blocks ) encodedSize += block.size();
+
+	outEncoded.resize( encodedSize );
+	std::byte *table = outEncoded.data();
+	std::byte *output = table + blockCount * sizeof( uint32_t );
+	for ( const std::vector<std::byte> &block : blocks ) {
+		const uint32_t storedSize = static_cast<uint32_t>( block.size() );
+		std::memcpy( table, &storedSize, sizeof( uint32_t ) );
+		table += sizeof( uint32_t );
+
+		std::memcpy( output, block.data(), block.size() );
+		output += block.size();
+	}
+}
+
+bool Cyclone::Util::BlockCodec::sDecode( std::span<const std::byte> inEncoded, size_t inStride, bool inParallel, std::span<std::byte> outRaw )
+{
+	assert( inStride != 0 && "Records must have a size!" );
+
+	const size_t blockBytes = sGetBlockBytes( inStride );
+	const size_t blockCount = ( outRaw.size() + blockBytes - 1 ) / blockBytes;
+	if ( inEncoded.size() / sizeof( uint32_t ) < blockCount ) return false;
+
+	// Every block is located up front, so they can be decoded in any order
+	std::vector<size_t> offsets( blockCount + 1 );
+	offsets[0] = blockCount * sizeof( uint32_t );
+	for ( size_t block = 0; block < blockCount; ++block ) {
+		uint32_t storedSize;
+		std::memcpy( &storedSize, inEncoded.data() + block * sizeof( uint32_t ), sizeof( uint32_t ) );
+		if ( storedSize > std::min( blockBytes, outRaw.size() - block * blockBytes ) ) return false;
+		offsets[block + 1] = offsets[block] + storedSize;
+	}
+	if ( offsets.back() != inEncoded.size() ) return false;
+
+	return ForEachBlock( blockCount, inParallel, [&]( size_t inBlock ) {
+		const size_t begin = inBlock * blockBytes;
+		const std::span<std::byte> raw = outRaw.subspan( begin, std::min( blockBytes, outRaw.size() - begin ) );
+		const std::span<const std::byte> stored = inEncoded.subspan( offsets[inBlock], offsets[inBlock + 1] - offsets[inBlock] );
+
+		if ( stored.size() == raw.size() ) {
+			std::memcpy( raw.data(), stored.data(), raw.size() );
+			return true;
+		}
+
+		std::vector<std::byte> shuffled( raw.size() );
+		if ( !sDecompress( stored, shuffled ) ) return false;
+
+		sRestore( shuffled, inStride, raw );
+		return true;
+	} );
+}
+
+size_t Cyclone::Util::BlockCodec::sGetBlockBytes( size_t inStride )
+{
+	return std::max<size_t>( kBlockSize / inStride, 1 ) * inStride;
+}
+
+size_t Cyclone::Util::BlockCodec::sCompress( std::span<const std::byte> inInput, std::vector<std::byte> &outOutput )
+{
+	outOutput.clear();
+	outOutput.reserve( inInput.size() );
+
+	const std::byte *data = inInput.data();
+	const size_t size = inInput.size();
+	size_t anchor = 0;
+
+	if ( size > kMatchSearchEnd ) {
+		std::vector<uint32_t> table( size_t{ 1 } << kHashBits, 0 );
+		const size_t searchEnd = size - kMatchSearchEnd;
+		const size_t matchEnd = size - kLastLiterals;
+
+		size_t position = 0;
+		while ( position < searchEnd ) {
+			const uint32_t value = Read32( data + position );
+			const uint32_t hash = HashOf( value );
+			const size_t candidate = table[hash];
+			table[hash] = static_cast<uint32_t>( position );
+
+			// Data without matches is skipped faster and faster
+			if ( candidate >= position || position - candidate > kMaxOffset || Read32( data + candidate ) != value ) {
+				position += 1 + ( ( position - anchor ) >> 6 );
+				continue;
+			}
+
+			size_t start = position;
+			size_t source = candidate;
+			while ( start > anchor && source > 0 && data[start - 1] == data[source - 1] ) {
+				--start;
+				--source;
+			}
+
+			size_t end = position + kMinMatch;
+			while ( end < matchEnd && data[end] == data[candidate + end - position] ) ++end;
+
+			WriteSequence( inInput.subspan( anchor, start - anchor ), start - source, end - start, outOutput );
+			anchor = position = end;
+
+			// Primes the table within the match, so runs right after it are found
+			if ( position < searchEnd ) table[HashOf( Read32( data + position - 2 ) )] = static_cast<uint32_t>( position - 2 );
+		}
+	}
+
+	WriteSequence( inInput.subspan( anchor ), 0, 0, outOutput );
+	return outOutput.size();
+}
+
+bool Cyclone::Util::BlockCodec::sDecompress( std::span<const std::byte> inInput, std::span<std::byte> outOutput )
+{
+	size_t input = 0;
+	size_t output = 0;
+
+	for ( ;; ) {
+		if ( input >= inInput.size() ) return false;
+		const uint8_t token = static_cast<uint8_t>( inInput[input++] );
+
+		size_t literals = token >> 4;
+		if ( literals == kLengthMask && !ReadLength( inInput, input, literals ) ) return false;
+		if ( literals > inInput.size() - input || literals > outOutput.size() - output ) return false;
+
+		std::memcpy( outOutput.data() + output, inInput.data() + input, literals );
+		input += literals;
+		output += literals;
+
+		// Only the last sequence has no match
+		if ( input == inInput.size() ) return output == outOutput.size();
+
+		if ( inInput.size() - input < 2 ) return false;
+		const size_t offset = static_cast<size_t>( inInput[input] ) | static_cast<size_t>( inInput[input + 1] ) << 8;
+		input += 2;
+
+		size_t length = token & kLengthMask;
+		if ( length == kLengthMask && !ReadLength( inInput, input, length ) ) return false;
+		length += kMinMatch;
+		if ( offset == 0 || offset > output || length > outOutput.size() - output ) return false;
+
+		// Overlapping matches repeat their start, every copy doubles the bytes that can be taken at once
+		const std::byte *source = outOutput.data() + output - offset;
+		std::byte *target = outOutput.data() + output;
+		for ( size_t copied = 0; copied < length; ) {
+			const size_t count = std::min( length - copied, static_cast<size_t>( target + copied - source ) );
+			std::memcpy( target + copied, source, count );
+			copied += count;
+		}
+		output += length;
+	}
+}
+
+void Cyclone::Util::BlockCodec::sTransform( std::span<const std::byte> inRaw, size_t inStride, std::span<std::byte> outShuffled )
+{
+	const size_t records = inRaw.size() / inStride;
+	const size_t recordBytes = records * inStride;
+
+	// Byte i of every record goes into the i-th plane, a trailing partial record is kept as it is
+	if ( inStride % sizeof( uint64_t ) == 0 ) DeltaEncodeShuffle<uint64_t>( inRaw.data(), records, inStride, outShuffled.data() );
+	else if ( inStride % sizeof( uint32_t ) == 0 ) DeltaEncodeShuffle<uint32_t>( inRaw.data(), records, inStride, outShuffled.data() );
+	else DeltaEncodeShuffle<uint8_t>( inRaw.data(), records, inStride, outShuffled.data() );
+
+	std::copy( inRaw.begin() + recordBytes, inRaw.end(), outShuffled.begin() + recordBytes );
+}
+
+void Cyclone::Util::BlockCodec::sRestore( std::span<const std::byte> inShuffled, size_t inStride, std::span<std::byte> outRaw )
+{
+	const size_t records = outRaw.size() / inStride;
+	const size_t recordBytes = records * inStride;
+
+	if ( inStride % sizeof( uint64_t ) == 0 ) UnshuffleDeltaDecode<uint64_t>( inShuffled.data(), records, inStride, outRaw.data() );
+	else if ( inStride % sizeof( uint32_t ) == 0 ) UnshuffleDeltaDecode<uint32_t>( inShuffled.data(), records, inStride, outRaw.data() );
+	else UnshuffleDeltaDecode<uint8_t>( inShuffled.data(), records, inStride, outRaw.data() );
+
+	std::copy( inShuffled.begin() + recordBytes, inShuffled.end(), outRaw.begin() + recordBytes );
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+// STL
+#include <span>
+#include <vector>
+
+namespace Cyclone::Util
+{
+	/// @brief Self contained block compression for arrays of fixed size records, such as component columns
+	/// @note Each block is delta encoded per field against the previous record, shuffled so equal bytes of every record are adjacent, and then LZ compressed
+	/// @note Blocks are independent, so they are encoded and decoded in parallel, and a block which does not shrink is stored as is
+	class BlockCodec
+	{
+	public:
+		static constexpr size_t kBlockSize = 256 * 1024;	///< Raw bytes of one block, rounded down to whole records
+		static constexpr size_t kMinMatch = 4;
+		static constexpr size_t kMaxOffset = 65535;
+
+		/// @brief Compresses inRaw, made of records of inStride bytes, into outEncoded
+		/// @note Records may be of any size, their fields are delta encoded as 64 bit words if the stride allows it, else as 32 bit words or bytes
+		static void				sEncode( std::span<const std::byte> inRaw, size_t inStride, bool inParallel, std::vector<std::byte> &outEncoded );
+
+		/// @brief Decompresses inEncoded into outRaw, which must have the size of the data that was encoded
+		/// @return False if inEncoded is corrupt, outRaw is left in an undefined state then
+		static bool				sDecode( std::span<const std::byte> inEncoded, size_t inStride, bool inParallel, std::span<std::byte> outRaw );
+
+	protected:
+		static size_t			sGetBlockBytes( size_t inStride );
+		static size_t			sCompress( std::span<const std::byte> inInput, std::vector<std::byte> &outOutput );
+		static bool				sDecompress( std::span<const std::byte> inInput, std::span<std::byte> outOutput );
+		static void				sTransform( std::span<const std::byte> inRaw, size_t inStride, std::span<std::byte> outShuffled );
+		static void				sRestore( std::span<const std::byte> inShuffled, size_t inStride, std::span<std::byte> outRaw );
+	};
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+
+// STL
+#include <span>
+
+namespace Cyclone::Util
+{
+	/// @brief Appends trivially copyable values to a growing byte buffer
+	class ByteWriter
+	{
+	public:
+		explicit ByteWriter( std::vector<std::byte> &ioBytes ) : mBytes( ioBytes ) {}
+
+		template<typename T>
+		void Write( const T &inValue )
+		{
+			static_assert( std::is_trivially_copyable_v<T> );
+			const std::byte *raw = reinterpret_cast<const std::byte *>( &inValue );
+			mBytes.insert( mBytes.end(), raw, raw + sizeof( T ) );
+		}
+
+		template<typename T>
+		void WriteSpan( std::span<const T> inValues )
+		{
+			static_assert( std::is_trivially_copyable_v<T> );
+			Write( static_cast<uint64_t>( inValues.size() ) );
+			const std::byte *raw = reinterpret_cast<const std::byte *>( inValues.data() );
+			mBytes.insert( mBytes.end(), raw, raw + inValues.size_bytes() );
+		}
+
+		size_t GetSize() const { return mBytes.size(); }
+
+	protected:
+		std::vector<std::byte> &mBytes;
+	};
+
+	/// @brief Reads values written by ByteWriter, reads past the end yield zeroes and flag the reader as failed
+	class ByteReader
+	{
+	public:
+		explicit ByteReader( std::span<const std::byte> inBytes ) : mBytes( inBytes ) {}
+
+		template<typename T>
+		T Read()
+		{
+			static_assert( std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T> );
+			T value{};
+			if ( !CanRead( sizeof( T ) ) ) return value;
+			std::memcpy( &value, mBytes.data() + mOffset, sizeof( T ) );
+			mOffset += sizeof( T );
+			return value;
+		}
+
+		template<typename T>
+		void ReadSpan( std::vector<T> &outValues )
+		{
+			static_assert( std::is_trivially_copyable_v<T> );
+			const auto count = Read<uint64_t>();
+			if ( !CanRead( 0 ) || count > ( mBytes.size() - mOffset ) / sizeof( T ) ) {
+				mFailed = true;
+				return;
+			}
+			outValues.resize( count );
+			std::memcpy( outValues.data(), mBytes.data() + mOffset, count * sizeof( T ) );
+			mOffset += count * sizeof( T );
+		}
+
+		bool IsValid() const { return !mFailed; }
+		size_t GetOffset() const { return mOffset; }
+
+	protected:
+		bool CanRead( size_t inSize )
+		{
+			mFailed |= inSize > mBytes.size() - mOffset;
+			return !mFailed;
+		}
+
+		std::span<const std::byte> mBytes;
+		size_t mOffset = 0;
+		bool mFailed = false;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+// STL
+#include <span>
+
+namespace Cyclone::Util
+{
+	inline constexpr uint64_t kFnv1a64Offset = 0xCBF29CE484222325ull;
+	inline constexpr uint64_t kFnv1a64Prime = 0x00000100000001B3ull;
+
+	/// @brief 64 bit FNV-1a over a byte range, pass a previous result as inSeed to hash several ranges as one
+	constexpr uint64_t Fnv1a64( std::span<const std::byte> inBytes, uint64_t inSeed = kFnv1a64Offset )
+	{
+		uint64_t hash = inSeed;
+		for ( const std::byte byte : inBytes ) {
+			hash = ( hash ^ static_cast<uint64_t>( byte ) ) * kFnv1a64Prime;
+		}
+		return hash;
+	}
+}
\ No newline at end of file
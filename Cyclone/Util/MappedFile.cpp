@@ -0,0 +1,126 @@
+#include "pch.h"
+#include "Cyclone/Util/MappedFile.hpp"
+
+bool Cyclone::Util::MappedFile::Open( const std::filesystem::path &inPath, EMode inMode )
+{
+	Close();
+
+	DWORD access = GENERIC_READ;
+	DWORD disposition = OPEN_EXISTING;
+	DWORD flags = FILE_ATTRIBUTE_NORMAL;
+
+	switch ( inMode ) {
+		case EMode::Read:
+			break;
+		case EMode::Append:
+			access |= GENERIC_WRITE;
+			disposition = OPEN_ALWAYS;
+			break;
+		case EMode::Create:
+			access |= GENERIC_WRITE;
+			disposition = CREATE_ALWAYS;
+			break;
+		case EMode::Temporary:
+			access |= GENERIC_WRITE;
+			disposition = CREATE_ALWAYS;
+			flags = FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE;
+			break;
+	}
+
+	mFile = CreateFileW( inPath.c_str(), access, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, disposition, flags, nullptr );
+	if ( mFile == INVALID_HANDLE_VALUE ) return false;
+
+	mMode = inMode;
+
+	LARGE_INTEGER fileSize{};
+	if ( !GetFileSizeEx( mFile, &fileSize ) ) {
+		Close();
+		return false;
+	}
+
+	mSize = static_cast<size_t>( fileSize.QuadPart );
+
+	if ( !Map() ) {
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void Cyclone::Util::MappedFile::Close()
+{
+	Unmap();
+
+	if ( mFile != INVALID_HANDLE_VALUE ) {
+		CloseHandle( mFile );
+		mFile = INVALID_HANDLE_VALUE;
+	}
+
+	mSize = 0;
+}
+
+bool Cyclone::Util::MappedFile::Resize( size_t inSize )
+{
+	assert( IsOpen() && IsWritable() && "Cannot resize a file opened read only!" );
+
+	Unmap();
+
+	LARGE_INTEGER fileSize{};
+	fileSize.QuadPart = static_cast<LONGLONG>( inSize );
+	if ( !SetFilePointerEx( mFile, fileSize, nullptr, FILE_BEGIN ) || !SetEndOfFile( mFile ) ) {
+		Map();
+		return false;
+	}
+
+	mSize = inSize;
+	return Map();
+}
+
+bool Cyclone::Util::MappedFile::FlushView( size_t inOffset, size_t inSize )
+{
+	if ( !mData || inSize == 0 ) return true;
+
+	return FlushViewOfFile( mData + inOffset, inSize ) != FALSE;
+}
+
+bool Cyclone::Util::MappedFile::FlushFile()
+{
+	if ( !IsOpen() ) return false;
+
+	return FlushFileBuffers( mFile ) != FALSE;
+}
+
+bool Cyclone::Util::MappedFile::Map()
+{
+	// Empty files cannot be mapped, the mapping is created on the first resize
+	if ( mSize == 0 ) return true;
+
+	const bool writable = IsWritable();
+	const auto size = static_cast<uint64_t>( mSize );
+
+	mMapping = CreateFileMappingW( mFile, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, static_cast<DWORD>( size >> 32 ), static_cast<DWORD>( size ), nullptr );
+	if ( !mMapping ) return false;
+
+	mData = static_cast<std::byte *>( MapViewOfFile( mMapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, mSize ) );
+	if ( !mData ) {
+		CloseHandle( mMapping );
+		mMapping = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+void Cyclone::Util::MappedFile::Unmap()
+{
+	if ( mData ) {
+		UnmapViewOfFile( mData );
+		mData = nullptr;
+	}
+
+	if ( mMapping ) {
+		CloseHandle( mMapping );
+		mMapping = nullptr;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+// Cyclone utils
+#include "Cyclone/Util/NonCopyable.hpp"
+
+// STL
+#include <filesystem>
+
+namespace Cyclone::Util
+{
+	/// @brief A file mapped into the address space, the mapping is recreated whenever the file is resized
+	class MappedFile : public Cyclone::Util::NonCopyable
+	{
+	public:
+		enum class EMode : uint8_t
+		{
+			Read,		///< Open an existing file read only
+			Append,		///< Open or create a file for reading and writing, keeping its contents
+			Create,		///< Create or truncate a file for reading and writing
+			Temporary,	///< As Create, but the file is deleted when closed
+		};
+
+		MappedFile() = default;
+		~MappedFile() { Close(); }
+
+		bool					Open( const std::filesystem::path &inPath, EMode inMode );
+		void					Close();
+
+		/// @brief Grows or shrinks the file, invalidates any pointer previously returned by GetData()
+		bool					Resize( size_t inSize );
+
+		/// @brief Writes a range of the mapping back to disk and waits for it to reach the device
+		bool					Flush( size_t inOffset, size_t inSize ) { return FlushView( inOffset, inSize ) && FlushFile(); }
+
+		/// @brief Queues a range of the mapping for writing, does not wait for the device
+		bool					FlushView( size_t inOffset, size_t inSize );
+
+		/// @brief Waits for every write queued so far to reach the device, safe to call while the mapping is being written
+		bool					FlushFile();
+
+		/// @brief Creates a file of inSize bytes at inPath, fills its mapping with inWrite and waits for it to reach the device
+		/// @param inWrite Called with the mapped bytes of the file
+		template<typename Function>
+		static bool				sWrite( const std::filesystem::path &inPath, size_t inSize, const Function &inWrite )
+		{
+			MappedFile file;
+			if ( !file.Open( inPath, EMode::Create ) || !file.Resize( inSize ) ) return false;
+
+			inWrite( file.GetData() );
+			return file.Flush( 0, inSize );
+		}
+
+		/// @brief Writes a new file next to inPath and then moves it over inPath, so a failed write never damages the previous file
+		/// @param inWrite Called with the path to write, returns false if it failed, every file it mapped must be closed by then
+		template<typename Function>
+		static bool				sReplace( const std::filesystem::path &inPath, const Function &inWrite )
+		{
+			std::filesystem::path temporaryPath = inPath;
+			temporaryPath += ".tmp";
+			if ( !inWrite( temporaryPath ) ) return false;
+
+			std::error_code error;
+			std::filesystem::rename( temporaryPath, inPath, error );
+			return !error;
+		}
+
+		bool					IsOpen() const		{ return mFile != INVALID_HANDLE_VALUE; }
+		bool					IsWritable() const	{ return mMode != EMode::Read; }
+		size_t					GetSize() const		{ return mSize; }
+		const std::byte *		GetData() const		{ return mData; }
+		std::byte *				GetData()			{ return mData; }
+
+	protected:
+		bool					Map();
+		void					Unmap();
+
+		HANDLE					mFile = INVALID_HANDLE_VALUE;
+		HANDLE					mMapping = nullptr;
+		std::byte *				mData = nullptr;
+		size_t					mSize = 0;
+		EMode					mMode = EMode::Read;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,21 @@
+#pragma once
+
+// STL
+#include <algorithm>
+#include <execution>
+
+namespace Cyclone::Util
+{
+	/// @brief Calls inFunction on every task, on the parallel algorithms' thread pool if inParallel is set
+	/// @note The tasks must not depend on each other, callers pass false for inputs too small to be worth the thread pool
+	template<typename Container, typename Function>
+	void ForEachTask( Container &inTasks, bool inParallel, const Function &inFunction )
+	{
+		if ( inParallel ) {
+			std::for_each( std::execution::par, inTasks.begin(), inTasks.end(), inFunction );
+		}
+		else {
+			std::for_each( inTasks.begin(), inTasks.end(), inFunction );
+		}
+	}
+}
\ No newline at end of file
@@ -5,8 +5,10 @@
 
 #include "main.h"
 #include "Cyclone/Application.hpp"
+#include "Cyclone/Core/Serialization/LevelBaker.hpp"
 
 #include <imgui.h>
+#include <shellapi.h>
 
 #ifdef _DEBUG
 #include <dxgidebug.h>
@@ -30,6 +32,7 @@ ATOM                MyRegisterClass( HINSTANCE hInstance );
 BOOL                InitInstance( HINSTANCE, int );
 LRESULT CALLBACK    WndProc( HWND, UINT, WPARAM, LPARAM );
 INT_PTR CALLBACK    About( HWND, UINT, WPARAM, LPARAM );
+bool                RunCommandLine( int &outExitCode );
 
 // Indicates to hybrid graphics systems to prefer the discrete part by default
 extern "C"
@@ -47,6 +50,9 @@ int APIENTRY wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstanc
 	// Verify CPU support
 	if ( !DirectX::XMVerifyCPUSupport() ) return 1;
 
+	// Headless commands run without a window
+	if ( int exitCode = 0; RunCommandLine( exitCode ) ) return exitCode;
+
 	// Intialise multithreaded support
 	if ( FAILED( CoInitializeEx( nullptr, COINITBASE_MULTITHREADED ) ) ) return 1;
 
@@ -315,3 +321,22 @@ LRESULT CALLBACK WndProc( HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam
 
 	return DefWindowProc( hWnd, message, wParam, lParam );
 }
+
+// Runs a command given on the command line instead of the editor, the only one is
+//   Cyclone.exe -bake <output directory> <level>...
+// which bakes every level into the output directory and exits with the number of levels which failed
+bool RunCommandLine( int &outExitCode )
+{
+	int argumentCount = 0;
+	LPWSTR *arguments = CommandLineToArgvW( GetCommandLineW(), &argumentCount );
+	if ( !arguments ) return false;
+
+	const bool isBake = argumentCount >= 3 && std::wstring_view( arguments[1] ) == L"-bake";
+	if ( isBake ) {
+		const std::vector<std::filesystem::path> levels( arguments + 3, arguments + argumentCount );
+		outExitCode = static_cast<int>( Cyclone::Core::Serialization::LevelBaker::sBakeBatch( levels, arguments[2] ) );
+	}
+
+	LocalFree( arguments );
+	return isBake;
+}